@@ -8,6 +8,7 @@
 #include "imgui_sdl.h"
 #include "portable-file-dialogs.h"
 #pragma warning(pop)
+#include <unordered_map>
 #include "Chip8.h"
 #include "UIState.h"
 class BasicUI : public ParentUI
@@ -16,10 +17,26 @@ private:
 
 	UIState* fe_State;
 
+	//launcher textures only exist for thumbnails on screen, the rest are destroyed at the end of every frame
+	struct LauncherTexture {
+		SDL_Texture* texture;
+		bool used;
+	};
+	std::unordered_map<std::string, LauncherTexture> launcher_Textures; //by rom SHA1
+	std::vector<size_t> launcher_Items; //library entries matching the filter
+	size_t launcher_Library_Size = 0;
+	char launcher_Filter[64] = { 0 };
+	Uint32 hud_Updated = 0; //SDL ticks of the last HUD refresh
+	double hud_FPS = 0, hud_IPS = 0, hud_Frame_Ms = 0;
+
 	void ShowMenuBar();
 	void ShowMenuFile();
 	void ShowMenuEmulation();
 	void ShowMenuOptions();
+	void ShowLauncher(bool* p_open);
+	SDL_Texture* LauncherThumbnail(const RomLibrary::Entry& entry);
+	void ReleaseLauncherTextures(bool all);
+	void ShowHUD();
 
 public:
 	BasicUI(UIState* shared_state) : fe_State(shared_state) {}
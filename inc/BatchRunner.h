@@ -0,0 +1,95 @@
+#pragma once
+#include "stdint.h"
+#include "Chip8.h"
+#include "Logger.h"
+#include "Movie.h"
+#include "PagedMemory.h"
+#include <json/json.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//Runs many headless cores at once: every job from the manifest is a fresh Chip8 on a work-stealing thread pool.
+//Roms and movies are loaded once up front and shared read-only between jobs, each worker allocates guest RAM
+//from its own PageArena and logs through its own logger, so workers share nothing on the hot path.
+//Results are streamed as one JSON object per line, in completion order.
+class BatchRunner
+{
+public:
+	struct Job {
+		size_t id = 0;
+		std::string name;
+		std::string rom_file;
+		std::string movie_file;     //when set, the movie's inputs, seed, mode and quirks drive the run
+		Chip8::SYSTEM_MODE mode = Chip8::SYSTEM_MODE::CHIP_8;
+		Chip8::Quirks quirks;
+		uint32_t frames = 600;
+		uint16_t cycles = 9;        //per frame
+		uint64_t seed = 0;
+	};
+
+	struct Result {
+		uint32_t frames = 0;
+		uint64_t cycles = 0;        //instructions actually executed, halted cores stop counting
+		uint64_t state_hash = 0;
+		uint32_t vram_crc = 0;
+		uint64_t microseconds = 0;
+		bool halted = false;
+		int64_t first_desync_frame = -1;
+		std::string error;
+	};
+
+	struct Summary {
+		size_t jobs = 0;
+		size_t failed = 0;
+		uint64_t frames = 0;
+		uint64_t cycles = 0;
+		uint64_t microseconds = 0;  //wall time of the whole batch
+		uint64_t steals = 0;
+	};
+
+	BatchRunner(unsigned int threads = 0);
+
+	//manifest layout:
+	//    { "defaults": { job fields },
+	//      "jobs": [ { "rom": ..., "movie": ..., job fields }, ... ],
+	//      "matrix": { "roms": [ ... ], "configs": [ { job fields }, ... ] } }
+	//job fields: "name", "mode" ("chip8", "schip", "xochip"), "frames", "cycles", "seed", and "quirks" as an
+	//object of Chip8::Quirks member names. relative paths are resolved against the manifest's directory
+	bool LoadManifest(const std::string& filename);
+	void AddJob(Job job);
+	size_t GetJobCount() { return jobs.size(); }
+
+	void SetLogDirectory(const std::string& dir) { log_dir = dir; } //empty discards worker logs
+	void SetHashVerify(bool enable) { verify_hash = enable; }
+
+	bool Run(std::ostream& out, Summary& summary); //false when any job failed or desynced
+
+private:
+	struct Rom {
+		std::unique_ptr<RomImage> image;
+		std::string sha1;
+		std::string error;
+	};
+	struct LoadedMovie {
+		Movie movie;
+		std::string error;
+	};
+
+	bool ParseJob(const Json::Value& value, Job& job, std::string& error);
+	const Rom& GetRom(const std::string& filename);
+	const LoadedMovie& GetMovie(const std::string& filename);
+	void RunJob(const Job& job, PageArena* arena, std::shared_ptr<spdlog::logger> logger, Result& result);
+	std::string FormatResult(const Job& job, const Result& result);
+
+	unsigned int thread_count;
+	std::string log_dir = "logs";
+	std::string base_dir;
+	bool verify_hash = false;
+	std::vector<Job> jobs;
+	std::map<std::string, Rom> roms;
+	std::map<std::string, LoadedMovie> movies;
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include "stdint.h"
+#include <array>
+#include <cstddef>
+
+//CRC-32 (IEEE 802.3 polynomial). used to catch corrupt save states and to compare framebuffers during movie replay
+inline uint32_t Crc32(const uint8_t* data, size_t len)
+{
+	static const std::array<uint32_t, 256> table = [] {
+		std::array<uint32_t, 256> t{};
+		for (uint32_t n = 0; n < 256; n++)
+		{
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			t[n] = c;
+		}
+		return t;
+	}();
+
+	uint32_t crc = 0xFFFFFFFF;
+	for (size_t it = 0; it < len; it++)
+		crc = table[(crc ^ data[it]) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFF;
+}
+
+//splitmix64 finalizer. cheap, well distributed 64-bit mixing used to derive Zobrist keys for the state hash
+inline uint64_t Mix64(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
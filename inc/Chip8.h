@@ -1,79 +1,48 @@
 #pragma once
 #include "stdint.h"
 #include "Registers.h"
-#include "Logger.h"
+#include "Prng.h"
+#include "PagedMemory.h"
+#include "Profiler.h"
 #include <iostream>
 #include <string>
 #include <chrono>
 #include <vector>
+#include <array>
+#include <cstring>
+#include <memory>
+
+namespace spdlog { class logger; } //only Chip8.cpp needs Logger.h, embedders shouldn't have to see spdlog
 
 class Chip8
 {
 public:
 	enum SYSTEM_MODE { CHIP_8, SUPER_CHIP, XO_CHIP };
+	static const uint8_t RPL_SIZE = 16; //persistent flags FX75 saves. SUPER-CHIP uses the first 8, XO-CHIP all 16
 private:
-	uint8_t Memory[0x10000] = { 0 };
-	uint8_t Font[80] = {
-		0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-		0x20, 0x60, 0x20, 0x20, 0x70, // 1
-		0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-		0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-		0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-		0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-		0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-		0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-		0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-		0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-		0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-		0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-		0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-		0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-		0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-		0xF0, 0x80, 0xF0, 0x80, 0x80, // F
-	};
-	uint8_t LargeFont[160] = {
-		0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
-		0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
-		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
-		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
-		0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
-		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
-		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
-		0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
-		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
-		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
-		0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
-		0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
-		0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
-		0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
-		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
-		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
-	};
+	friend class Chip8Batch; //runs lanes' register opcodes itself and calls Decode_Execute for the rest
 
-	uint8_t LogoRom[97] = {
-		0x00, 0xE0, // cls
-		0x60, 0x0B, // ld v0 0x0B
-		0x61, 0x08, // ld v1 0x08
-		0x62, 0x0F, // ld v2 0x0F
-		0xA2, 0x16, // set i = 0x216 (start of logo data)
-		0xD0, 0x1F, // draw v0 v1 15, draw 15 line tall letter at v0,v1
-		0xF2, 0x1E, // i += v2, move to next character in logo
-		0x70, 0x08, // v0 += 0x08 (move draw location right 8 pixels)
-		0x30, 0x33, // skip next instruction if v0 == 51, we're done drawing all letters so stop looping
-		0x12, 0x0A, // jump 20A (draw command)
-		0x12, 0x14, // jump 214 (infinite loop)
-		0xC3, 0xC7, 0xCE, 0xDC, 0xF8, 0xF0, 0xE0, 0xE0, 0xE0, 0xF0, 0xF8, 0xDC, 0xCE, 0xC7, 0xC3, // K
-		0x7E, 0x7E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7E, 0x7E, // I
-		0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, // P
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7E, 0x7E, 0x7E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // -
-		0x7E, 0xFF, 0xE7, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xE7, 0xFF, 0x7E  // 8
-	};
+	//guest RAM as 256 pages of 256 bytes. Untouched and read-only pages point at shared pages (zero page,
+	//fonts, RomImage pages), writes copy a page into this core's arena first
+	MemoryPage* pages[0x100];
+	PageArena* page_arena;
+
+	//incremental Zobrist-style state hash, see GetStateHash
+	uint64_t ram_hash = 0;  //XOR of PageTerm over every page
+	uint64_t vram_hash = 0; //XOR of PixelKey over the framebuffer
+	bool vram_hash_stale = false; //set by whole screen operations, vram_hash is rebuilt by the next GetStateHash
+	bool verify_hash = false;
 
-	uint8_t RPLMemory[8] = { 0 };
+	static const uint8_t Font[80];
+	static const uint8_t LargeFont[160];
+	static const uint8_t LogoRom[97];
+	static MemoryPage* FontPage();
+
+	uint8_t RPLMemory[RPL_SIZE] = { 0 };
 	bool write_rpl = false;
 
-	uint8_t FrameBuffer[64 * 128] = { 0 };
-	uint8_t PreviousFramebuffer[128 * 64] = { 0 };
+	std::vector<uint8_t> FrameBuffer;         //base_width * base_height, resized with the system mode
+	std::vector<uint8_t> PreviousFramebuffer; //only allocated once a frontend asks for it
 	uint8_t active_plane = 1; //Bit mask for XO-chip+ graphics planes. LSB is plane 1. Planes are stacked over each other, with plane 1 on bottom.
 
 	
@@ -85,7 +54,7 @@ private:
 
 	int8_t sp = -1;
 
-	uint16_t Stack[64];
+	uint16_t Stack[16];
 	uint8_t StackSize = 12;
 
 	uint16_t EntryPoint = 0x200;
@@ -105,20 +74,90 @@ private:
 
 	uint16_t m_Run_Cycles = 0;
 
-	uint16_t Fetch(uint16_t location);
+	uint64_t seed = 0;
+	bool seed_fixed = false; //set by SetSeed, otherwise every reset draws a new seed from the clock
+	Prng rng;
+
+	uint64_t total_cycles = 0; //instructions executed since the last reset
+	std::shared_ptr<spdlog::logger> logger; //the global logger unless the owner gives the core its own
+	Profiler* profiler = nullptr; //not part of the state, clones and restores leave it alone
+	bool profiler_calls_stale = false; //the stack was replaced, the profiler's call stack is rebuilt by the next Run
+
+	uint16_t Fetch(uint16_t location) const { return (uint16_t)((ReadMem(location) << 8) | ReadMem(location + 1)); }
+	uint8_t ReadMem(uint16_t addr) const { return pages[addr >> 8]->data[addr & 0xFF]; }
+	void WriteMem(uint16_t addr, uint8_t val)
+	{
+		MemoryPage* page = pages[addr >> 8];
+		uint8_t offset = addr & 0xFF;
+		uint8_t old = page->data[offset];
+		if (old == val)
+			return;
+		if (!page->IsPrivate())
+			page = UnsharePage(addr >> 8);
+		uint64_t old_term = PageTerm(addr >> 8, page->hash);
+		page->hash ^= MemoryPage::ByteKey(offset, old) ^ MemoryPage::ByteKey(offset, val);
+		ram_hash ^= old_term ^ PageTerm(addr >> 8, page->hash);
+		page->data[offset] = val;
+	}
+	//guest loads and stores made by instructions, counted when profiling. everything else uses ReadMem/WriteMem
+	uint8_t LoadByte(uint16_t addr) { if (profiler) profiler->Read(addr); return ReadMem(addr); }
+	void StoreByte(uint16_t addr, uint8_t val) { if (profiler) profiler->Write(addr); WriteMem(addr, val); }
+	void SetPixel(uint16_t index, uint8_t val)
+	{
+		uint8_t old = FrameBuffer[index];
+		if (old == val)
+			return;
+		vram_hash ^= PixelKey(index, old) ^ PixelKey(index, val);
+		FrameBuffer[index] = val;
+	}
+	//a page's contribution depends on where it is mapped, so moving contents between pages changes the hash
+	static uint64_t PageTerm(uint8_t index, uint64_t page_hash) { return page_hash ? Mix64(page_hash ^ (0x9E3779B97F4A7C15ULL * (index + 1))) : 0; }
+	static const std::array<std::array<uint64_t, 128 * 64>, 2> PixelKeys; //random key per pixel per draw plane
+	static uint64_t PixelKey(uint16_t index, uint8_t val) { return ((val & 1) ? PixelKeys[0][index] : 0) ^ ((val & 2) ? PixelKeys[1][index] : 0); }
+	uint64_t ComputeStateHash() const;
+	uint64_t CPUHash() const;
+	void VerifyStateHash(uint64_t hash) const;
+	MemoryPage* UnsharePage(uint8_t index);
+	void MapPage(uint8_t index, MemoryPage* page); //takes over one reference to page
+	void ResizeVRAM();
+	void CopyState(const Chip8& from);
+	void SyncProfilerCalls();
+
+	Chip8(const Chip8& other); //use Clone()
 	void Decode_Execute(uint16_t opcode);
 
 public:
-	Chip8();
+	Chip8(PageArena* arena = nullptr, std::shared_ptr<spdlog::logger> core_logger = nullptr);
 	~Chip8();
+	Chip8& operator=(const Chip8&) = delete;
+
+	//Branching for search: Clone shares every RAM page with this core copy-on-write and copies the rest of the
+	//live state, Restore rewinds a core to another core's state, only remapping the pages that differ.
+	//Page refcounts are atomic, so clones may run on other threads
+	Chip8* Clone() const;
+	void Restore(const Chip8& from);
+
+	//O(1) hash of the whole machine state (RAM, framebuffer, registers, timers, stack, keys, rng), for deduplication
+	//and desync checks. RAM and framebuffer terms are kept up to date by every write. With verification on, the hash
+	//is recomputed from scratch after every Run and on every call and a mismatch asserts
+	uint64_t GetStateHash();
+	void SetHashVerify(bool enable) { verify_hash = enable; }
+	bool GetHashVerify() { return verify_hash; }
 	void Reset() { Reset(""); }
 	void Reset(std::string message);
 	void ResetMemory(bool randomize);
 	void Load(const std::vector<unsigned char> &buffer);
+	void Load(const RomImage& image); //shares the image's pages instead of copying them
+	//hot reload: writes the bytes where edited differs from the loaded rom and leaves everything else, registers,
+	//stack, framebuffer and bytes the program changed at runtime included. returns how many bytes were written
+	size_t PatchRom(const std::vector<unsigned char>& loaded, const std::vector<unsigned char>& edited);
 	void Run(uint16_t cycles);
 	uint8_t* GetVRAM();
 	uint8_t* GetPrevVRAM();
+	void WriteVRAM(uint16_t index, uint8_t val) { SetPixel(index, val); SetScreenDirty(); }
+	void RehashVRAM(); //call after writing the framebuffer through GetVRAM()
 	void SaveCurrentVRAM();
+	void ClearPrevVRAM();
 	uint8_t GetSoundTimer() { return sound_timer; }
 	uint8_t GetDelayTimer() { return delay_timer; }
 	void SetSoundTimer(uint8_t val) { sound_timer = val; return; }
@@ -132,6 +171,9 @@ public:
 	void SetHiRes() { res.hires = true; return; }
 	void SetLowRes() { res.hires = false; return; }
 	void SetKey(uint8_t key, uint8_t val) { PrevKeys[key] = Keys[key]; Keys[key] = val; return; }
+	uint16_t GetKeyMask(); //bit N set when key N is held
+	uint16_t GetPrevKeyMask();
+	void SetKeyMask(uint16_t keys, uint16_t prev_keys);
 	uint8_t* GetRegV(uint8_t index) { return &regs.v[index % 0x10]; }
 	uint16_t* GetRegI() { return &regs.i; }
 	uint16_t* GetPC() { return &pc; }
@@ -147,12 +189,27 @@ public:
 	bool ToggleDebugStepping(std::string message);
 	void SetSystemMode(SYSTEM_MODE newmode);
 	SYSTEM_MODE GetSystemMode();
-	uint8_t* GetRAM() { return &Memory[0]; }
+	uint8_t ReadRAM(uint16_t addr) const { return ReadMem(addr); }
+	void WriteRAM(uint16_t addr, uint8_t val) { WriteMem(addr, val); }
+	void CopyRAM(uint16_t addr, uint8_t* out, size_t len) const; //len may not run past 0xFFFF
+	void SetRAM(uint16_t addr, const uint8_t* in, size_t len);
+	const uint8_t* GetRAMPage(uint8_t index) const { return pages[index]->data; }
 	uint16_t GetRAMLimit() { return RamLimit; }
 	uint8_t* GetRPLMem() { return &RPLMemory[0]; }
-	void SetRPLMem(uint8_t* input) { memcpy(RPLMemory, input, 8); }
+	void SetRPLMem(uint8_t* input) { memcpy(RPLMemory, input, RPL_SIZE); }
 	bool RequestsRPLSave() { return write_rpl; }
 	void ResetRPLRequest() { write_rpl = false; }
+	uint64_t GetTotalCycles() { return total_cycles; }
+	void SetLogger(std::shared_ptr<spdlog::logger> new_logger); //null for the global logger
+	std::shared_ptr<spdlog::logger> GetLogger() { return logger; }
+	void SetProfiler(Profiler* new_profiler) { profiler = new_profiler; profiler_calls_stale = true; } //null to stop profiling, the caller owns it
+	Profiler* GetProfiler() { return profiler; }
+	void SetSeed(uint64_t new_seed) { seed = new_seed; seed_fixed = true; rng.Seed(seed); }
+	uint64_t GetSeed() { return seed; }
+	bool HasSeed() { return seed_fixed; } //false until SetSeed, resets draw a new seed from the clock until then
+	void ClearSeed() { seed_fixed = false; } //the current stream goes on, the next reset draws a new seed
+	bool SaveState(const std::string& filename);
+	bool LoadState(const std::string& filename);
 
 	struct Quirks {
 		bool vip_jump = false;                //always jump to NNN + V0
@@ -165,6 +222,16 @@ public:
 		bool schip_10_regs_read_write = false; //i is incremented 1 less than it should be, super-chip 1.0 only behavior
 	} quirks;
 
+	//errors the program has run into since the last reset. not part of the machine state, tools use them to judge
+	//whether a rom is running under the right mode and quirks
+	struct Faults {
+		uint32_t invalid_opcodes = 0;
+		uint32_t stack_errors = 0;   //call with a full stack, return with an empty one
+		uint32_t memory_errors = 0;  //register, BCD and audio pattern accesses outside of RAM
+		uint32_t sprite_errors = 0;  //sprite data read past the end of RAM
+	};
+	const Faults& GetFaults() { return faults; }
+
 	struct Resolution {
 		uint8_t base_width = 64;
 		uint8_t base_height = 32;
@@ -172,5 +239,35 @@ public:
 	} res;
 
 	uint8_t audio_pattern[16] = { 0xF0 };
+
+	//everything needed to resume execution except RAM and VRAM. plain data so it can be copied around with memcpy
+	struct CPUState {
+		Registers regs;
+		uint16_t pc;
+		int8_t sp;
+		uint8_t StackSize;
+		uint16_t Stack[16];
+		uint16_t EntryPoint;
+		uint16_t RamLimit;
+		uint8_t sound_timer;
+		uint8_t delay_timer;
+		uint8_t active_plane;
+		bool halted;
+		uint8_t Keys[16];
+		uint8_t PrevKeys[16];
+		uint8_t RPLMemory[RPL_SIZE];
+		uint8_t audio_pattern[16];
+		uint32_t rng_state[4];
+		SYSTEM_MODE mode;
+		Quirks quirks;
+		Resolution res;
+	};
+	void GetCPUState(CPUState& state) const;
+	void SetCPUState(const CPUState& state);
+
+	static const uint16_t STATE_VERSION = 3; //bump whenever the save state layout changes
+
+private:
+	Faults faults;
 };
 
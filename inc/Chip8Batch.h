@@ -0,0 +1,82 @@
+#pragma once
+#include "stdint.h"
+#include "Chip8.h"
+#include <vector>
+
+//Lockstep interpreter for many copies of a program. Each lane is a normal Chip8 core, but while a frame runs its
+//registers, I, PC and timers live here as structure-of-arrays. Every cycle the lanes are grouped by opcode: a
+//group running a plain register opcode (ALU, loads, skips, jumps, timers) is executed for all of its lanes at
+//once, with AVX2 when the CPU has it, anything else (draws, memory, stack, keys, random) runs lane by lane through
+//the core's own Decode_Execute. Lanes only fall back to scalar when they diverge onto such opcodes, and the results
+//are identical to calling Run on every core. Lanes with a profiler attached run through the core's own Run, so
+//their profile is complete, and don't count towards Stats.
+class Chip8Batch
+{
+public:
+	struct Stats {
+		uint64_t cycles = 0;          //lane cycles executed
+		uint64_t vector_cycles = 0;   //of those, executed by the SoA path
+		uint64_t groups = 0;          //opcode groups dispatched, one per cycle when every lane is in lockstep
+	};
+
+	Chip8Batch(size_t lane_count, PageArena* arena = nullptr);
+	~Chip8Batch();
+	Chip8Batch(const Chip8Batch&) = delete;
+	Chip8Batch& operator=(const Chip8Batch&) = delete;
+
+	size_t GetLaneCount() { return lanes.size(); }
+	//the lane's core. configure, load and read it freely between Run calls, lanes may even use different modes
+	Chip8* GetLane(size_t index) { return lanes[index]; }
+
+	void Run(uint16_t cycles); //one frame on every lane, same as calling Run(cycles) on each core
+	const Stats& GetStats() { return stats; }
+	void ResetStats() { stats = Stats(); }
+	static bool Vectorized(); //whether register opcodes run on AVX2, checked once at runtime
+
+private:
+	void LoadLanes(uint16_t cycles);
+	void StoreLanes();
+	void LoadLaneRegs(size_t lane);  //SoA -> core, around scalar execution
+	void StoreLaneRegs(size_t lane); //core -> SoA
+	uint16_t Fetch(size_t lane)
+	{
+		uint16_t addr = pc[lane];
+		uint8_t offset = addr & 0xFF;
+		const uint8_t* data = code[lane];
+		if ((addr >> 8) != code_page[lane] || offset == 0xFF)
+		{
+			const Chip8& core = *lanes[lane];
+			code_page[lane] = addr >> 8;
+			code[lane] = core.pages[addr >> 8]->data;
+			return core.Fetch(addr);
+		}
+		return (uint16_t)((data[offset] << 8) | data[offset + 1]);
+	}
+	bool ExecuteVector(uint16_t opcode, uint8_t config);
+	void ExecuteScalar(uint16_t opcode);
+	static uint8_t LaneConfig(const Chip8& core);
+
+	std::vector<Chip8*> lanes;
+	size_t stride; //lane count rounded up to a whole AVX2 register of bytes
+
+	//SoA state, one row per register, stride entries per row
+	std::vector<uint8_t> v[16];
+	std::vector<uint16_t> i;
+	std::vector<uint16_t> pc;
+	std::vector<uint8_t> delay_timer;
+	std::vector<uint8_t> sound_timer;
+
+	std::vector<uint16_t> remaining; //cycles left this frame, halts and vblank waits zero it like m_Run_Cycles
+	std::vector<uint32_t> executed;
+	std::vector<uint16_t> ops;       //opcode fetched by each lane this cycle
+	std::vector<uint8_t> config;     //mode and quirks that change how register opcodes behave
+	std::vector<uint8_t> pending;    //0xFF for lanes that fetched but have not executed yet this cycle
+	std::vector<uint8_t> group;      //0xFF for the lanes executing the current opcode group
+
+	//each lane's last fetched page, so fetching doesn't touch the core. only scalar opcodes can remap pages
+	static const uint16_t NO_PAGE = 0xFFFF;
+	std::vector<uint16_t> code_page;
+	std::vector<const uint8_t*> code;
+
+	Stats stats;
+};
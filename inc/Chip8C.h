@@ -0,0 +1,114 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+//C interface to the core, the stable boundary of libkip8core for other languages (Python ctypes/cffi, Rust FFI).
+//Plain C types only: handles are opaque, structs are only ever appended to, and KIP8_ABI_VERSION is bumped on any
+//incompatible change. Pointers returned by the core stay valid until the next call that runs or reloads it.
+#if defined(_WIN32)
+	#if defined(KIP8_BUILD_SHARED)
+		#define KIP8_API __declspec(dllexport)
+	#elif defined(KIP8_SHARED)
+		#define KIP8_API __declspec(dllimport)
+	#else
+		#define KIP8_API
+	#endif
+#else
+	#define KIP8_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KIP8_ABI_VERSION 1
+
+typedef struct kip8_core kip8_core;
+
+enum {
+	KIP8_MODE_CHIP8 = 0,
+	KIP8_MODE_SCHIP = 1,
+	KIP8_MODE_XOCHIP = 2
+};
+
+//same values as spdlog's levels
+enum {
+	KIP8_LOG_TRACE = 0,
+	KIP8_LOG_DEBUG = 1,
+	KIP8_LOG_INFO = 2,
+	KIP8_LOG_WARN = 3,
+	KIP8_LOG_ERROR = 4,
+	KIP8_LOG_CRITICAL = 5,
+	KIP8_LOG_OFF = 6
+};
+
+typedef struct kip8_quirks {
+	uint8_t vip_jump;
+	uint8_t vip_shifts;
+	uint8_t vip_regs_read_write;
+	uint8_t logic_flag_reset;
+	uint8_t draw_wrap;
+	uint8_t draw_vblank;
+	uint8_t schip_10_fonts;
+	uint8_t schip_10_regs_read_write;
+} kip8_quirks;
+
+typedef struct kip8_registers {
+	uint8_t v[16];
+	uint16_t i;
+	uint16_t pc;
+	int8_t sp;
+	uint8_t delay_timer;
+	uint8_t sound_timer;
+} kip8_registers;
+
+typedef void (*kip8_log_callback)(int level, const char* message, size_t length, void* user);
+
+KIP8_API uint32_t kip8_abi_version(void);
+
+//messages from cores created after this call go to callback (NUL terminated, may come from any thread running a
+//core). a null callback logs to stderr instead
+KIP8_API void kip8_set_log_callback(kip8_log_callback callback, void* user, int level);
+
+KIP8_API kip8_core* kip8_create(int mode);
+KIP8_API void kip8_destroy(kip8_core* core);
+
+//changing mode resets the core. quirks take effect right away. setting the seed restarts the random stream right
+//away, and every later load or reset starts it from the same seed. without one, each reset draws a new seed
+KIP8_API void kip8_set_mode(kip8_core* core, int mode);
+KIP8_API int kip8_get_mode(kip8_core* core);
+KIP8_API void kip8_set_quirks(kip8_core* core, const kip8_quirks* quirks);
+KIP8_API void kip8_get_quirks(kip8_core* core, kip8_quirks* quirks);
+KIP8_API void kip8_set_seed(kip8_core* core, uint64_t seed);
+
+//boots the core and loads rom at 0x200. returns 0, or -1 if the rom is empty or can't fit in 64K
+KIP8_API int kip8_load(kip8_core* core, const uint8_t* rom, size_t size);
+KIP8_API void kip8_reset(kip8_core* core);
+
+//one frame is cycles instructions plus one tick of the timers
+KIP8_API void kip8_run_frame(kip8_core* core, uint16_t cycles);
+KIP8_API void kip8_run_frames(kip8_core* core, uint32_t frames, uint16_t cycles);
+KIP8_API uint64_t kip8_get_total_cycles(kip8_core* core);
+KIP8_API int kip8_halted(kip8_core* core);
+
+KIP8_API void kip8_set_keys(kip8_core* core, uint16_t keys); //bit N set when key N is held
+
+//width * height bytes, one per pixel, bit N set when plane N+1 is lit
+KIP8_API const uint8_t* kip8_get_framebuffer(kip8_core* core, uint32_t* width, uint32_t* height);
+KIP8_API void kip8_get_registers(kip8_core* core, kip8_registers* regs);
+KIP8_API uint8_t kip8_get_sound_timer(kip8_core* core);
+KIP8_API void kip8_read_ram(kip8_core* core, uint16_t addr, uint8_t* out, size_t len);  //stops at 0xFFFF
+KIP8_API void kip8_write_ram(kip8_core* core, uint16_t addr, const uint8_t* in, size_t len);
+KIP8_API uint64_t kip8_get_state_hash(kip8_core* core);
+
+//snapshots are cores themselves: RAM is shared copy-on-write, so taking one is cheap. restore rewinds core to
+//snapshot, which stays usable. free snapshots with kip8_destroy
+KIP8_API kip8_core* kip8_snapshot(kip8_core* core);
+KIP8_API void kip8_restore(kip8_core* core, const kip8_core* snapshot);
+
+KIP8_API int kip8_save_state(kip8_core* core, const char* filename); //0 on success
+KIP8_API int kip8_load_state(kip8_core* core, const char* filename);
+
+#ifdef __cplusplus
+}
+#endif
@@ -30,6 +30,8 @@ private:
 	bool show_log;
 	bool show_audio;
 	bool show_key_remap;
+	bool show_profiler;
+	bool show_timing;
 	//custom_command_struct cmd_struct;
 	//ImTerm::terminal<ImTerm_Commands> *terminal_log;
 
@@ -38,6 +40,16 @@ private:
 
 	MemoryEditor chip8_vram_editor, chip8_ram_editor;
 
+	enum HotSpotColumn { HOT_ADDRESS, HOT_EXECUTED, HOT_READS, HOT_WRITES };
+	HotSpotColumn hot_spot_sort;
+	std::vector<uint16_t> hot_spots; //addresses in the profile, rebuilt every frame the profiler window is open
+	enum RoutineColumn { ROUTINE_NAME, ROUTINE_CALLS, ROUTINE_SELF, ROUTINE_TOTAL, ROUTINE_MAX_FRAME };
+	RoutineColumn routine_sort;
+
+	int timing_zone;
+	std::vector<FrameTimer::Event> timing_events;
+	std::vector<float> timing_durations, timing_window, timing_p50, timing_p95, timing_p99;
+
 	std::shared_ptr<ImGuiAl::BufferedLog<16384>> log = std::make_shared<ImGuiAl::BufferedLog<16384>>();
 	//std::shared_ptr<ImGuiAl::Terminal
 	void ShowCPUEditor(bool* p_open);
@@ -48,6 +60,10 @@ private:
 	void ShowVRAMWindow(bool* p_open);
 	void ShowAudioWindow(bool* p_open);
 	void ShowKeyRemapWindow(bool* p_open);
+	void ShowProfilerWindow(bool* p_open);
+	void ShowFrameTimingWindow(bool* p_open);
+
+	void AttachLog();
 
 	void ShowMenuBar();
 	void ShowMenuFile();
@@ -57,7 +73,8 @@ private:
 public:
 	DebugUI(UIState* shared_state) : fe_State(shared_state), show_regs(true), show_display(true), show_ram(false),
 		show_vram(false), show_menu_bar(true), show_stack(false), show_log(false), show_audio(false), show_key_remap(false),
-	    follow_pc(false), follow_i(false) {}
+	    show_profiler(false), show_timing(false), follow_pc(false), follow_i(false), hot_spot_sort(HOT_EXECUTED), routine_sort(ROUTINE_TOTAL),
+	    timing_zone(FrameTimer::FRAME) { AttachLog(); }
 	void Init() override;
 	void Deinit() override;
 	void Draw() override;
@@ -0,0 +1,30 @@
+#pragma once
+#include "stdint.h"
+#include <cstddef>
+#include <string>
+
+//SHA1 over memory, for hashing roms. Uses the SHA extensions (SHA-NI) when the CPU has them, a plain scalar
+//compression otherwise. Hex digests are lowercase like sha1.hpp's, so they match hashmap.json.
+class FastSha1
+{
+public:
+	static const size_t DIGEST_SIZE = 20;
+
+	FastSha1() { Reset(); }
+	void Reset();
+	void Update(const uint8_t* data, size_t len);
+	void Final(uint8_t digest[DIGEST_SIZE]); //resets for the next message
+	std::string FinalHex();
+
+	static std::string Hash(const uint8_t* data, size_t len);
+	static std::string ToHex(const uint8_t digest[DIGEST_SIZE]);
+	static bool HardwareAccelerated();
+
+private:
+	void Blocks(const uint8_t* data, size_t count);
+
+	uint32_t state[5];
+	uint8_t buffer[64];
+	size_t buffered;
+	uint64_t total;
+};
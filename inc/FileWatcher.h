@@ -0,0 +1,33 @@
+#pragma once
+#include "stdint.h"
+#include <chrono>
+#include <string>
+
+//Tells when a file changed on disk. On Linux an inotify watch sits on the file's directory, since editors often save
+//by writing a temp file and renaming it over the original, which a watch on the file itself would lose track of.
+//Elsewhere the file's size and mtime are compared every POLL_MS. Poll never blocks, call it once per frame.
+class FileWatcher
+{
+public:
+	static const int POLL_MS = 100;
+
+	FileWatcher() {}
+	~FileWatcher() { Stop(); }
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	bool Watch(const std::string& filename); //replaces the file watched before
+	void Stop();
+	bool Poll(); //true once for every time the file was written or replaced
+	const std::string& GetFilename() { return filename; }
+
+private:
+	bool Stat(uint64_t& size, int64_t& mtime);
+
+	std::string filename;
+	std::string name; //filename without its directory, what inotify events carry
+	int inotify_fd = -1;
+	uint64_t size = 0;
+	int64_t mtime = 0;
+	std::chrono::steady_clock::time_point last_check;
+};
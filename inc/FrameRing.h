@@ -0,0 +1,54 @@
+#pragma once
+#include "stdint.h"
+#include "Chip8.h"
+#include "FrameRingLayout.h"
+#include <string>
+
+//Named shared memory ring of completed frames, see FrameRingLayout.h for the layout and the seqlock protocol.
+//The emulator creates it and publishes into it, other processes open it read-only. Publishing is a copy of the
+//framebuffer and registers into the next slot and never waits on readers: a reader too slow to finish reading a
+//slot before the writer comes back around to it sees the sequence change and tries again.
+class FrameRing
+{
+public:
+	static const uint32_t DEFAULT_SLOTS = 4;
+
+	FrameRing() {}
+	~FrameRing() { Close(); }
+	FrameRing(const FrameRing&) = delete;
+	FrameRing& operator=(const FrameRing&) = delete;
+
+	//name is a POSIX shared memory name like "/kip8", on Windows it becomes a Local\ file mapping name.
+	//Create replaces a ring left behind by a writer that crashed
+	bool Create(const std::string& name, uint32_t slots = DEFAULT_SLOTS);
+	bool Open(const std::string& name);
+	void Close();
+	bool IsOpen() { return data != nullptr; }
+
+	//writer. palette is 16 0xRRGGBBAA colors
+	void Publish(Chip8* core, const uint32_t* palette);
+
+	//readers. Slot points straight into the shared memory: call BeginRead, read, and keep what was read only if
+	//EndRead agrees nothing was written in between. ReadLatest does all that and copies the newest frame into out
+	const kip8_frame_ring_header* Header() { return (const kip8_frame_ring_header*)data; }
+	const kip8_frame_slot* Slot(uint64_t frame);
+	static uint32_t BeginRead(const kip8_frame_slot* slot); //returns the sequence to hand to EndRead, waits out writes
+	static bool EndRead(const kip8_frame_slot* slot, uint32_t sequence);
+	bool ReadLatest(kip8_frame_slot& out); //false until the first frame is published
+	uint64_t GetLatest(); //frames published so far
+
+private:
+	bool Map(size_t map_size, bool writable);
+	bool CheckHeader();
+
+	uint8_t* data = nullptr;
+	size_t size = 0;
+	bool owner = false;
+	std::string shm_name;
+	uint64_t published = 0;
+#ifdef _WIN32
+	void* map_handle = nullptr;
+#else
+	int fd = -1;
+#endif
+};
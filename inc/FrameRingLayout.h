@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+
+//Layout of the shared memory frame ring the frontend publishes with --shm, for recorders, overlays and analysis
+//tools in other processes. Plain C, native byte order, and the same on every compiler: no padding anywhere.
+//
+//The ring is a kip8_frame_ring_header followed by slot_count kip8_frame_slots. Frame N goes into slot N % slot_count,
+//guarded by a seqlock: the writer makes sequence odd, writes the slot, then makes it even again, and only then
+//stores N + 1 in latest. It never waits for anyone. A reader takes latest, loads the slot's sequence (acquire),
+//skips the slot while it is odd, reads what it needs in place, and after an acquire fence loads sequence again. If it
+//changed the slot was overwritten during the read and the data must be thrown away.
+#define KIP8_FRAME_RING_MAGIC 0x474E49523850494BULL //"KIP8RING" in memory on little-endian machines
+#define KIP8_FRAME_RING_VERSION 1
+#define KIP8_FRAME_MAX_PIXELS (128 * 64)
+
+typedef struct kip8_frame_ring_header {
+	uint64_t magic;
+	uint32_t version;
+	uint32_t slot_count;
+	uint32_t slot_size;     //sizeof(kip8_frame_slot), slots start right after the header
+	uint32_t header_size;   //sizeof(kip8_frame_ring_header)
+	uint64_t latest;        //number of frames published, the newest is in slot (latest - 1) % slot_count. atomic
+	uint32_t writer_pid;    //process publishing into the ring, 0 once it has closed it
+	uint32_t reserved[9];
+} kip8_frame_ring_header;
+
+typedef struct kip8_frame_slot {
+	uint32_t sequence;      //seqlock, odd while the slot is being written. atomic
+	uint32_t reserved;
+	uint64_t frame;         //frames published before this one, so slot frame % slot_count holds it
+	uint64_t total_cycles;  //instructions executed since the rom was loaded
+	uint8_t v[16];
+	uint16_t i;
+	uint16_t pc;
+	uint16_t stack[16];
+	int8_t sp;
+	uint8_t delay_timer;
+	uint8_t sound_timer;
+	uint8_t mode;           //KIP8_MODE_* from Chip8C.h
+	uint8_t width;
+	uint8_t height;
+	uint8_t hires;
+	uint8_t halted;
+	uint32_t keys;          //bit N set when key N is held
+	uint32_t palette[16];   //0xRRGGBBAA for each pixel value
+	uint8_t vram[KIP8_FRAME_MAX_PIXELS]; //width * height used, one byte per pixel, bit N set when plane N+1 is lit
+} kip8_frame_slot;
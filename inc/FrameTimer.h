@@ -0,0 +1,80 @@
+#pragma once
+#include "stdint.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Where a frame's time goes. The frontend wraps each phase of a frame in a Zone, which records its begin and end
+//into a fixed ring of events. Recording is two clock reads and one atomic increment and never waits, so zones can
+//also be recorded from other threads (the audio callback). Readers copy events out and skip slots that were being
+//overwritten while they read them, the same way FrameRing readers do. Old events are simply overwritten.
+class FrameTimer
+{
+public:
+	enum ZoneId : uint8_t { ADVANCE_CORE, HANDLE_INPUT, DRAW_SCREEN, DRAW_UI, RENDER_PRESENT, AUDIO_CALLBACK, FRAME, ZONE_COUNT };
+	static const size_t CAPACITY = 1 << 14; //events, a power of two
+
+	struct Event {
+		int64_t begin;    //nanoseconds since the timer was created
+		int64_t end;
+		uint32_t arg;     //guest instructions for ADVANCE_CORE, otherwise 0
+		uint32_t thread;  //small per thread number, the first thread to record anything is 0
+		ZoneId zone;
+	};
+
+	struct Stats {
+		size_t count = 0;
+		float p50 = 0, p95 = 0, p99 = 0, max = 0; //milliseconds
+	};
+
+	//times the enclosing scope
+	class Zone
+	{
+	public:
+		Zone(FrameTimer& timer, ZoneId zone) : timer(timer), zone(zone), begin(timer.Now()) {}
+		~Zone() { timer.Record(zone, begin, timer.Now(), arg); }
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+		void SetArg(uint32_t value) { arg = value; }
+
+	private:
+		FrameTimer& timer;
+		ZoneId zone;
+		int64_t begin;
+		uint32_t arg = 0;
+	};
+
+	FrameTimer();
+	FrameTimer(const FrameTimer&) = delete;
+	FrameTimer& operator=(const FrameTimer&) = delete;
+
+	int64_t Now() const;
+	void Record(ZoneId zone, int64_t begin, int64_t end, uint32_t arg = 0);
+	static const char* ZoneName(ZoneId zone);
+
+	//the newest max_events events, oldest first
+	void Snapshot(std::vector<Event>& out, size_t max_events = CAPACITY) const;
+	//milliseconds each of the last events of a zone took, oldest first
+	static void Durations(const std::vector<Event>& events, ZoneId zone, std::vector<float>& out);
+	static Stats GetStats(std::vector<float> durations); //takes a copy, it gets reordered
+	//frames presented and guest instructions run per second and the average frame time, over the last second
+	void GetRates(double& fps, double& ips, double& frame_ms) const;
+
+	//Chrome trace event format, for chrome://tracing, Perfetto or speedscope
+	bool ExportChromeTrace(const std::string& filename) const;
+
+private:
+	struct Slot {
+		std::atomic<uint64_t> sequence{ 0 }; //index + 1 of the event in the slot, 0 while it's being written
+		std::atomic<int64_t> begin{ 0 };
+		std::atomic<int64_t> end{ 0 };
+		std::atomic<uint32_t> arg{ 0 };
+		std::atomic<uint32_t> thread{ 0 };
+		std::atomic<uint8_t> zone{ 0 };
+	};
+
+	int64_t epoch; //steady clock nanoseconds when the timer was created
+	std::atomic<uint64_t> head{ 0 }; //events recorded so far
+	std::unique_ptr<Slot[]> slots;
+};
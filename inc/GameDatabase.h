@@ -0,0 +1,74 @@
+#pragma once
+#include "stdint.h"
+#include "Chip8.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+
+struct GameDbGame;
+struct GameDbSlot;
+
+//hashmap.json and game_settings.json compiled into one flat table, game_db.bin, and memory-mapped at startup. A rom's
+//SHA1 goes through a perfect hash (hash and displace: a per-bucket seed picks a collision-free slot) to its
+//slot in one probe, and the slot leads to the game's settings already parsed into numbers. When either json file is
+//newer than the compiled table it is rebuilt from the json and written back, so editing the json still just works.
+class GameDatabase
+{
+public:
+	//the database's quirk options, which are Octo's and mean the opposite of some of ours. see ApplyQuirks
+	enum QuirkOption : uint8_t {
+		SHIFT = 1 << 0,      //shiftQuirks
+		LOAD_STORE = 1 << 1, //loadStoreQuirks
+		JUMP = 1 << 2,       //jumpQuirks
+		VBLANK = 1 << 3,     //vBlankQuirks
+		LOGIC = 1 << 4,      //logicQuirks
+		CLIP = 1 << 5,       //clipQuirks
+	};
+
+	struct Game {
+		std::string key;
+		std::string title;          //empty when the database has none
+		Chip8::SYSTEM_MODE mode = Chip8::SYSTEM_MODE::CHIP_8;
+		bool has_settings = false;  //false for hashes whose key has no game_settings entry
+		bool has_tickrate = false;
+		uint16_t tickrate = 9;
+		uint16_t rotation = 0;
+		uint32_t colors[4];         //0xRRGGBB: background, fill, fill 2, blend
+		uint8_t quirks_set = 0;     //QuirkOptions the entry gives a value for
+		uint8_t quirks_on = 0;      //their values
+	};
+
+	static const uint32_t DEFAULT_COLORS[4];
+
+	GameDatabase() {}
+	GameDatabase(const GameDatabase&) = delete;
+	GameDatabase& operator=(const GameDatabase&) = delete;
+
+	//maps compiled when it is up to date, otherwise compiles the json files into it first
+	bool Open(const std::string& compiled, const std::string& hashes_json, const std::string& settings_json);
+	bool Find(const std::string& sha1, Game& game);
+	bool FindDefault(Game& game); //the "default" entry, used for roms the database doesn't know
+	size_t Size() { return slot_count ? game_count : 0; }
+
+	//our quirks from the entry's Octo options. quirks should hold the mode's defaults, options the entry doesn't
+	//mention keep them
+	static void ApplyQuirks(const Game& game, Chip8::Quirks& quirks);
+
+private:
+	bool Compile(const std::string& hashes_json, const std::string& settings_json, std::vector<uint8_t>& out);
+	bool Attach(const uint8_t* image, size_t image_size);
+	void ReadGame(int32_t index, Game& game);
+
+	MappedFile file;
+	std::vector<uint8_t> built; //used instead of the mapping when the compiled table could not be written
+	const uint8_t* data = nullptr;
+	uint32_t game_count = 0;
+	uint32_t slot_count = 0;
+	uint32_t bucket_count = 0;
+	int32_t default_game = -1;
+	const GameDbGame* games = nullptr;
+	const uint16_t* seeds = nullptr;
+	const GameDbSlot* slots = nullptr;
+	const char* strings = nullptr;
+	uint32_t strings_size = 0;
+};
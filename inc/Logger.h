@@ -1,5 +1,6 @@
 #pragma once
 #include <memory>
+#include <string>
 #pragma warning(push, 0)
 #include <spdlog/spdlog.h>
 #include <spdlog/fmt/ostr.h>
@@ -10,8 +11,19 @@ class Logger
 {
 public:
 	static void Init();
+	static void InitConsole(spdlog::level::level_enum level); //stderr only, for headless tools
+
+	//a logger that shares no sinks or locks with the global one, for cores owned by a single worker thread.
+	//an empty filename discards everything
+	static std::shared_ptr<spdlog::logger> CreateWorkerLogger(const std::string& name, const std::string& filename, spdlog::level::level_enum level);
+
+	//hands every message to a plain function instead of a file or console, for programs embedding the core.
+	//level is the spdlog level, message is the unformatted text and NUL terminated
+	typedef void (*Callback)(int level, const char* message, size_t length, void* user);
+	static std::shared_ptr<spdlog::logger> CreateCallbackLogger(const std::string& name, Callback callback, void* user, spdlog::level::level_enum level);
 
 	inline static std::shared_ptr<spdlog::logger>& GetLogger() { return s_Logger; }
+	static void SetLogger(std::shared_ptr<spdlog::logger> logger) { s_Logger = logger; }
 private:
 	static std::shared_ptr<spdlog::logger> s_Logger;
 };
@@ -23,3 +35,10 @@ private:
 #define LOG_ERROR(...)	      ::Logger::GetLogger()->error(__VA_ARGS__)
 #define LOG_FATAL(...)	      ::Logger::GetLogger()->fatal(__VA_ARGS__)
 
+
+//same levels, for code that logs through its own logger instead of the global one
+#define LOG_TRACE_TO(logger, ...)	(logger)->trace(__VA_ARGS__)
+#define LOG_DEBUG_TO(logger, ...)	(logger)->debug(__VA_ARGS__)
+#define LOG_INFO_TO(logger, ...)	(logger)->info(__VA_ARGS__)
+#define LOG_WARN_TO(logger, ...)	(logger)->warn(__VA_ARGS__)
+#define LOG_ERROR_TO(logger, ...)	(logger)->error(__VA_ARGS__)
@@ -0,0 +1,29 @@
+#pragma once
+#include "stdint.h"
+#include <string>
+
+//read-only memory mapping of a whole file. the mapping stays valid until Close() or destruction
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile() { Close(); }
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& filename);
+	void Close();
+	bool IsOpen() { return data != nullptr; }
+	const uint8_t* Data() { return data; }
+	size_t Size() { return size; }
+
+private:
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* file_handle = nullptr;
+	void* map_handle = nullptr;
+#else
+	int fd = -1;
+#endif
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include "stdint.h"
+#include <string>
+#include <vector>
+#include "Chip8.h"
+
+//Input movie: per-frame keypad state plus everything needed to boot the core the same way (seed, mode, quirks,
+//RPL flags, ROM SHA1). Frames are run-length encoded, so long stretches of identical input cost one entry.
+//A CRC of the framebuffer is stored every sync_interval frames so replays can prove they are bit-identical.
+class Movie
+{
+public:
+	struct Input {
+		uint16_t keys = 0;
+		uint16_t prev_keys = 0;
+		uint16_t cycles = 0;
+		bool operator==(const Input& other) const { return keys == other.keys && prev_keys == other.prev_keys && cycles == other.cycles; }
+	};
+
+	struct ReplayResult {
+		uint32_t frames = 0;
+		uint64_t cycles = 0;
+		uint64_t microseconds = 0;
+		uint32_t vram_crc = 0;
+		int64_t first_desync_frame = -1; //-1 when every sync point matched
+	};
+
+	//resets the core and loads the rom. recording and replaying both start from this exact state
+	static void Boot(Chip8* core, const std::vector<unsigned char>& rom, uint64_t seed, Chip8::SYSTEM_MODE mode, const Chip8::Quirks& quirks, const uint8_t* rpl);
+	static void Boot(Chip8* core, const RomImage& rom, uint64_t seed, Chip8::SYSTEM_MODE mode, const Chip8::Quirks& quirks, const uint8_t* rpl);
+
+	void Begin(Chip8* core, const std::vector<unsigned char>& rom, const std::string& sha1);
+	void RecordFrame(Chip8* core, uint16_t cycles); //call before running the frame
+	void EndFrame(Chip8* core);                     //call after running the frame
+	bool Save(const std::string& filename);
+	bool Open(const std::string& filename);
+	bool Replay(Chip8* core, const std::vector<unsigned char>& rom, ReplayResult& result);
+	bool Replay(Chip8* core, const RomImage& rom, ReplayResult& result) const; //const, so one movie can be replayed from many threads
+
+	uint32_t GetFrameCount() const { return frame_count; }
+	const std::string& GetRomSHA1() const { return rom_sha1; }
+	Chip8::SYSTEM_MODE GetSystemMode() const { return mode; }
+
+private:
+	static void BootCore(Chip8* core, uint64_t seed, Chip8::SYSTEM_MODE mode, const Chip8::Quirks& quirks);
+	bool RunInputs(Chip8* core, ReplayResult& result) const;
+
+	struct Run {
+		Input input;
+		uint32_t count;
+	};
+
+	uint64_t seed = 0;
+	Chip8::SYSTEM_MODE mode = Chip8::SYSTEM_MODE::CHIP_8;
+	Chip8::Quirks quirks;
+	uint8_t rpl[Chip8::RPL_SIZE] = { 0 };
+	std::string rom_sha1;
+	uint32_t frame_count = 0;
+	uint32_t sync_interval = 60;
+	std::vector<Run> runs;
+	std::vector<uint32_t> sync_crcs;
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include "stdint.h"
+#include "Checksum.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+class PageArena;
+
+//256 bytes of guest RAM. Pages are reference counted so cores can share them copy-on-write.
+//Pages without an owner are static tables (zero page, fonts) that are never written or freed.
+struct MemoryPage {
+	static const unsigned int SIZE = 0x100;
+
+	uint8_t data[SIZE];
+	uint64_t hash = 0; //XOR of ByteKey over data, kept up to date by whoever writes the page
+	PageArena* owner = nullptr;
+	std::atomic<uint32_t> refs{ 1 };
+
+	bool IsPrivate() const { return owner && refs.load(std::memory_order_acquire) == 1; }
+
+	//Zobrist key of one byte. zero bytes have no key so zeroed memory hashes to 0
+	static uint64_t ByteKey(uint8_t offset, uint8_t val) { return val ? Mix64(((uint64_t)offset << 8 | val) ^ 0x6A09E667F3BCC908ULL) : 0; }
+	uint64_t ComputeHash() const
+	{
+		uint64_t h = 0;
+		for (unsigned int it = 0; it < SIZE; it++)
+			h ^= ByteKey((uint8_t)it, data[it]);
+		return h;
+	}
+};
+
+//Slab allocator for MemoryPages. Slabs are never returned to the system, freed pages go on a free list.
+//Safe to use from several threads, but batch workers should prefer one arena each to avoid the lock.
+class PageArena
+{
+public:
+	PageArena(size_t pages_per_slab = 256);
+	~PageArena();
+	PageArena(const PageArena&) = delete;
+	PageArena& operator=(const PageArena&) = delete;
+
+	MemoryPage* Allocate(); //returned page holds one reference, contents are undefined
+	size_t GetPagesInUse();
+	size_t GetBytesReserved();
+
+	static PageArena& Default();
+	static MemoryPage* ZeroPage();
+	static MemoryPage* AddRef(MemoryPage* page);
+	static void Release(MemoryPage* page);
+
+private:
+	void Free(MemoryPage* page);
+
+	std::mutex lock;
+	std::vector<MemoryPage*> slabs;
+	MemoryPage* free_list = nullptr; //free pages store the next pointer in their data
+	size_t slab_pages;
+	size_t in_use = 0;
+};
+
+//Immutable page image of a rom, loaded at 0x200. Cores loading the same RomImage share its full pages
+//copy-on-write, only the partial last page is copied into each core.
+class RomImage
+{
+public:
+	RomImage(const std::vector<unsigned char>& buffer, PageArena* arena = nullptr);
+	~RomImage();
+	RomImage(const RomImage&) = delete;
+	RomImage& operator=(const RomImage&) = delete;
+
+	static const uint16_t LOAD_ADDRESS = 0x200;
+
+	size_t Size() const { return size; }
+	const std::vector<MemoryPage*>& FullPages() const { return pages; }
+	const std::vector<uint8_t>& Tail() const { return tail; } //bytes after the last full page
+
+private:
+	std::vector<MemoryPage*> pages;
+	std::vector<uint8_t> tail;
+	size_t size;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include "stdint.h"
+
+//xoshiro128** (David Blackman and Sebastiano Vigna, public domain) seeded through splitmix64.
+//Each core owns one of these instead of using srand/rand, so runs are reproducible from a seed
+//and separate instances never contend on libc's shared generator.
+class Prng
+{
+public:
+	Prng(uint64_t seed = 0) { Seed(seed); }
+
+	void Seed(uint64_t seed)
+	{
+		for (int it = 0; it < 4; it += 2)
+		{
+			uint64_t z = SplitMix64(seed);
+			state[it] = (uint32_t)z;
+			state[it + 1] = (uint32_t)(z >> 32);
+		}
+	}
+
+	uint32_t Next()
+	{
+		const uint32_t result = Rotl(state[1] * 5, 7) * 9;
+		const uint32_t t = state[1] << 9;
+
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = Rotl(state[3], 11);
+
+		return result;
+	}
+
+	uint32_t state[4];
+
+private:
+	static uint32_t Rotl(const uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+
+	static uint64_t SplitMix64(uint64_t& x)
+	{
+		uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+};
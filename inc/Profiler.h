@@ -0,0 +1,104 @@
+#pragma once
+#include "stdint.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Execution profile of the guest: how often each opcode class ran, how often the instruction at each address ran and
+//how often each RAM byte was read or written by an instruction. Counters are flat arrays indexed by address, so
+//counting is an increment and a core without a profiler attached only pays for the null check. Fetches aren't
+//counted as reads, executed already says where code ran.
+//
+//The core also reports the calls and returns it performs, which drive a shadow call stack. Every instruction is
+//charged to the node of the call tree the program is in, so cycles add up per subroutine and per call path.
+class Profiler
+{
+public:
+	static const size_t ADDRESSES = 0x10000;
+	static const uint16_t TOP_LEVEL = 0xFFFF; //routine address for code not called through 2NNN
+
+	struct Routine {
+		uint16_t address = TOP_LEVEL;
+		uint64_t calls = 0;
+		uint64_t self = 0;      //instructions executed in the routine itself
+		uint64_t total = 0;     //including the routines it called
+		uint64_t max_frame = 0; //most instructions, callees included, the routine took in one frame
+	};
+
+	Profiler();
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	void Execute(uint16_t pc, uint16_t opcode)
+	{
+		executed[pc]++;
+		classes[class_of[opcode]]++;
+		instructions++;
+		CallNode& node = nodes[current];
+		node.self++;
+		if (node.frame++ == 0)
+			frame_nodes.push_back(current);
+	}
+	void Read(uint16_t addr) { reads[addr]++; }
+	void Write(uint16_t addr) { writes[addr]++; }
+	void Call(uint16_t target);
+	void Return();
+	void ResetCalls() { call_stack.clear(); current = 0; } //back to the top level, the core's stack was replaced
+	void EndFrame();
+	void Clear(); //counts only, symbols stay
+
+	uint64_t GetExecuted(uint16_t addr) const { return executed[addr]; }
+	uint64_t GetReads(uint16_t addr) const { return reads[addr]; }
+	uint64_t GetWrites(uint16_t addr) const { return writes[addr]; }
+	uint64_t GetInstructions() const { return instructions; }
+
+	//opcode classes, named the way the opcodes are documented, "8XY4" and the like. the last one is invalid opcodes
+	static size_t ClassCount();
+	static const char* ClassName(size_t index);
+	static size_t ClassOf(uint16_t opcode);
+	uint64_t GetClassCount(size_t index) const { return classes[index]; }
+
+	//every routine that ran, in no particular order
+	std::vector<Routine> GetRoutines() const;
+	size_t GetCallDepth() const { return call_stack.size(); }
+
+	//Octo symbol files name routines in GetRoutines and the folded stacks. Lines are a label and an address in either
+	//order, ":" "=" and "," are skipped and "#" starts a comment. the file is <rom>.sym or the rom's name with .sym
+	//instead of its extension
+	bool LoadSymbols(const std::string& filename);
+	bool LoadSymbolsFor(const std::string& rom_file);
+	std::string RoutineName(uint16_t address) const;
+
+	//one line per call path, "(top);main;draw-player 1234", for flamegraph.pl, speedscope and the like
+	bool ExportFolded(const std::string& filename) const;
+
+	//lcov tracefile for genhtml and coverage tools. lcov wants source lines, so the rom is written out as a listing
+	//first, one line per 16 bit word from 0x200 on, and every word is a line in the tracefile with the times an
+	//instruction at either of its bytes ran
+	bool ExportLcov(const std::string& tracefile, const std::string& listing, const std::vector<uint8_t>& rom, const std::string& test_name) const;
+
+private:
+	struct CallNode {
+		uint16_t routine;
+		uint32_t parent;
+		uint64_t self = 0;
+		uint64_t calls = 0;
+		uint64_t frame = 0; //self this frame
+	};
+
+	const uint8_t* class_of; //opcode to class index, shared by every profiler
+	std::vector<uint64_t> executed;
+	std::vector<uint64_t> reads;
+	std::vector<uint64_t> writes;
+	std::vector<uint64_t> classes;
+	uint64_t instructions = 0;
+
+	std::vector<CallNode> nodes; //the call tree, nodes[0] is the top level
+	std::unordered_map<uint64_t, uint32_t> children; //parent node << 16 | routine to node
+	std::vector<uint32_t> call_stack; //caller nodes
+	uint32_t current = 0;
+	std::vector<uint32_t> frame_nodes; //nodes that ran this frame
+	std::vector<uint64_t> routine_frame; //by routine address, only used inside EndFrame
+	std::vector<uint64_t> routine_max_frame;
+	std::unordered_map<uint16_t, std::string> symbols;
+};
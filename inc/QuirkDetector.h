@@ -0,0 +1,87 @@
+#pragma once
+#include "stdint.h"
+#include "Chip8.h"
+#include "PagedMemory.h"
+#include "ThreadPool.h"
+#pragma warning(push, 0)
+#include <json/json.h>
+#pragma warning(pop)
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Guesses quirks for roms the game database doesn't know. The rom is run headlessly under all 64 combinations of
+//the six quirks that change how programs behave, in parallel on a thread pool, with a scripted input pattern.
+//Every run is scored by what went wrong (halts, invalid opcodes, stack errors, out of bounds reads) and the best
+//config is cached by SHA1, unless every config scored the same. Start never blocks, the caller polls for the result
+//once per frame.
+class QuirkDetector
+{
+public:
+	static const int COMBINATIONS = 64;
+	static const uint32_t FRAMES = 600; //ten seconds of emulated time per combination
+
+	struct Score {
+		Chip8::Quirks quirks;
+		Chip8::Faults faults;
+		bool halted = false;
+		uint32_t frames = 0;    //frames run before halting or finishing
+		uint64_t penalty = 0;   //lower is better
+		int distance = 0;       //quirks that differ from the config the rom started with, breaks ties
+	};
+
+	struct Result {
+		std::string sha1;
+		Chip8::Quirks quirks;
+		bool conclusive = false; //false when every combination scored the same and the starting config was kept
+		std::vector<Score> scores;
+	};
+
+	QuirkDetector(unsigned int threads = 0); //0 leaves one hardware thread for the caller
+	~QuirkDetector();
+	QuirkDetector(const QuirkDetector&) = delete;
+	QuirkDetector& operator=(const QuirkDetector&) = delete;
+
+	bool LoadCache(const std::string& filename);
+	bool SaveCache();
+	//copies the cached detected quirks into quirks, leaving the others alone
+	bool Lookup(const std::string& sha1, Chip8::Quirks& quirks);
+
+	//cancels any detection still running. base is the config the rom is started with, the other quirks
+	//(schip fonts and such) are kept as they are in every combination
+	void Start(const std::vector<unsigned char>& rom, const std::string& sha1, Chip8::SYSTEM_MODE mode, const Chip8::Quirks& base, uint16_t cycles);
+	void Cancel();
+	bool IsRunning() { return job != nullptr; }
+	//true once per finished detection. conclusive results have already been added to the cache
+	bool Poll(Result& result);
+
+	static Chip8::Quirks Combination(const Chip8::Quirks& base, int index);
+	static int Index(const Chip8::Quirks& quirks); //inverse of Combination
+	static uint16_t ScriptedKeys(uint32_t frame);
+
+private:
+	struct Job {
+		std::unique_ptr<RomImage> rom;
+		std::string sha1;
+		Chip8::SYSTEM_MODE mode;
+		Chip8::Quirks base;
+		uint16_t cycles;
+		std::vector<Score> scores;
+		std::atomic<int> remaining{ COMBINATIONS };
+		std::atomic<bool> cancel{ false };
+	};
+
+	static void RunCombination(Job& job, int index, PageArena* arena, std::shared_ptr<spdlog::logger> logger);
+	void Pick(Job& job, Result& result);
+	void StartPool();
+
+	std::string cache_file;
+	Json::Value cache;
+
+	unsigned int thread_count;
+	std::vector<std::unique_ptr<PageArena>> arenas; //one per worker, outlive the pool
+	std::shared_ptr<spdlog::logger> quiet_logger;   //runs under wrong quirks log plenty of errors nobody should see
+	std::unique_ptr<ThreadPool> pool;               //started by the first detection
+	std::shared_ptr<Job> job;
+};
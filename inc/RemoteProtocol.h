@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+
+//Wire format of kip8-server, the remote control socket for driving cores from other processes. Plain C so clients in
+//any language can mirror it. Everything is little-endian and packed, there is no padding anywhere.
+//
+//A message is a u32 body length followed by the body, a sequence of commands that run in order. Each command is a
+//u8 opcode and its arguments. The reply is one message holding, for each command that ran, the u8 opcode, a u8
+//status and, when the status is KIP8_RC_OK, the command's results. An unknown opcode or truncated arguments stop the
+//message there, nothing after the failing command runs.
+//
+//Every connection gets a core of its own, which keeps its state until the client disconnects.
+#define KIP8_RC_MAX_MESSAGE (1 << 20)
+
+enum {
+	//no arguments, no results. for measuring round trips
+	KIP8_RC_PING = 0,
+
+	//u8 mode (KIP8_MODE_*), u32 size, size bytes of rom. boots the core with the current quirks and seed
+	KIP8_RC_LOAD = 1,
+
+	//u8 quirk bits (KIP8_RC_QUIRK_*), u16 instructions per frame. takes effect right away
+	KIP8_RC_SET_QUIRKS = 2,
+
+	//u64 seed, used from the next load
+	KIP8_RC_SET_SEED = 3,
+
+	//u16 frames, u16 count, count u16 key masks. frame N runs with mask N, frames past the end of the vector keep the
+	//last mask and a count of 0 keeps the keys as they are. stops early if the core halts.
+	//results: u8 halted, u16 frames run, u64 instructions executed since the last load
+	KIP8_RC_STEP = 4,
+
+	//no arguments. results: u8 width, u8 height, u16 run count, then per run u16 offset, u16 length and length
+	//bytes of framebuffer (one byte per pixel, bit N set when plane N+1 is lit). runs cover every byte that changed
+	//since the last frame sent on this connection; the first one after a load or resolution change is the whole frame
+	KIP8_RC_FRAME_DELTA = 5,
+
+	//u16 address, u16 length. results: u16 length, length bytes. stops at 0xFFFF
+	KIP8_RC_READ_RAM = 6,
+
+	//u16 address, u16 length, length bytes. stops at 0xFFFF
+	KIP8_RC_WRITE_RAM = 7,
+
+	//no arguments. results: 16 bytes V0-VF, u16 I, u16 PC, i8 SP, u8 delay timer, u8 sound timer, u64 state hash
+	KIP8_RC_GET_STATE = 8
+};
+
+enum {
+	KIP8_RC_OK = 0,
+	KIP8_RC_BAD_ARGUMENTS = 1,
+	KIP8_RC_NO_ROM = 2,
+	KIP8_RC_UNKNOWN_COMMAND = 3
+};
+
+//same order as the fields of kip8_quirks
+enum {
+	KIP8_RC_QUIRK_VIP_JUMP = 0x01,
+	KIP8_RC_QUIRK_VIP_SHIFTS = 0x02,
+	KIP8_RC_QUIRK_VIP_REGS_READ_WRITE = 0x04,
+	KIP8_RC_QUIRK_LOGIC_FLAG_RESET = 0x08,
+	KIP8_RC_QUIRK_DRAW_WRAP = 0x10,
+	KIP8_RC_QUIRK_DRAW_VBLANK = 0x20,
+	KIP8_RC_QUIRK_SCHIP_10_FONTS = 0x40,
+	KIP8_RC_QUIRK_SCHIP_10_REGS_READ_WRITE = 0x80
+};
@@ -0,0 +1,92 @@
+#pragma once
+#include "stdint.h"
+#include "Chip8.h"
+#include "PagedMemory.h"
+#include "RemoteProtocol.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//Headless server for the protocol in RemoteProtocol.h on a Unix domain socket (AF_UNIX, Windows 10 1803 and up too).
+//Every client gets a thread and a core of its own and talks to it with blocking reads, so a round trip costs two
+//context switches and nothing else: no polling, no allocations once the buffers have grown, one send per reply.
+class RemoteServer
+{
+public:
+	struct Stats {
+		uint64_t messages = 0;
+		uint64_t commands = 0;
+		uint64_t microseconds = 0; //spent handling messages, not waiting on the client
+	};
+
+	//one client's core and buffers. Handle is separate from the socket code so it can be driven in-process
+	class Session
+	{
+	public:
+		Session();
+		//runs every command in the body of one message and appends the body of the reply to reply
+		void Handle(const uint8_t* body, size_t size, std::vector<uint8_t>& reply);
+		const Stats& GetStats() { return stats; }
+
+	private:
+		uint8_t Execute(uint8_t opcode, const uint8_t*& at, const uint8_t* end, std::vector<uint8_t>& reply); //returns the status
+		void WriteFrameDelta(std::vector<uint8_t>& reply);
+
+		PageArena arena; //must outlive core
+		Chip8 core;
+		bool loaded = false;
+		uint16_t cycles = 9;
+		uint64_t seed = 0;
+		std::vector<uint8_t> last_frame; //as of the last FRAME_DELTA, empty until then
+		uint8_t last_width = 0;
+		uint8_t last_height = 0;
+		Stats stats;
+	};
+
+	RemoteServer() = default;
+	~RemoteServer();
+	RemoteServer(const RemoteServer&) = delete;
+	RemoteServer& operator=(const RemoteServer&) = delete;
+
+	bool Listen(const std::string& path); //replaces a stale socket file left at path
+	void Serve(); //accepts clients until Stop
+	void Stop();  //safe from any thread, disconnects every client
+
+private:
+	void ServeClient(intptr_t client);
+
+	std::string socket_path;
+	intptr_t listener = -1;
+	std::atomic<bool> stopping{ false };
+	std::mutex clients_lock;
+	std::condition_variable clients_done;
+	std::vector<intptr_t> clients; //connected sockets, each served by a detached thread
+};
+
+//Blocking client, for tools and benchmarks written in C++
+class RemoteClient
+{
+public:
+	RemoteClient() = default;
+	~RemoteClient();
+	RemoteClient(const RemoteClient&) = delete;
+	RemoteClient& operator=(const RemoteClient&) = delete;
+
+	bool Connect(const std::string& path);
+	void Close();
+	//sends one message and waits for the reply. body and reply are message bodies, without the length prefix
+	bool Call(const std::vector<uint8_t>& body, std::vector<uint8_t>& reply);
+
+	//little-endian encoders for building bodies
+	static void Put8(std::vector<uint8_t>& out, uint8_t val) { out.push_back(val); }
+	static void Put16(std::vector<uint8_t>& out, uint16_t val);
+	static void Put32(std::vector<uint8_t>& out, uint32_t val);
+	static void Put64(std::vector<uint8_t>& out, uint64_t val);
+
+private:
+	intptr_t connection = -1;
+	std::vector<uint8_t> buffer;
+};
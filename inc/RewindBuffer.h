@@ -0,0 +1,50 @@
+#pragma once
+#include "stdint.h"
+#include <deque>
+#include <vector>
+#include "Chip8.h"
+
+//Ring of per-frame core snapshots for hold-to-rewind.
+//Every keyframe_interval frames a full copy of RAM and VRAM is stored. Frames in between only store the
+//RAM pages and framebuffer rows that differ from that keyframe, so restoring any frame is keyframe + one delta.
+//Oldest keyframe groups are dropped once the memory budget is exceeded.
+class RewindBuffer
+{
+public:
+	RewindBuffer(size_t budget_bytes = 32 * 1024 * 1024, unsigned int keyframe_interval = 120);
+	void Capture(Chip8* core);
+	bool Rewind(Chip8* core); //steps the core back one captured frame. returns false when there is no older frame
+	void Clear();
+	size_t GetFrameCount() { return frames.size(); }
+	size_t GetMemoryUsed() { return memory_used; }
+
+private:
+	static const unsigned int PAGE_SIZE = MemoryPage::SIZE;
+
+	struct Frame {
+		Chip8::CPUState cpu;
+		bool keyframe = false;
+		std::vector<uint16_t> pages; //RAM page numbers stored in data, in order
+		std::vector<uint8_t> rows;   //framebuffer rows stored in data after the pages, in order
+		std::vector<uint8_t> data;
+		size_t Bytes() { return sizeof(Frame) + (pages.capacity() * sizeof(uint16_t)) + rows.capacity() + data.capacity(); }
+	};
+
+	void Restore(Chip8* core, size_t index);
+	void ApplyDelta(Chip8* core, Frame& frame, uint32_t ram_size, uint32_t row_bytes);
+	void EvictOldest();
+
+	std::deque<Frame> frames;
+	size_t budget;
+	size_t memory_used = 0;
+	unsigned int interval;
+	unsigned int frames_since_key = 0;
+	bool need_keyframe = true;
+
+	//copy of the most recent keyframe, the reference for new delta frames
+	std::vector<uint8_t> key_ram;
+	std::vector<uint8_t> key_vram;
+	uint16_t key_ram_limit = 0;
+	uint8_t key_width = 0;
+	uint8_t key_height = 0;
+};
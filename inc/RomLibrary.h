@@ -0,0 +1,51 @@
+#pragma once
+#include "stdint.h"
+#include "GameDatabase.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Index of every rom under a directory tree, joined with hashmap.json and game_settings.json. Files are identified by
+//(path, size, mtime) and only new or changed ones are hashed, spread over a thread pool, so rescanning an archive
+//that didn't change costs one directory walk. The index is a small binary file, rom_library.idx for the frontend.
+class RomLibrary
+{
+public:
+	struct Entry {
+		std::string path;
+		uint64_t size = 0;
+		int64_t mtime = 0;    //filesystem clock ticks, only ever compared for equality
+		std::string sha1;
+		std::string key;      //game database key, empty for roms the database doesn't know
+		std::string title;    //from the game database, the file name for unknown roms
+		std::string platform; //chip8, schip or xochip. empty when unknown
+	};
+
+	struct ScanStats {
+		size_t files = 0;
+		size_t hashed = 0;   //new or changed since the last scan
+		size_t reused = 0;   //hash taken from the index
+		size_t removed = 0;  //in the index but gone from disk
+		size_t failed = 0;   //could not be read
+		double milliseconds = 0;
+	};
+
+	RomLibrary(unsigned int threads = 0); //0 uses one worker per hardware thread
+
+	bool LoadIndex(const std::string& filename);
+	bool SaveIndex();
+	//walks root and replaces the entries with what is there now. saves the index when anything changed
+	bool Scan(const std::string& root, ScanStats* stats = nullptr);
+	//fills key, title and platform from the database, call again whenever the database changes
+	void Join(GameDatabase& database);
+
+	const std::vector<Entry>& GetEntries() { return entries; }
+	const Entry* Find(const std::string& path);
+	static bool IsRomFile(const std::string& path);
+
+private:
+	unsigned int thread_count;
+	std::string index_file;
+	std::vector<Entry> entries; //sorted by path
+	std::unordered_map<std::string, size_t> by_path;
+};
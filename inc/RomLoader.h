@@ -0,0 +1,51 @@
+#pragma once
+#include "stdint.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Reads a rom in one pass over a memory mapping: every chunk is hashed while it is copied out, so the file is
+//opened once and each byte touched once. Roms past ASYNC_SIZE (big XO-CHIP roms) are read on a background
+//thread, the caller polls once per frame and swaps the rom in at a frame boundary.
+class RomLoader
+{
+public:
+	static const size_t MAX_SIZE = 0x10000 - 0x200; //anything bigger can't fit in any mode's memory
+	static const size_t ASYNC_SIZE = 16 * 1024;
+	static const size_t CHUNK_SIZE = 16 * 1024;     //hashed and copied together, stays in cache between the two
+
+	struct Rom {
+		std::string filename;
+		std::vector<unsigned char> data;
+		std::string sha1;
+		std::string error; //empty when the rom was read
+	};
+
+	RomLoader() {}
+	~RomLoader() { Cancel(); }
+	RomLoader(const RomLoader&) = delete;
+	RomLoader& operator=(const RomLoader&) = delete;
+
+	static bool Read(const std::string& filename, Rom& rom);
+
+	//cancels any load still running. small roms are read before Start returns, either way the rom comes from Poll
+	void Start(const std::string& filename);
+	void Cancel();
+	bool IsLoading() { return job != nullptr; }
+	//true once per finished load, successful or not
+	bool Poll(Rom& rom);
+
+private:
+	struct Job {
+		Rom rom;
+		std::thread thread;
+		std::atomic<bool> done{ false };
+		std::atomic<bool> cancel{ false };
+	};
+
+	static bool Copy(const uint8_t* data, size_t size, Rom& rom, const std::atomic<bool>* cancel);
+
+	std::unique_ptr<Job> job;
+};
@@ -1,5 +1,7 @@
 #pragma once
+#include <atomic>
 #include <map>
+#include <thread>
 #include <vector>
 #pragma warning(push, 0)
 #include <SDL2/SDL.h>
@@ -15,6 +17,19 @@
 #include "DebugUI.h"
 #include "Chip8.h"
 #include "Logger.h"
+#include "GameDatabase.h"
+#include "RewindBuffer.h"
+#include "Movie.h"
+#include "Profiler.h"
+#include "QuirkDetector.h"
+#include "RomLibrary.h"
+#include "RomLoader.h"
+#include "SaveWriter.h"
+#include "StartupTimeline.h"
+#include "ThumbnailCache.h"
+#include "FileWatcher.h"
+#include "FrameRing.h"
+#include "FrameTimer.h"
 #include "UIState.h"
 
 class SDLFrontEnd
@@ -33,19 +48,41 @@ public:
 	bool Run();
 	void SetRunCycles(int cycles) { m_State.run_Cycles = cycles; return; }
 	void Load(std::string filename);
+	bool ExportFrames(const std::string& shm_name); //publish every frame to a shared memory ring for other processes
+	void ProfileStartup() { m_Profile_Startup = true; } //log the startup timeline once startup is finished
+	void SetLibrary(const std::string& root, bool show_launcher); //directory of roms the launcher lists
 	UIState* GetState() { return &m_State; }
+	bool ExportTrace(const std::string& filename) { return m_Frame_Timer.ExportChromeTrace(filename); }
 
 private:
 	bool debug_interface;
 	SDL_Rect m_Pixel;
 	unsigned int m_Res_Width;
 	unsigned int m_Res_Height;
-	uint8_t SuperChipRPLData[8] = { 0 };
 	ParentUI* imgui_UI;
-	SDL_AudioDeviceID m_Audio_Device;
+	bool m_UI_Ready = false; //the basic UI only builds its ImGui context once the mouse first comes over the window
+	SDL_AudioDeviceID m_Audio_Device = 0;
+	bool m_Audio_Started = false; //the audio device is opened after the first frame is on screen
+	uint64_t m_Frames_Presented = 0;
+	bool m_Profile_Startup = false;
+	std::thread m_Databases; //opens the game database and quirk cache while the window is being created
 	stopwatch::Stopwatch m_Timer;
+	FrameTimer m_Frame_Timer;
 	const double m_FrameMicroSeconds = 1000000.0 / 60.0; //microseconds per frame length
 	double time_accumulator = 0.0;
+	RewindBuffer m_Rewind;
+	Movie m_Movie;
+	GameDatabase m_GameDB;
+	QuirkDetector m_QuirkDetector;
+	RomLoader m_RomLoader;
+	RomLibrary m_Library;
+	ThumbnailCache m_Thumbnails;
+	std::thread m_Library_Scan;
+	std::atomic<bool> m_Library_Scanned{ false };
+	FrameRing m_FrameRing;
+	SaveWriter m_Saves;
+	FileWatcher m_Watcher; //the loaded rom, for hot reload
+	std::unique_ptr<Profiler> m_Profiler; //allocated the first time profiling is turned on
 	
 	//breaking out input into 2 maps lets us change the user's input keys or the emulated key layout without affecting both
 	std::map<uint8_t, uint8_t> keymap_internal; //maps from internal key matrix to current key layout
@@ -58,17 +95,30 @@ private:
 	void init();
 	int  initVideo();
 	int  initAudio();
+	void initUI();
+	void WaitForDatabases();
 	void deinit();
 	void deinitAudio();
 	void deinitVideo();	
 	void AdvanceCore();
+	void RewindCore();
 	void DrawScreen();
 	void HandleInput();
 	void ResetResolution();
 	void ResetDisplayTexture();
 	void PersistRPL();
+	void SaveState();
+	void LoadState();
+	void StartRecording();
+	void StopRecording();
+	void PollRomLoad();
+	void PollQuirkDetection();
+	void PollHotReload();
+	void PollProfiler();
+	void PollLauncher();
+	void PublishFrame();
 	void SetTitle();
-	void LoadPrefs(std::string key);
+	void LoadPrefs(const GameDatabase::Game& game);
 	void SavePrefs(std::string key);
 	void SetInternalKeys(UIState::KeyLayout layout);
 	void SetMappedKey(SDL_Scancode scancode, uint8_t index);
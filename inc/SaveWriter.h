@@ -0,0 +1,41 @@
+#pragma once
+#include "stdint.h"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Writes small save files (RPL flags) on a background thread. Write only replaces what is queued for a file, so a rom
+//calling FX75 every frame costs one write per COALESCE_MS at most, and contents identical to the last ones written
+//are skipped. Files go to <name>.tmp first and are renamed over the old one, so a crash leaves the old contents or
+//the new ones, never a mix.
+class SaveWriter
+{
+public:
+	static const int COALESCE_MS = 250;
+
+	SaveWriter();
+	~SaveWriter(); //writes whatever is still queued
+	SaveWriter(const SaveWriter&) = delete;
+	SaveWriter& operator=(const SaveWriter&) = delete;
+
+	void Write(const std::string& filename, std::vector<uint8_t> data);
+	void Flush(); //blocks until everything queued so far is on disk, call before reading a file back
+
+	static bool WriteAtomic(const std::string& filename, const std::vector<uint8_t>& data);
+
+private:
+	void WriterLoop();
+
+	std::mutex lock;
+	std::condition_variable wake;    //a file was queued, a flush was asked for or the writer is stopping
+	std::condition_variable flushed; //the queue drained
+	std::map<std::string, std::vector<uint8_t>> queued;
+	std::map<std::string, std::vector<uint8_t>> written; //only touched by the writer thread
+	bool busy = false;     //a batch is being written
+	bool flushing = false;
+	bool stopping = false;
+	std::thread writer;
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+
+//When each part of startup ran, in milliseconds since the program was loaded. Phases can be recorded from any thread
+//and the ones that ran in parallel show up overlapping. Recording is always on and costs a clock read, Print is what
+//--startup-profile asks for
+class StartupTimeline
+{
+public:
+	//times the enclosing scope
+	class Phase
+	{
+	public:
+		Phase(const char* name) : name(name), begin(Now()) {}
+		~Phase() { Record(name, begin, Now()); }
+		Phase(const Phase&) = delete;
+		Phase& operator=(const Phase&) = delete;
+
+	private:
+		const char* name;
+		double begin;
+	};
+
+	static double Now(); //milliseconds since launch
+	static void Record(const char* name, double begin, double end);
+	static void Mark(const char* name) { double now = Now(); Record(name, now, now); }
+	static void Print(); //logs every phase recorded so far, in the order they started
+};
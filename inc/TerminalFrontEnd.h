@@ -0,0 +1,85 @@
+#pragma once
+#include "stdint.h"
+#include "Chip8.h"
+#include "GameDatabase.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+//Frontend for terminals, for watching cores over SSH on machines without a display. Every character cell shows two
+//pixels stacked with the upper half block, foreground for the top pixel and background for the bottom one, in
+//truecolor or the 256 color palette. Only cells that changed since the last frame are sent, with the shortest
+//cursor move that reaches them and color changes only when the color differs from the one already set, so an
+//idle screen costs nothing and a moving sprite a few dozen bytes.
+//
+//Input is raw stdin. Terminals only report key presses, so a key counts as held for a few frames after each press
+//and the terminal's key repeat keeps it held.
+class TerminalFrontEnd
+{
+public:
+	enum class ColorMode { AUTO, PALETTE_256, TRUECOLOR };
+	struct Color { uint8_t r = 0, g = 0, b = 0; };
+
+	TerminalFrontEnd(Chip8* core, ColorMode color_mode);
+	~TerminalFrontEnd();
+	TerminalFrontEnd(const TerminalFrontEnd&) = delete;
+	TerminalFrontEnd& operator=(const TerminalFrontEnd&) = delete;
+
+	bool Load(const std::string& filename);
+	void SetRunCycles(int cycles) { run_cycles = cycles; }
+	void SetRenderRate(int fps) { render_interval = fps > 0 ? std::max(1, 60 / fps) : 1; }
+	void SetKeyHold(int frames) { key_hold = (uint8_t)std::min(std::max(frames, 1), 255); }
+	void SetBell(bool enabled) { bell = enabled; }
+	bool Run(); //one pass of input, emulation and drawing, sleeps until the next frame is due. false to quit
+
+	Color screen_Colors[16]; //same defaults and database entries as the SDL frontend
+
+private:
+	void InitTerminal();
+	void RestoreTerminal();
+	void LoadPrefs(const GameDatabase::Game& game, Chip8::SYSTEM_MODE& mode, Chip8::Quirks& quirks);
+	void BuildColorCodes();
+	void HandleInput();
+	void ParseInput(const uint8_t* bytes, size_t count);
+	void AdvanceCore();
+	void Draw();
+	void DrawStatus();
+	void Flush();
+	void MoveCursor(int row, int col);
+	void AppendNumber(int val);
+
+	Chip8* core;
+	ColorMode colors;
+	bool running = true;
+	bool paused = false;
+	bool bell = false;
+	int run_cycles = 9;
+	int render_interval = 1; //draw every Nth frame
+	uint8_t key_hold = 8;    //frames a key stays held after a press
+	uint8_t key_timers[16] = { 0 };
+	uint8_t prev_sound_timer = 0;
+
+	GameDatabase game_db;
+	std::string title;
+
+	//what the terminal shows: cell per two pixels (top | bottom << 8, 0xFFFF when unknown), the colors set and where
+	//the cursor is, so every frame only sends the difference
+	std::vector<uint16_t> cells;
+	int screen_width = 0;
+	int screen_height = 0;
+	int set_fg = -1;
+	int set_bg = -1;
+	int cursor_row = -1;
+	int cursor_col = -1;
+	std::string fg_codes[16];
+	std::string bg_codes[16];
+	std::string status;
+	std::string out;
+
+	std::chrono::steady_clock::time_point next_frame;
+	std::chrono::steady_clock::time_point fps_start;
+	uint64_t frame_count = 0;
+	int frames_this_second = 0;
+	int fps = 0;
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include "stdint.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Work-stealing thread pool. Every worker owns a deque: it pops its own newest task and, once empty, steals the
+//oldest task from the other workers. Tasks submitted from a worker go to that worker's deque, tasks submitted
+//from outside are spread round robin, so long jobs queued on one worker get picked up by idle ones.
+class ThreadPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	ThreadPool(unsigned int threads = 0); //0 uses one worker per hardware thread
+	~ThreadPool();                        //finishes every queued task first
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Submit(Task task);
+	void Wait(); //blocks until every submitted task has finished
+	unsigned int GetThreadCount() const { return (unsigned int)workers.size(); }
+	uint64_t GetStealCount() const { return steals.load(std::memory_order_relaxed); }
+
+	//index of the calling worker in the pool running it, or -1 outside of a pool. lets tasks pick per-worker
+	//resources (arenas, loggers) without any locking
+	static int CurrentWorker();
+
+private:
+	struct Queue {
+		std::mutex lock;
+		std::deque<Task> tasks;
+	};
+
+	void WorkerLoop(unsigned int index);
+	bool PopLocal(unsigned int index, Task& task);
+	bool Steal(unsigned int index, Task& task);
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+
+	std::mutex wake_lock;
+	std::condition_variable wake; //a task was queued, or the pool is stopping
+	std::condition_variable idle; //pending dropped to 0
+	size_t queued = 0;            //tasks sitting in a deque, guarded by wake_lock
+	std::atomic<size_t> pending{ 0 }; //queued plus running
+	std::atomic<size_t> next_queue{ 0 };
+	std::atomic<uint64_t> steals{ 0 };
+	bool stopping = false;
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include "stdint.h"
+#include "GameDatabase.h"
+#include "PagedMemory.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Animated thumbnails for the rom launcher. A rom is run headlessly for a few seconds of emulated time with the same
+//scripted key taps the quirk detector uses, and a strip of frames is kept at 64x32, one palette index (0-3) per
+//pixel, along with the game database's colors. Strips are cached on disk at 2 bits per pixel, <sha1>.thm in the
+//thumbnail directory. Get never blocks: loading and rendering run on a thread pool, newest requests first, and
+//requests the launcher stops asking for (scrolled out of view) are dropped by Trim before they cost anything.
+class ThumbnailCache
+{
+public:
+	static const int WIDTH = 64;
+	static const int HEIGHT = 32;
+	static const int FRAMES = 8;
+	static const uint32_t FIRST_FRAME = 60;     //skip the first second, most roms are still clearing the screen
+	static const uint32_t FRAME_INTERVAL = 30;  //one captured frame every half second
+	static const size_t MEMORY_LIMIT = 512;     //thumbnails kept in memory, least recently used go first
+
+	struct Thumbnail {
+		uint32_t colors[4];          //0xRRGGBB per palette index
+		std::vector<uint8_t> pixels; //FRAMES frames of WIDTH * HEIGHT palette indices
+		const uint8_t* Frame(int frame) const { return &pixels[(size_t)(frame % FRAMES) * WIDTH * HEIGHT]; }
+	};
+
+	ThumbnailCache(unsigned int threads = 0); //0 leaves one hardware thread for the caller
+	~ThumbnailCache();
+	ThumbnailCache(const ThumbnailCache&) = delete;
+	ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+	//database can be null, then every rom is rendered as a CHIP-8 rom with the default colors. it has to outlive
+	//the cache
+	bool Open(const std::string& directory, GameDatabase* database);
+	//the thumbnail of the rom at path, or null while it is being loaded or rendered
+	std::shared_ptr<const Thumbnail> Get(const std::string& path, const std::string& sha1);
+	//call once per frame after the frame's Gets. queued requests that weren't asked for again are dropped, and
+	//thumbnails beyond MEMORY_LIMIT are evicted
+	void Trim();
+	size_t Pending() { return pending.size(); }
+
+	bool Render(const std::vector<unsigned char>& rom, const std::string& sha1, Thumbnail& thumbnail, PageArena* arena, const std::atomic<bool>* cancel);
+	static bool Save(const std::string& filename, const Thumbnail& thumbnail);
+	static bool Load(const std::string& filename, Thumbnail& thumbnail);
+
+private:
+	struct Request {
+		std::string path;
+		std::string sha1;
+		std::atomic<bool> cancel{ false };
+		std::atomic<bool> done{ false };
+		std::shared_ptr<Thumbnail> thumbnail; //null when the rom could not be read, written before done
+		uint64_t wanted = 0; //the last generation Get asked for it
+	};
+	struct Cached {
+		std::shared_ptr<const Thumbnail> thumbnail;
+		uint64_t used = 0;
+	};
+
+	void Build(Request& request);
+	std::string FileFor(const std::string& sha1) { return directory + "/" + sha1 + ".thm"; }
+
+	unsigned int thread_count;
+	std::string directory;
+	GameDatabase* database = nullptr;
+	std::vector<std::unique_ptr<PageArena>> arenas; //one per worker
+	std::shared_ptr<spdlog::logger> quiet_logger;
+	std::unique_ptr<ThreadPool> pool;
+	uint64_t generation = 1;
+	std::unordered_map<std::string, std::shared_ptr<Request>> pending; //by sha1
+	std::unordered_map<std::string, Cached> cached;
+};
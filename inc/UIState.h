@@ -5,6 +5,9 @@
 #include "portable-file-dialogs.h"
 #pragma warning(pop)
 #include "Chip8.h"
+#include "FrameTimer.h"
+#include "RomLibrary.h"
+#include "ThumbnailCache.h"
 
 typedef struct uistate {
 	bool running{ true };
@@ -32,6 +35,21 @@ typedef struct uistate {
 	std::vector<unsigned char> file_data;
 	std::shared_ptr<pfd::open_file> open_File;
 	std::string last_File{ "" };
+	std::string rom_Hash{ "" };
+	bool save_State{ false };
+	bool load_State{ false };
+	bool rewind_Enabled{ true };
+	bool rewinding{ false };
+	bool toggle_Recording{ false };
+	bool recording{ false };
+	bool detect_Quirks{ true };     //guess quirks for roms missing from hashmap.json
+	bool detecting_Quirks{ false };
+	bool hot_Reload{ true };        //patch the running rom when its file changes on disk
+	bool profiling{ false };        //count executions and memory accesses, see Profiler
+	Profiler* profiler{ nullptr };  //null until profiling is first turned on
+	bool ram_Heatmap{ true };       //color the RAM window by the profile
+	FrameTimer* frame_Timer{ nullptr }; //timing of the frontend's frame phases, always set
+	bool show_HUD{ false };         //FPS, guest instructions per second and frame time over the display
 
 	enum KeyLayout { VIP, DREAM, DIGITRAN };
 	KeyLayout selected_Key_Layout{ VIP };
@@ -41,8 +59,13 @@ typedef struct uistate {
 	bool wait_for_remap_input{ false };
 	int8_t remap_key_index{ -1 };
 
-	Json::Value games_hashes;
-	Json::Value game_settings;
 	std::string game_title{ "" };
 
+	bool show_Launcher{ false };
+	std::string library_Root{ "" };         //directory the launcher lists, empty when there is none
+	bool library_Scanning{ false };
+	RomLibrary* library{ nullptr };         //null until the first scan finished
+	ThumbnailCache* thumbnails{ nullptr };
+	std::string launch_File{ "" };          //picked in the launcher, loaded by the frontend
+
 } UIState;
\ No newline at end of file
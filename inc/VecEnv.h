@@ -0,0 +1,85 @@
+#pragma once
+#include "stdint.h"
+#include "Chip8.h"
+#include "Chip8Batch.h"
+#include "PagedMemory.h"
+#include <vector>
+
+//Vectorized environment for learning agents: N copies of one rom stepped in lockstep on a Chip8Batch.
+//Actions map to keypad masks, rewards and episode ends are read from guest RAM, and observations are written in
+//place into one contiguous N x H x W byte buffer (pixel values are the framebuffer's plane bits). After the
+//constructor nothing allocates per step.
+class VecEnv
+{
+public:
+	//reward += scale * value, or scale * (value - value before the step) for delta terms
+	struct RewardTerm {
+		uint16_t address = 0;
+		uint8_t size = 1;        //1 or 2 bytes, big endian like the guest
+		float scale = 1.0f;
+		bool delta = true;
+	};
+
+	//the episode terminates when the byte at address compares true against value
+	struct DoneTerm {
+		enum Compare { EQUAL, NOT_EQUAL, LESS, GREATER };
+		uint16_t address = 0;
+		uint8_t value = 0;
+		Compare compare = EQUAL;
+	};
+
+	struct Config {
+		Chip8::SYSTEM_MODE mode = Chip8::SYSTEM_MODE::CHIP_8;
+		Chip8::Quirks quirks;
+		uint16_t cycles = 9;               //per frame
+		uint32_t frame_skip = 4;           //frames per step, the action is held for all of them
+		uint8_t downsample = 1;            //1: 64x128 observations, 2: 32x64, 4: 16x32
+		bool auto_reset = true;            //finished envs restart inside Step, their observation is the new episode's
+		uint32_t max_episode_frames = 0;   //truncate episodes after this many frames, 0 for no limit
+		std::vector<uint16_t> actions;     //key mask per action. empty: action 0 presses nothing, action k presses key k-1
+		std::vector<RewardTerm> rewards;
+		std::vector<DoneTerm> dones;       //a halted core always ends its episode
+	};
+
+	VecEnv(const RomImage& rom, size_t env_count, const Config& config);
+
+	void Reset(const uint64_t* seeds);     //every env, seeds may be null for 0..N-1
+	void Reset(size_t env, uint64_t seed);
+	void Step(const uint32_t* actions);    //one action per env, out of range actions press nothing
+
+	size_t GetEnvCount() { return env_count; }
+	size_t GetActionCount() { return config.actions.size(); }
+	size_t GetObservationWidth() { return obs_width; }
+	size_t GetObservationHeight() { return obs_height; }
+
+	//filled in place by Reset and Step, valid until the VecEnv is destroyed
+	const uint8_t* GetObservations() { return observations.data(); } //env_count * height * width
+	const float* GetRewards() { return rewards.data(); }
+	const uint8_t* GetTerminals() { return terminals.data(); }     //ended by a DoneTerm or a halt
+	const uint8_t* GetTruncations() { return truncations.data(); } //ended by max_episode_frames
+	const uint32_t* GetEpisodeFrames() { return episode_frames.data(); } //frames into the current episode
+
+	Chip8* GetCore(size_t env) { return batch.GetLane(env); }
+	const Chip8Batch::Stats& GetBatchStats() { return batch.GetStats(); }
+
+private:
+	int32_t ReadTerm(Chip8* core, const RewardTerm& term);
+	bool CheckDone(Chip8* core);
+	void WriteObservation(size_t env);
+
+	const RomImage& rom;
+	size_t env_count;
+	Config config;
+	Chip8Batch batch;
+
+	size_t obs_width, obs_height;
+	std::vector<uint8_t> observations;
+	std::vector<float> rewards;
+	std::vector<uint8_t> terminals;
+	std::vector<uint8_t> truncations;
+	std::vector<uint8_t> finished;   //ended during the current step, later frames don't count
+	std::vector<uint32_t> episode_frames;
+	std::vector<uint64_t> seeds;     //seed of each env's current episode
+	std::vector<uint16_t> keys;      //held keys, SetKeyMask wants last frame's as well
+	std::vector<int32_t> term_values; //env_count * rewards.size(), value of each delta term at the last frame
+};
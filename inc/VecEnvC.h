@@ -0,0 +1,55 @@
+#pragma once
+#include "Chip8C.h"
+
+//C interface to VecEnv for bindings (ctypes, cffi, etc). Buffers returned by the getters are owned by the env,
+//filled in place by every reset/step and stay valid until kip8_vecenv_destroy.
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct kip8_vecenv kip8_vecenv;
+
+enum {
+	KIP8_DONE_EQUAL = 0,
+	KIP8_DONE_NOT_EQUAL = 1,
+	KIP8_DONE_LESS = 2,
+	KIP8_DONE_GREATER = 3
+};
+
+typedef struct kip8_vecenv_config {
+	int mode;                     //KIP8_MODE_* from Chip8C.h
+	uint16_t cycles;              //per frame
+	uint32_t frame_skip;          //frames per step
+	uint8_t downsample;           //1, 2 or 4
+	uint8_t auto_reset;
+	uint32_t max_episode_frames;  //0 for no limit
+	const uint16_t* actions;      //key mask per action, null for the default 17 actions
+	size_t action_count;
+} kip8_vecenv_config;
+
+//fills in the same defaults as the C++ Config
+KIP8_API void kip8_vecenv_default_config(kip8_vecenv_config* config);
+
+//rom is copied. returns null if the rom is empty or too large
+KIP8_API kip8_vecenv* kip8_vecenv_create(const uint8_t* rom, size_t rom_size, size_t env_count, const kip8_vecenv_config* config);
+KIP8_API void kip8_vecenv_destroy(kip8_vecenv* env);
+
+//reward and done terms, add them before the first reset
+KIP8_API void kip8_vecenv_add_reward(kip8_vecenv* env, uint16_t address, uint8_t size, float scale, int delta);
+KIP8_API void kip8_vecenv_add_done(kip8_vecenv* env, uint16_t address, uint8_t value, int compare);
+
+KIP8_API void kip8_vecenv_reset(kip8_vecenv* env, const uint64_t* seeds); //seeds may be null
+KIP8_API void kip8_vecenv_step(kip8_vecenv* env, const uint32_t* actions);
+
+KIP8_API size_t kip8_vecenv_env_count(kip8_vecenv* env);
+KIP8_API size_t kip8_vecenv_action_count(kip8_vecenv* env);
+KIP8_API size_t kip8_vecenv_obs_width(kip8_vecenv* env);
+KIP8_API size_t kip8_vecenv_obs_height(kip8_vecenv* env);
+KIP8_API const uint8_t* kip8_vecenv_observations(kip8_vecenv* env);
+KIP8_API const float* kip8_vecenv_rewards(kip8_vecenv* env);
+KIP8_API const uint8_t* kip8_vecenv_terminals(kip8_vecenv* env);
+KIP8_API const uint8_t* kip8_vecenv_truncations(kip8_vecenv* env);
+
+#ifdef __cplusplus
+}
+#endif
@@ -86,6 +86,7 @@ struct MemoryEditor
     ImU8            (*ReadFn)(const ImU8* data, size_t off);    // = 0      // optional handler to read bytes.
     void            (*WriteFn)(ImU8* data, size_t off, ImU8 d); // = 0      // optional handler to write bytes.
     bool            (*HighlightFn)(const ImU8* data, size_t off);//= 0      // optional handler to return Highlight property (to support non-contiguous highlighting).
+    ImU32           (*BgColorFn)(const ImU8* data, size_t off); // = 0      // optional handler to return a per-byte background color, 0 for none. drawn under highlights (heatmaps).
 
     // [Internal State]
     bool            ContentsWidthChanged;
@@ -117,6 +118,7 @@ struct MemoryEditor
         ReadFn = NULL;
         WriteFn = NULL;
         HighlightFn = NULL;
+        BgColorFn = NULL;
 
         // State/Internals
         ContentsWidthChanged = false;
@@ -287,6 +289,17 @@ struct MemoryEditor
                     byte_pos_x += (float)(n / OptMidColsCount) * s.SpacingBetweenMidCols;
                 ImGui::SameLine(byte_pos_x);
 
+                // Draw per-byte background
+                if (BgColorFn)
+                {
+                    ImU32 bg_color = BgColorFn(mem_data, addr);
+                    if (bg_color != 0)
+                    {
+                        ImVec2 pos = ImGui::GetCursorScreenPos();
+                        draw_list->AddRectFilled(pos, ImVec2(pos.x + s.GlyphWidth * 2, pos.y + s.LineHeight), bg_color);
+                    }
+                }
+
                 // Draw highlight
                 bool is_highlight_from_user_range = (addr >= HighlightMin && addr < HighlightMax);
                 bool is_highlight_from_user_func = (HighlightFn && HighlightFn(mem_data, addr));
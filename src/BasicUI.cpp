@@ -1,4 +1,6 @@
 #include "BasicUI.h"
+#include <algorithm>
+#include <cctype>
 
 void BasicUI::Init()
 {
@@ -15,6 +17,7 @@ void BasicUI::Init()
 
 void BasicUI::Deinit()
 {
+    ReleaseLauncherTextures(true);
     ImGuiSDL::Deinitialize();
     ImGui::DestroyContext();
 }
@@ -38,6 +41,12 @@ void BasicUI::Draw()
 
     if (SDL_GetMouseFocus())
         ShowMenuBar();
+    if (fe_State->show_Launcher)
+        ShowLauncher(&fe_State->show_Launcher);
+    else if (!launcher_Textures.empty())
+        ReleaseLauncherTextures(true);
+    if (fe_State->show_HUD)
+        ShowHUD();
 
     ImGui::Render();
     ImGuiSDL::Render(ImGui::GetDrawData());
@@ -63,6 +72,33 @@ bool BasicUI::WantCaptureMouse()
     return fe_State->capture_Mouse;
 }
 
+void BasicUI::ShowHUD()
+{
+    //the rates come from the whole timing ring, refreshing them a few times a second is plenty
+    Uint32 now = SDL_GetTicks();
+    if (now - hud_Updated >= 250)
+    {
+        hud_Updated = now;
+        fe_State->frame_Timer->GetRates(hud_FPS, hud_IPS, hud_Frame_Ms);
+    }
+
+    ImGuiIO& io = ImGui::GetIO();
+    ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x - 8.0f, ImGui::GetFrameHeight() + 8.0f), ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+    ImGui::SetNextWindowBgAlpha(0.35f);
+    ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings |
+        ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav;
+    if (ImGui::Begin("HUD", NULL, flags))
+    {
+        ImGui::Text("%.0f FPS", hud_FPS);
+        if (hud_IPS >= 1000000.0)
+            ImGui::Text("%.2f M guest IPS", hud_IPS / 1000000.0);
+        else
+            ImGui::Text("%.0f guest IPS", hud_IPS);
+        ImGui::Text("%.2f ms frame", hud_Frame_Ms);
+    }
+    ImGui::End();
+}
+
 void BasicUI::ShowMenuBar()
 {
     if (ImGui::BeginMainMenuBar())
@@ -94,6 +130,10 @@ void BasicUI::ShowMenuFile()
         fe_State->open_File = std::make_shared<pfd::open_file>("Choose file", "C:\\");
     }
     ImGui::PopItemFlag();
+    if (ImGui::MenuItem("Launcher", "", fe_State->show_Launcher))
+    {
+        fe_State->show_Launcher = !fe_State->show_Launcher;
+    }
     if (ImGui::MenuItem("Reload", ""))
     {
         fe_State->core->Reset();
@@ -102,6 +142,20 @@ void BasicUI::ShowMenuFile()
             fe_State->core->Load(fe_State->file_data);
         }
     }
+    ImGui::MenuItem("Reload On Change", "", &fe_State->hot_Reload);
+    ImGui::Separator();
+    if (ImGui::MenuItem("Save State", "F5", false, fe_State->last_File != ""))
+    {
+        fe_State->save_State = true;
+    }
+    if (ImGui::MenuItem("Load State", "F7", false, fe_State->last_File != ""))
+    {
+        fe_State->load_State = true;
+    }
+    if (ImGui::MenuItem(fe_State->recording ? "Stop Recording Movie" : "Record Movie", "", false, fe_State->last_File != ""))
+    {
+        fe_State->toggle_Recording = true;
+    }
     ImGui::Separator();
     if (ImGui::MenuItem("Quit", ""))
     {
@@ -115,6 +169,7 @@ void BasicUI::ShowMenuEmulation()
     ImGui::TextUnformatted("CPU Cycles:");
     ImGui::SameLine();
     ImGui::InputScalar("", ImGuiDataType_U32, &(fe_State->run_Cycles), &u32_one, NULL, "%u");
+    ImGui::MenuItem("Rewind", "Hold Backspace", &(fe_State->rewind_Enabled));
 
     if (ImGui::BeginMenu("System Mode"))
     {
@@ -165,6 +220,8 @@ void BasicUI::ShowMenuEmulation()
         ImGui::MenuItem("Draw Ops Wrap", NULL, &(fe_State->core->quirks.draw_wrap));
         ImGui::MenuItem("Draw Ops Wait for Vblank", NULL, &(fe_State->core->quirks.draw_vblank));
         ImGui::MenuItem("S-CHIP 1.0 Large Fonts", NULL, &(fe_State->core->quirks.schip_10_fonts));
+        ImGui::Separator();
+        ImGui::MenuItem(fe_State->detecting_Quirks ? "Auto-Detect Unknown ROMs (running)" : "Auto-Detect Unknown ROMs", NULL, &(fe_State->detect_Quirks));
         ImGui::EndMenu();
     }
 
@@ -178,6 +235,7 @@ void BasicUI::ShowMenuOptions()
         {
             fe_State->grid_Toggled = true;
         }
+        ImGui::MenuItem("Performance HUD", "", &(fe_State->show_HUD));
 
         const ImU32 u32_one = 1;
         ImGui::TextUnformatted("Zoom:");
@@ -285,7 +343,7 @@ void BasicUI::ShowMenuOptions()
                 fe_State->screen_Colors[0].b = (Uint8)(background_color.z * 255.0);
                 fe_State->screen_Colors[0].a = (Uint8)(background_color.w * 255.0);
 
-                std::fill_n(fe_State->core->GetPrevVRAM(), 128 * 64, 0);
+                fe_State->core->ClearPrevVRAM();
                 fe_State->core->SetScreenDirty();
                 fe_State->core->SetWipeScreen();
             }
@@ -344,7 +402,7 @@ void BasicUI::ShowMenuOptions()
                 fe_State->screen_Colors[1].b = (Uint8)(foreground_color_1.z * 255.0);
                 fe_State->screen_Colors[1].a = (Uint8)(foreground_color_1.w * 255.0);
 
-                std::fill_n(fe_State->core->GetPrevVRAM(), 128 * 64, 0);
+                fe_State->core->ClearPrevVRAM();
                 fe_State->core->SetScreenDirty();
                 fe_State->core->SetWipeScreen();
 
@@ -404,7 +462,7 @@ void BasicUI::ShowMenuOptions()
                 fe_State->screen_Colors[2].b = (Uint8)(foreground_color_2.z * 255.0);
                 fe_State->screen_Colors[2].a = (Uint8)(foreground_color_2.w * 255.0);
 
-                std::fill_n(fe_State->core->GetPrevVRAM(), 128 * 64, 0);
+                fe_State->core->ClearPrevVRAM();
                 fe_State->core->SetScreenDirty();
                 fe_State->core->SetWipeScreen();
 
@@ -464,7 +522,7 @@ void BasicUI::ShowMenuOptions()
                 fe_State->screen_Colors[3].b = (Uint8)(overlap_color.z * 255.0);
                 fe_State->screen_Colors[3].a = (Uint8)(overlap_color.w * 255.0);
 
-                std::fill_n(fe_State->core->GetPrevVRAM(), 128 * 64, 0);
+                fe_State->core->ClearPrevVRAM();
                 fe_State->core->SetScreenDirty();
                 fe_State->core->SetWipeScreen();
 
@@ -535,7 +593,7 @@ void BasicUI::ShowMenuOptions()
                     fe_State->screen_Colors[it + 4].b = (Uint8)(xeno_chip_colors[it].z * 255.0);
                     fe_State->screen_Colors[it + 4].a = (Uint8)(xeno_chip_colors[it].w * 255.0);
 
-                    std::fill_n(fe_State->core->GetPrevVRAM(), 128 * 64, 0);
+                    fe_State->core->ClearPrevVRAM();
                     fe_State->core->SetScreenDirty();
                     fe_State->core->SetWipeScreen();
 
@@ -620,4 +678,155 @@ void BasicUI::ShowMenuOptions()
 
     }
 
-}
\ No newline at end of file
+}
+//the first frame of the strip is the top of the texture, ImGui::Image picks one with its uvs
+SDL_Texture* BasicUI::LauncherThumbnail(const RomLibrary::Entry& entry)
+{
+    auto found = launcher_Textures.find(entry.sha1);
+    if (found != launcher_Textures.end())
+    {
+        found->second.used = true;
+        return found->second.texture;
+    }
+
+    std::shared_ptr<const ThumbnailCache::Thumbnail> thumbnail = fe_State->thumbnails->Get(entry.path, entry.sha1);
+    if (!thumbnail)
+        return nullptr;
+
+    SDL_Texture* texture = SDL_CreateTexture(fe_State->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, ThumbnailCache::WIDTH, ThumbnailCache::HEIGHT * ThumbnailCache::FRAMES);
+    if (!texture)
+        return nullptr;
+    std::vector<uint32_t> argb(thumbnail->pixels.size());
+    for (size_t it = 0; it < argb.size(); it++)
+        argb[it] = 0xFF000000 | thumbnail->colors[thumbnail->pixels[it]];
+    SDL_UpdateTexture(texture, NULL, argb.data(), ThumbnailCache::WIDTH * sizeof(uint32_t));
+    launcher_Textures[entry.sha1] = { texture, true };
+    return texture;
+}
+
+void BasicUI::ReleaseLauncherTextures(bool all)
+{
+    for (auto it = launcher_Textures.begin(); it != launcher_Textures.end();)
+    {
+        if (all || !it->second.used)
+        {
+            SDL_DestroyTexture(it->second.texture);
+            it = launcher_Textures.erase(it);
+        }
+        else
+        {
+            it->second.used = false;
+            ++it;
+        }
+    }
+}
+
+static std::string FitText(const std::string& text, float width)
+{
+    if (ImGui::CalcTextSize(text.c_str()).x <= width)
+        return text;
+    std::string fitted = text;
+    while (!fitted.empty() && ImGui::CalcTextSize((fitted + "...").c_str()).x > width)
+        fitted.pop_back();
+    return fitted + "...";
+}
+
+//every rom in the library as a grid of animated thumbnails. only the rows on screen are laid out, and only their
+//thumbnails are asked for, so a big library costs no more than a small one
+void BasicUI::ShowLauncher(bool* p_open)
+{
+    ImGuiIO& io = ImGui::GetIO();
+    ImGuiStyle& style = ImGui::GetStyle();
+    float top = ImGui::GetFrameHeight(); //leaves room for the menu bar
+    ImGui::SetNextWindowPos(ImVec2(0, top));
+    ImGui::SetNextWindowSize(ImVec2(io.DisplaySize.x, io.DisplaySize.y - top));
+    if (!ImGui::Begin("Launcher", p_open, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoSavedSettings))
+    {
+        ImGui::End();
+        return;
+    }
+
+    RomLibrary* library = fe_State->library;
+    if (!library)
+    {
+        if (fe_State->library_Root == "")
+            ImGui::TextWrapped("No rom library. Start KIP-8 with --library <directory> to list the roms in it here.");
+        else
+            ImGui::Text("Scanning %s...", fe_State->library_Root.c_str());
+        ImGui::End();
+        return;
+    }
+
+    const std::vector<RomLibrary::Entry>& entries = library->GetEntries();
+    bool filter_changed = ImGui::InputText("Filter", launcher_Filter, sizeof(launcher_Filter));
+    if (filter_changed || launcher_Library_Size != entries.size())
+    {
+        std::string filter = launcher_Filter;
+        std::transform(filter.begin(), filter.end(), filter.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        launcher_Items.clear();
+        for (size_t it = 0; it < entries.size(); it++)
+        {
+            std::string title = entries[it].title;
+            std::transform(title.begin(), title.end(), title.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+            if (filter.empty() || title.find(filter) != std::string::npos)
+                launcher_Items.push_back(it);
+        }
+        launcher_Library_Size = entries.size();
+    }
+    if (launcher_Items.empty())
+        ImGui::Text(entries.empty() ? "No roms found in %s" : "No roms match the filter", fe_State->library_Root.c_str());
+
+    const ImVec2 thumbnail_size((float)ThumbnailCache::WIDTH * 2, (float)ThumbnailCache::HEIGHT * 2);
+    const float cell_width = thumbnail_size.x + style.FramePadding.x * 2;
+    const float row_height = thumbnail_size.y + style.FramePadding.y * 2 + ImGui::GetTextLineHeightWithSpacing() + style.ItemSpacing.y;
+
+    ImGui::BeginChild("launcher_grid");
+    int columns = std::max(1, (int)((ImGui::GetContentRegionAvail().x + style.ItemSpacing.x) / (cell_width + style.ItemSpacing.x)));
+    int rows = (int)((launcher_Items.size() + columns - 1) / columns);
+    //the strips were captured every half second of emulated time, so they play back at that pace
+    int frame = (int)((SDL_GetTicks() / 500) % ThumbnailCache::FRAMES);
+    ImVec2 uv0(0.0f, (float)frame / ThumbnailCache::FRAMES), uv1(1.0f, (float)(frame + 1) / ThumbnailCache::FRAMES);
+
+    ImGuiListClipper clipper;
+    clipper.Begin(rows, row_height);
+    while (clipper.Step())
+    {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+        {
+            for (int column = 0; column < columns; column++)
+            {
+                size_t item = (size_t)row * columns + column;
+                if (item >= launcher_Items.size())
+                    break;
+                const RomLibrary::Entry& entry = entries[launcher_Items[item]];
+                if (column > 0)
+                    ImGui::SameLine();
+
+                ImGui::PushID((int)item);
+                ImGui::BeginGroup();
+                SDL_Texture* texture = LauncherThumbnail(entry);
+                bool clicked;
+                if (texture)
+                    clicked = ImGui::ImageButton(texture, thumbnail_size, uv0, uv1);
+                else
+                    clicked = ImGui::Button("...", ImVec2(cell_width, thumbnail_size.y + style.FramePadding.y * 2));
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("%s\n%s", entry.title.c_str(), entry.path.c_str());
+                ImGui::TextUnformatted(FitText(entry.title, cell_width).c_str());
+                ImGui::EndGroup();
+                ImGui::PopID();
+
+                if (clicked)
+                {
+                    fe_State->launch_File = entry.path;
+                    *p_open = false;
+                }
+            }
+        }
+    }
+    ImGui::EndChild();
+    ImGui::End();
+
+    ReleaseLauncherTextures(false);
+    fe_State->thumbnails->Trim();
+}
@@ -0,0 +1,51 @@
+//kip8-batch: headless batch runner, see BatchRunner.h for the manifest format
+#include "CLI11.hpp"
+#include "BatchRunner.h"
+#include <iostream>
+#include <fstream>
+
+int main(int argc, char* argv[])
+{
+	std::string manifest_file = "";
+	std::string output_file = "";
+	std::string log_dir = "logs";
+	unsigned int threads = 0;
+	bool verify_hash = false;
+
+	CLI::App app{ "KIP-8 headless batch runner" };
+
+	app.add_option("manifest", manifest_file, "Job manifest (json)")->required();
+	app.add_option("-o,--output", output_file, "Write JSONL results here instead of stdout");
+	app.add_option("-j,--threads", threads, "Worker threads, 0 for one per hardware thread");
+	app.add_option("--log-dir", log_dir, "Directory for per-worker core logs, empty to discard them");
+	app.add_flag("--verify-hash", verify_hash, "Recompute every core's state hash from scratch after each frame");
+	CLI11_PARSE(app, argc, argv);
+
+	Logger::InitConsole(spdlog::level::info);
+
+	BatchRunner runner(threads);
+	runner.SetLogDirectory(log_dir);
+	runner.SetHashVerify(verify_hash);
+	if (!runner.LoadManifest(manifest_file))
+		return 1;
+
+	std::ofstream ofd;
+	if (output_file != "")
+	{
+		ofd.open(output_file, std::ios::out | std::ios::trunc);
+		if (!ofd.good())
+		{
+			LOG_ERROR("Could not open results file: {}", output_file);
+			return 1;
+		}
+	}
+
+	BatchRunner::Summary summary;
+	bool all_ok = runner.Run(output_file != "" ? ofd : std::cout, summary);
+
+	double seconds = summary.microseconds / 1000000.0;
+	LOG_INFO("{} jobs ({} failed), {} frames, {} cycles in {:.3f} s ({:.0f} frames/s, {} steals)", summary.jobs, summary.failed,
+		summary.frames, summary.cycles, seconds, seconds > 0 ? summary.frames / seconds : 0.0, summary.steals);
+
+	return all_ok ? 0 : 2;
+}
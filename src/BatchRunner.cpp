@@ -0,0 +1,334 @@
+#include "BatchRunner.h"
+#include "Checksum.h"
+#include "MappedFile.h"
+#include "Stopwatch.h"
+#include "ThreadPool.h"
+#include "sha1.hpp"
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+static bool ParseMode(const std::string& name, Chip8::SYSTEM_MODE& mode)
+{
+	if (name == "chip8")
+		mode = Chip8::SYSTEM_MODE::CHIP_8;
+	else if (name == "schip")
+		mode = Chip8::SYSTEM_MODE::SUPER_CHIP;
+	else if (name == "xochip")
+		mode = Chip8::SYSTEM_MODE::XO_CHIP;
+	else
+		return false;
+	return true;
+}
+
+static const char* ModeName(Chip8::SYSTEM_MODE mode)
+{
+	switch (mode)
+	{
+	case Chip8::SYSTEM_MODE::SUPER_CHIP: return "schip";
+	case Chip8::SYSTEM_MODE::XO_CHIP: return "xochip";
+	default: return "chip8";
+	}
+}
+
+static std::string Hex64(uint64_t val)
+{
+	std::ostringstream out;
+	out << std::hex << std::setfill('0') << std::setw(16) << val;
+	return out.str();
+}
+
+BatchRunner::BatchRunner(unsigned int threads) : thread_count(threads)
+{
+}
+
+bool BatchRunner::ParseJob(const Json::Value& value, Job& job, std::string& error)
+{
+	if (!value.isObject())
+	{
+		error = "job is not an object";
+		return false;
+	}
+
+	if (value.isMember("name"))
+		job.name = value["name"].asString();
+	if (value.isMember("rom"))
+		job.rom_file = base_dir + value["rom"].asString();
+	if (value.isMember("movie"))
+		job.movie_file = base_dir + value["movie"].asString();
+	if (value.isMember("mode") && !ParseMode(value["mode"].asString(), job.mode))
+	{
+		error = "unknown mode " + value["mode"].asString();
+		return false;
+	}
+	if (value.isMember("frames"))
+		job.frames = value["frames"].asUInt();
+	if (value.isMember("cycles"))
+		job.cycles = (uint16_t)std::min(0xFFFFu, value["cycles"].asUInt());
+	if (value.isMember("seed"))
+		job.seed = value["seed"].asUInt64();
+
+	const Json::Value& quirks = value["quirks"];
+	if (!quirks.isNull())
+	{
+		job.quirks.vip_jump = quirks.get("vip_jump", job.quirks.vip_jump).asBool();
+		job.quirks.vip_shifts = quirks.get("vip_shifts", job.quirks.vip_shifts).asBool();
+		job.quirks.vip_regs_read_write = quirks.get("vip_regs_read_write", job.quirks.vip_regs_read_write).asBool();
+		job.quirks.logic_flag_reset = quirks.get("logic_flag_reset", job.quirks.logic_flag_reset).asBool();
+		job.quirks.draw_wrap = quirks.get("draw_wrap", job.quirks.draw_wrap).asBool();
+		job.quirks.draw_vblank = quirks.get("draw_vblank", job.quirks.draw_vblank).asBool();
+		job.quirks.schip_10_fonts = quirks.get("schip_10_fonts", job.quirks.schip_10_fonts).asBool();
+		job.quirks.schip_10_regs_read_write = quirks.get("schip_10_regs_read_write", job.quirks.schip_10_regs_read_write).asBool();
+	}
+	return true;
+}
+
+bool BatchRunner::LoadManifest(const std::string& filename)
+{
+	std::ifstream ifd(filename);
+	if (!ifd.good())
+	{
+		LOG_ERROR("Could not open batch manifest: {}", filename);
+		return false;
+	}
+
+	Json::Value manifest;
+	Json::CharReaderBuilder builder;
+	std::string errors;
+	if (!Json::parseFromStream(builder, ifd, &manifest, &errors))
+	{
+		LOG_ERROR("Could not parse batch manifest {}: {}", filename, errors);
+		return false;
+	}
+
+	size_t slash = filename.find_last_of("/\\");
+	base_dir = (slash == std::string::npos) ? "" : filename.substr(0, slash + 1);
+
+	std::string error;
+	Job defaults;
+	if (manifest.isMember("defaults") && !ParseJob(manifest["defaults"], defaults, error))
+	{
+		LOG_ERROR("Bad manifest defaults: {}", error);
+		return false;
+	}
+
+	for (const Json::Value& entry : manifest["jobs"])
+	{
+		Job job = defaults;
+		if (!ParseJob(entry, job, error) || job.rom_file == "")
+		{
+			LOG_ERROR("Bad manifest job {}: {}", jobs.size(), error == "" ? "no rom" : error);
+			return false;
+		}
+		AddJob(job);
+	}
+
+	const Json::Value& matrix = manifest["matrix"];
+	if (!matrix.isNull())
+	{
+		Json::Value configs = matrix["configs"];
+		if (configs.empty())
+			configs.append(Json::Value(Json::objectValue));
+		for (const Json::Value& rom : matrix["roms"])
+		{
+			for (const Json::Value& config : configs)
+			{
+				Job job = defaults;
+				if (!ParseJob(config, job, error))
+				{
+					LOG_ERROR("Bad manifest config: {}", error);
+					return false;
+				}
+				job.rom_file = base_dir + rom.asString();
+				AddJob(job);
+			}
+		}
+	}
+
+	LOG_INFO("Loaded {} jobs from {}", jobs.size(), filename);
+	return true;
+}
+
+void BatchRunner::AddJob(Job job)
+{
+	job.id = jobs.size();
+	jobs.push_back(job);
+}
+
+const BatchRunner::Rom& BatchRunner::GetRom(const std::string& filename)
+{
+	auto found = roms.find(filename);
+	if (found != roms.end())
+		return found->second;
+
+	Rom& rom = roms[filename];
+	MappedFile file;
+	if (!file.Open(filename))
+	{
+		rom.error = "could not open rom";
+		return rom;
+	}
+	std::vector<unsigned char> buffer(file.Data(), file.Data() + file.Size());
+	SHA1 sha1;
+	sha1.update(std::string(buffer.begin(), buffer.end()));
+	rom.sha1 = sha1.final();
+	rom.image = std::make_unique<RomImage>(buffer);
+	return rom;
+}
+
+const BatchRunner::LoadedMovie& BatchRunner::GetMovie(const std::string& filename)
+{
+	auto found = movies.find(filename);
+	if (found != movies.end())
+		return found->second;
+
+	LoadedMovie& movie = movies[filename];
+	if (!movie.movie.Open(filename))
+		movie.error = "could not open movie";
+	return movie;
+}
+
+void BatchRunner::RunJob(const Job& job, PageArena* arena, std::shared_ptr<spdlog::logger> logger, Result& result)
+{
+	//only reads the rom and movie maps, they are filled before any job is submitted
+	const Rom& rom = roms.at(job.rom_file);
+	if (rom.error != "")
+	{
+		result.error = rom.error;
+		return;
+	}
+
+	Chip8 core(arena, logger);
+	core.SetHashVerify(verify_hash);
+	stopwatch::Stopwatch timer;
+
+	if (job.movie_file != "")
+	{
+		const LoadedMovie& movie = movies.at(job.movie_file);
+		if (movie.error != "")
+		{
+			result.error = movie.error;
+			return;
+		}
+		if (movie.movie.GetRomSHA1() != rom.sha1)
+		{
+			result.error = "rom sha1 does not match the movie";
+			return;
+		}
+
+		Movie::ReplayResult replay;
+		movie.movie.Replay(&core, *rom.image, replay);
+		result.frames = replay.frames;
+		result.first_desync_frame = replay.first_desync_frame;
+	}
+	else
+	{
+		uint8_t rpl[Chip8::RPL_SIZE] = { 0 };
+		Movie::Boot(&core, *rom.image, job.seed, job.mode, job.quirks, rpl);
+		for (uint32_t it = 0; it < job.frames; it++)
+			core.Run(job.cycles);
+		result.frames = job.frames;
+	}
+
+	result.microseconds = timer.elapsed<stopwatch::mus>();
+	result.cycles = core.GetTotalCycles();
+	result.state_hash = core.GetStateHash();
+	result.vram_crc = Crc32(core.GetVRAM(), (size_t)core.res.base_width * core.res.base_height);
+	result.halted = core.GetHalted();
+}
+
+std::string BatchRunner::FormatResult(const Job& job, const Result& result)
+{
+	Json::Value line;
+	line["id"] = (Json::UInt64)job.id;
+	if (job.name != "")
+		line["name"] = job.name;
+	line["rom"] = job.rom_file;
+	if (job.movie_file != "")
+		line["movie"] = job.movie_file;
+	else
+	{
+		line["mode"] = ModeName(job.mode);
+		line["seed"] = (Json::UInt64)job.seed;
+	}
+
+	if (result.error != "")
+		line["error"] = result.error;
+	else
+	{
+		if (job.movie_file != "")
+		{
+			line["in_sync"] = result.first_desync_frame < 0;
+			if (result.first_desync_frame >= 0)
+				line["first_desync_frame"] = (Json::Int64)result.first_desync_frame;
+		}
+		line["frames"] = result.frames;
+		line["cycles"] = (Json::UInt64)result.cycles;
+		line["state_hash"] = Hex64(result.state_hash); //as a string, json readers tend to lose 64 bit integers
+		line["vram_crc"] = result.vram_crc;
+		line["halted"] = result.halted;
+		line["wall_us"] = (Json::UInt64)result.microseconds;
+	}
+
+	Json::StreamWriterBuilder writer;
+	writer["indentation"] = "";
+	return Json::writeString(writer, line);
+}
+
+bool BatchRunner::Run(std::ostream& out, Summary& summary)
+{
+	summary = Summary();
+	stopwatch::Stopwatch timer;
+
+	//load everything up front on this thread, jobs only ever read the shared images
+	for (const Job& job : jobs)
+	{
+		GetRom(job.rom_file);
+		if (job.movie_file != "")
+			GetMovie(job.movie_file);
+	}
+
+	std::mutex out_lock;
+	bool all_ok = true;
+	{
+		ThreadPool pool(thread_count);
+		LOG_INFO("Running {} jobs on {} threads", jobs.size(), pool.GetThreadCount());
+
+		//one arena and one logger per worker, picked by worker index so no job ever waits on another
+		std::vector<std::unique_ptr<PageArena>> arenas;
+		std::vector<std::shared_ptr<spdlog::logger>> loggers;
+		for (unsigned int it = 0; it < pool.GetThreadCount(); it++)
+		{
+			arenas.push_back(std::make_unique<PageArena>());
+			std::string log_file = (log_dir == "") ? "" : log_dir + "/kip8_batch_worker" + std::to_string(it) + ".log";
+			loggers.push_back(Logger::CreateWorkerLogger("Worker " + std::to_string(it), log_file, spdlog::level::warn));
+		}
+
+		for (const Job& job : jobs)
+		{
+			pool.Submit([&, this] {
+				int worker = ThreadPool::CurrentWorker();
+				Result result;
+				RunJob(job, arenas[worker].get(), loggers[worker], result);
+				std::string line = FormatResult(job, result);
+
+				std::lock_guard<std::mutex> guard(out_lock);
+				out << line << '\n';
+				out.flush();
+				summary.jobs++;
+				summary.frames += result.frames;
+				summary.cycles += result.cycles;
+				if (result.error != "" || result.first_desync_frame >= 0)
+				{
+					summary.failed++;
+					all_ok = false;
+				}
+			});
+		}
+		pool.Wait();
+		summary.steals = pool.GetStealCount();
+	}
+
+	summary.microseconds = timer.elapsed<stopwatch::mus>();
+	return all_ok;
+}
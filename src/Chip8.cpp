@@ -1,37 +1,174 @@
 #include "Chip8.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "Checksum.h"
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <random>
+#include <cassert>
+
+const uint8_t Chip8::Font[80] = {
+	0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+	0x20, 0x60, 0x20, 0x20, 0x70, // 1
+	0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+	0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+	0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+	0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+	0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+	0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+	0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+	0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+	0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+	0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+	0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+	0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+	0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+	0xF0, 0x80, 0xF0, 0x80, 0x80, // F
+};
+const uint8_t Chip8::LargeFont[160] = {
+	0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+	0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+	0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+	0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+	0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+	0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+	0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+	0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+	0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+	0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+	0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+	0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
+const uint8_t Chip8::LogoRom[97] = {
+	0x00, 0xE0, // cls
+	0x60, 0x0B, // ld v0 0x0B
+	0x61, 0x08, // ld v1 0x08
+	0x62, 0x0F, // ld v2 0x0F
+	0xA2, 0x16, // set i = 0x216 (start of logo data)
+	0xD0, 0x1F, // draw v0 v1 15, draw 15 line tall letter at v0,v1
+	0xF2, 0x1E, // i += v2, move to next character in logo
+	0x70, 0x08, // v0 += 0x08 (move draw location right 8 pixels)
+	0x30, 0x33, // skip next instruction if v0 == 51, we're done drawing all letters so stop looping
+	0x12, 0x0A, // jump 20A (draw command)
+	0x12, 0x14, // jump 214 (infinite loop)
+	0xC3, 0xC7, 0xCE, 0xDC, 0xF8, 0xF0, 0xE0, 0xE0, 0xE0, 0xF0, 0xF8, 0xDC, 0xCE, 0xC7, 0xC3, // K
+	0x7E, 0x7E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7E, 0x7E, // I
+	0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, // P
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7E, 0x7E, 0x7E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // -
+	0x7E, 0xFF, 0xE7, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xE7, 0xFF, 0x7E  // 8
+};
+
+const std::array<std::array<uint64_t, 128 * 64>, 2> Chip8::PixelKeys = [] {
+	std::array<std::array<uint64_t, 128 * 64>, 2> keys;
+	for (size_t plane = 0; plane < keys.size(); plane++)
+		for (size_t it = 0; it < keys[plane].size(); it++)
+			keys[plane][it] = Mix64(((plane << 16) | it) ^ 0xBB67AE8584CAA73BULL);
+	return keys;
+}();
+
+//page 0 after reset, shared by every core
+MemoryPage* Chip8::FontPage()
+{
+	static MemoryPage font_page; //static storage, so data starts zeroed
+	static bool initialized = [] {
+		memcpy(&font_page.data[0x00], Font, sizeof(Font));
+		memcpy(&font_page.data[0x50], LargeFont, sizeof(LargeFont));
+		font_page.hash = font_page.ComputeHash();
+		return true;
+	}();
+	(void)initialized;
+	return &font_page;
+}
 
-Chip8::Chip8()
+Chip8::Chip8(PageArena* arena, std::shared_ptr<spdlog::logger> core_logger) : page_arena(arena ? arena : &PageArena::Default())
 {
+	SetLogger(core_logger);
+	std::fill_n(pages, 0x100, PageArena::ZeroPage());
 	Reset("Initializing");
 }
+Chip8::Chip8(const Chip8& other) : page_arena(other.page_arena), logger(other.logger)
+{
+	for (int it = 0; it < 0x100; it++)
+		pages[it] = PageArena::AddRef(other.pages[it]);
+	ram_hash = other.ram_hash;
+	CopyState(other);
+}
+
 Chip8::~Chip8()
 {
+	for (MemoryPage* page : pages)
+		PageArena::Release(page);
+}
+
+Chip8* Chip8::Clone() const
+{
+	return new Chip8(*this);
+}
+
+void Chip8::Restore(const Chip8& from)
+{
+	if (&from == this)
+		return;
+	for (int it = 0; it < 0x100; it++)
+	{
+		if (pages[it] != from.pages[it])
+			MapPage(it, PageArena::AddRef(from.pages[it]));
+	}
+	CopyState(from);
+}
+
+void Chip8::CopyState(const Chip8& from)
+{
+	CPUState state;
+	from.GetCPUState(state);
+	SetCPUState(state);
+	seed = from.seed;
+	seed_fixed = from.seed_fixed;
+	total_cycles = from.total_cycles;
+	faults = from.faults;
+	write_rpl = from.write_rpl;
+	memcpy(FrameBuffer.data(), from.FrameBuffer.data(), FrameBuffer.size());
+	vram_hash = from.vram_hash;
+	vram_hash_stale = from.vram_hash_stale;
+	SetScreenDirty();
+	SetWipeScreen();
 }
 
 void Chip8::Reset(std::string message)
 {
-	LOG_DEBUG("CPU reset: {}", message);
-	srand((unsigned int)std::chrono::system_clock::now().time_since_epoch().count());
+	LOG_DEBUG_TO(logger, "CPU reset: {}", message);
+	//unseeded cores get a different stream each launch and each reset. call SetSeed for reproducible runs
+	if (!seed_fixed)
+		seed = (uint64_t)std::chrono::system_clock::now().time_since_epoch().count();
+	rng.Seed(seed);
+	total_cycles = 0;
+	faults = Faults();
 	
+	MapPage(0, FontPage()); //normal font at 0x00, 5 bytes per character. large font at 0x50, 10 bytes per character
+	MapPage(1, PageArena::ZeroPage());
 	ResetMemory(mode == SYSTEM_MODE::SUPER_CHIP);
 	
-	memcpy(&Memory[0x00], &Font[0], 80); //normal font. 5 bytes per character, 16 characters
-	memcpy(&Memory[0x50], &LargeFont[0], 160); //large font. 10 bytes per character, 16 characters
-	memcpy(&Memory[0x200], &LogoRom[0], 97); //load our default kip-8 logo rom on system reset
+	SetRAM(0x200, LogoRom, sizeof(LogoRom)); //load our default kip-8 logo rom on system reset
 	
-	std::fill_n(FrameBuffer, 128*64, 0);
-	std::fill_n(PreviousFramebuffer, 128 * 64, 0);
+	ResizeVRAM();
+	std::fill(FrameBuffer.begin(), FrameBuffer.end(), 0);
+	vram_hash = 0;
+	vram_hash_stale = false;
+	ClearPrevVRAM();
 	
 	std::fill_n(Keys, 16, 0);
 	std::fill_n(PrevKeys, 16, 0);
 
 	sp = -1;
-	std::fill_n(Stack, 64, 0);
+	std::fill_n(Stack, 16, 0);
+	profiler_calls_stale = true;
 
 	std::fill_n(regs.v, 16, 0);
 	regs.i = 0;
@@ -72,55 +209,289 @@ void Chip8::Run(uint16_t cycles) {
 		SetSoundTimer(st - 1);
 	}
 	if (m_Run_Cycles && !GetDebugStepping())
-		LOG_TRACE("Running {} cycles.", m_Run_Cycles);
+		LOG_TRACE_TO(logger, "Running {} cycles.", m_Run_Cycles);
+	if (profiler && profiler_calls_stale)
+		SyncProfilerCalls();
 	while(m_Run_Cycles > 0)
 	{
 		m_Run_Cycles--;
+		total_cycles++;
 		uint16_t op = Fetch(pc);
+		if (profiler)
+			profiler->Execute(pc, op);
 		pc += 2;
 		Decode_Execute(op);
 	}
+	if (profiler)
+		profiler->EndFrame();
+
+	if (verify_hash)
+		VerifyStateHash(GetStateHash());
 
 	return;
 }
 
+//the return addresses on the stack follow the calls that pushed them, so the shadow call stack comes from the
+//2NNN in front of each
+void Chip8::SyncProfilerCalls()
+{
+	profiler_calls_stale = false;
+	profiler->ResetCalls();
+	for (int it = 0; it <= sp; it++)
+		profiler->Call(Fetch(Stack[it] - 2) & 0x0FFF);
+}
+
 void Chip8::ResetMemory(bool randomize)
 {
+	//everything from 0x200 up. zeroed memory is just the shared zero page, only randomized pages get allocated
+	for (int it = 0x02; it < 0x100; it++)
+		MapPage(it, PageArena::ZeroPage());
 	if (randomize)
 		for (int i = 0x200; i <= RamLimit; i++)
-			Memory[i] = rand() & 0xFF;
-	else
-		std::fill_n(&Memory[0x200], RamLimit - 0x200 + 1, 0);
+			WriteMem(i, rng.Next() & 0xFF);
 }
 
-uint16_t Chip8::Fetch(uint16_t location) {
-	uint8_t upper_byte = Memory[location];
-	uint8_t lower_byte = Memory[location + 1];
-	
-	uint16_t op = (uint16_t)(upper_byte << 8 | lower_byte);
-	return op;
+MemoryPage* Chip8::UnsharePage(uint8_t index)
+{
+	MemoryPage* page = page_arena->Allocate();
+	memcpy(page->data, pages[index]->data, MemoryPage::SIZE);
+	page->hash = pages[index]->hash;
+	MapPage(index, page);
+	return page;
+}
+
+void Chip8::MapPage(uint8_t index, MemoryPage* page)
+{
+	MemoryPage* old = pages[index];
+	ram_hash ^= PageTerm(index, old->hash) ^ PageTerm(index, page->hash);
+	pages[index] = page;
+	PageArena::Release(old);
+}
+
+void Chip8::CopyRAM(uint16_t addr, uint8_t* out, size_t len) const
+{
+	size_t offset = addr;
+	while (len)
+	{
+		size_t count = std::min<size_t>(len, MemoryPage::SIZE - (offset & 0xFF));
+		memcpy(out, &pages[offset >> 8]->data[offset & 0xFF], count);
+		out += count;
+		offset += count;
+		len -= count;
+	}
+}
+
+void Chip8::SetRAM(uint16_t addr, const uint8_t* in, size_t len)
+{
+	size_t offset = addr;
+	while (len)
+	{
+		uint8_t index = (uint8_t)(offset >> 8);
+		uint8_t start = offset & 0xFF;
+		size_t count = std::min<size_t>(len, MemoryPage::SIZE - start);
+		MemoryPage* page = pages[index];
+		if (memcmp(&page->data[start], in, count) != 0) //unchanged pages stay shared
+		{
+			if (!page->IsPrivate() && count == MemoryPage::SIZE) //whole page is overwritten, no need to copy the shared contents
+			{
+				page = page_arena->Allocate();
+				memcpy(page->data, in, count);
+				page->hash = page->ComputeHash();
+				MapPage(index, page);
+			}
+			else
+			{
+				if (!page->IsPrivate())
+					page = UnsharePage(index);
+				uint64_t old_term = PageTerm(index, page->hash);
+				for (size_t it = 0; it < count; it++)
+					page->hash ^= MemoryPage::ByteKey((uint8_t)(start + it), page->data[start + it]) ^ MemoryPage::ByteKey((uint8_t)(start + it), in[it]);
+				memcpy(&page->data[start], in, count);
+				ram_hash ^= old_term ^ PageTerm(index, page->hash);
+			}
+		}
+		in += count;
+		offset += count;
+		len -= count;
+	}
 }
+
 void Chip8::Load(const std::vector<unsigned char> &buffer)
 {
-	for (auto it = 0; it < buffer.size(); it++)
+	size_t size = buffer.size();
+	if (0x200 + size > (size_t)RamLimit + 1)
 	{
-		Memory[0x200 + it] = (uint8_t)buffer[it];
+		LOG_ERROR_TO(logger, "Rom does not fit in memory, truncating {} bytes", 0x200 + size - ((size_t)RamLimit + 1));
+		size = (size_t)RamLimit + 1 - 0x200;
 	}
+	SetRAM(0x200, buffer.data(), size);
+}
+
+void Chip8::Load(const RomImage& image)
+{
+	if (0x200 + image.Size() > (size_t)RamLimit + 1)
+	{
+		LOG_ERROR_TO(logger, "Rom does not fit in memory, truncating {} bytes", 0x200 + image.Size() - ((size_t)RamLimit + 1));
+		std::vector<unsigned char> truncated(image.Size());
+		size_t page_bytes = image.FullPages().size() * MemoryPage::SIZE;
+		for (size_t it = 0; it < image.FullPages().size(); it++)
+			memcpy(&truncated[it * MemoryPage::SIZE], image.FullPages()[it]->data, MemoryPage::SIZE);
+		std::copy(image.Tail().begin(), image.Tail().end(), truncated.begin() + page_bytes);
+		Load(truncated);
+		return;
+	}
+
+	//full pages replace whatever ResetMemory left there, so sharing them is identical to copying them
+	uint8_t first_page = RomImage::LOAD_ADDRESS >> 8;
+	for (size_t it = 0; it < image.FullPages().size(); it++)
+		MapPage((uint8_t)(first_page + it), PageArena::AddRef(image.FullPages()[it]));
+	if (!image.Tail().empty())
+		SetRAM((uint16_t)(RomImage::LOAD_ADDRESS + (image.FullPages().size() * MemoryPage::SIZE)), image.Tail().data(), image.Tail().size());
+}
+
+size_t Chip8::PatchRom(const std::vector<unsigned char>& loaded, const std::vector<unsigned char>& edited)
+{
+	size_t size = std::min(std::max(loaded.size(), edited.size()), (size_t)RamLimit + 1 - 0x200);
+	size_t patched = 0;
+	for (size_t it = 0; it < size; it++)
+	{
+		uint8_t before = it < loaded.size() ? loaded[it] : 0;
+		uint8_t after = it < edited.size() ? edited[it] : 0; //a shorter rom leaves zeroes, like a fresh load would
+		uint16_t addr = (uint16_t)(0x200 + it);
+		if (before != after && ReadMem(addr) != after)
+		{
+			WriteMem(addr, after); //keeps the state hash and copy-on-write pages right
+			patched++;
+		}
+	}
+	return patched;
+}
+
+void Chip8::ResizeVRAM()
+{
+	size_t size = (size_t)res.base_width * res.base_height;
+	if (FrameBuffer.size() != size)
+	{
+		FrameBuffer.assign(size, 0);
+		vram_hash = 0;
+		vram_hash_stale = false;
+	}
+	if (!PreviousFramebuffer.empty() && PreviousFramebuffer.size() != size)
+		PreviousFramebuffer.assign(size, 0);
 }
 
 uint8_t* Chip8::GetVRAM()
 {
-	return FrameBuffer;
+	return FrameBuffer.data();
 }
 
 uint8_t* Chip8::GetPrevVRAM()
 {
-	return PreviousFramebuffer;
+	if (PreviousFramebuffer.size() != FrameBuffer.size())
+		PreviousFramebuffer.assign(FrameBuffer.size(), 0);
+	return PreviousFramebuffer.data();
 }
 
 void Chip8::SaveCurrentVRAM()
 {
-	memcpy(PreviousFramebuffer, FrameBuffer, 128 * 64);
+	memcpy(GetPrevVRAM(), FrameBuffer.data(), FrameBuffer.size());
+}
+
+void Chip8::ClearPrevVRAM()
+{
+	std::fill(PreviousFramebuffer.begin(), PreviousFramebuffer.end(), 0);
+}
+
+void Chip8::RehashVRAM()
+{
+	vram_hash = 0;
+	for (size_t it = 0; it < FrameBuffer.size(); it++)
+		vram_hash ^= PixelKey((uint16_t)it, FrameBuffer[it]);
+	vram_hash_stale = false;
+}
+
+uint64_t Chip8::CPUHash() const
+{
+	CPUState state;
+	memset((void*)&state, 0, sizeof(state));
+	GetCPUState(state);
+	std::fill(std::begin(state.Stack) + (sp + 1), std::end(state.Stack), 0); //stale entries above the stack pointer don't matter
+
+	const uint8_t* bytes = (const uint8_t*)&state;
+	uint64_t hash = 0xA54FF53A5F1D36F1ULL;
+	for (size_t it = 0; it < sizeof(state); it += 8)
+	{
+		uint64_t word = 0;
+		memcpy(&word, bytes + it, std::min<size_t>(8, sizeof(state) - it));
+		hash = Mix64(hash ^ word);
+	}
+	return hash;
+}
+
+uint64_t Chip8::GetStateHash()
+{
+	if (vram_hash_stale)
+		RehashVRAM();
+	uint64_t hash = ram_hash ^ Mix64(vram_hash ^ 0x3C6EF372FE94F82BULL) ^ CPUHash();
+	if (verify_hash)
+		VerifyStateHash(hash);
+	return hash;
+}
+
+uint64_t Chip8::ComputeStateHash() const
+{
+	uint64_t ram = 0;
+	for (int it = 0; it < 0x100; it++)
+		ram ^= PageTerm(it, pages[it]->ComputeHash());
+	uint64_t vram = 0;
+	for (size_t it = 0; it < FrameBuffer.size(); it++)
+		vram ^= PixelKey((uint16_t)it, FrameBuffer[it]);
+	return ram ^ Mix64(vram ^ 0x3C6EF372FE94F82BULL) ^ CPUHash();
+}
+
+void Chip8::VerifyStateHash(uint64_t hash) const
+{
+	uint64_t full = ComputeStateHash();
+	if (hash != full)
+	{
+		LOG_ERROR_TO(logger, "State hash mismatch at PC {:04X}: incremental {:016X}, recomputed {:016X}", pc, hash, full);
+		assert(hash == full);
+	}
+}
+
+uint16_t Chip8::GetKeyMask()
+{
+	uint16_t mask = 0;
+	for (int it = 0; it < 16; it++)
+		if (Keys[it])
+			mask |= 1 << it;
+	return mask;
+}
+
+uint16_t Chip8::GetPrevKeyMask()
+{
+	uint16_t mask = 0;
+	for (int it = 0; it < 16; it++)
+		if (PrevKeys[it])
+			mask |= 1 << it;
+	return mask;
+}
+
+void Chip8::SetKeyMask(uint16_t keys, uint16_t prev_keys)
+{
+	for (int it = 0; it < 16; it++)
+	{
+		Keys[it] = (keys >> it) & 1;
+		PrevKeys[it] = (prev_keys >> it) & 1;
+	}
+}
+
+void Chip8::SetLogger(std::shared_ptr<spdlog::logger> new_logger)
+{
+	//embedders may never set up logging themselves
+	if (!new_logger && !Logger::GetLogger())
+		Logger::InitConsole(spdlog::level::warn);
+	logger = new_logger ? new_logger : Logger::GetLogger();
 }
 
 void Chip8::SetScreenDirty()
@@ -133,14 +504,14 @@ bool Chip8::ToggleDebugStepping(std::string message)
 	debug_stepping = !debug_stepping;
 	if (debug_stepping)
 	{
-		Logger::GetLogger()->set_level(spdlog::level::trace);
-		LOG_DEBUG("Breakpoint: {}", message);
+		logger->set_level(spdlog::level::trace);
+		LOG_DEBUG_TO(logger, "Breakpoint: {}", message);
 		Halt();
 	}
 	else
 	{
-		LOG_DEBUG("Continue: {}", message);
-		Logger::GetLogger()->set_level(spdlog::level::info);
+		LOG_DEBUG_TO(logger, "Continue: {}", message);
+		logger->set_level(spdlog::level::info);
 		UnHalt();
 	}
 	return debug_stepping;
@@ -148,7 +519,7 @@ bool Chip8::ToggleDebugStepping(std::string message)
 
 void Chip8::SetSystemMode(SYSTEM_MODE newmode)
 {
-	LOG_INFO("Changing system mode: {}", newmode);
+	LOG_INFO_TO(logger, "Changing system mode: {}", newmode);
 	mode = newmode;
 
 	quirks.draw_wrap = false;
@@ -166,7 +537,7 @@ void Chip8::SetSystemMode(SYSTEM_MODE newmode)
 	{
 		case(SYSTEM_MODE::CHIP_8):
 		{
-			LOG_INFO("Set system mode CHIP-8");
+			LOG_INFO_TO(logger, "Set system mode CHIP-8");
 			res.base_height = 32;
 			res.base_width = 64;
 			res.hires = false;
@@ -183,7 +554,7 @@ void Chip8::SetSystemMode(SYSTEM_MODE newmode)
 		}
 		case(SYSTEM_MODE::SUPER_CHIP):
 		{
-			LOG_INFO("Set system mode SUPER-CHIP");
+			LOG_INFO_TO(logger, "Set system mode SUPER-CHIP");
 			res.base_height = 64;
 			res.base_width = 128;
 			res.hires = false;
@@ -193,7 +564,7 @@ void Chip8::SetSystemMode(SYSTEM_MODE newmode)
 		}
 		case(SYSTEM_MODE::XO_CHIP):
 		{
-			LOG_INFO("Set system mode XO-Chip");
+			LOG_INFO_TO(logger, "Set system mode XO-Chip");
 			res.base_height = 64;
 			res.base_width = 128;
 			res.hires = false;
@@ -219,7 +590,225 @@ Chip8::SYSTEM_MODE Chip8::GetSystemMode()
 	return mode;
 }
 
+void Chip8::GetCPUState(CPUState& state) const
+{
+	state.regs = regs;
+	state.pc = pc;
+	state.sp = sp;
+	state.StackSize = StackSize;
+	memcpy(state.Stack, Stack, sizeof(state.Stack));
+	state.EntryPoint = EntryPoint;
+	state.RamLimit = RamLimit;
+	state.sound_timer = sound_timer;
+	state.delay_timer = delay_timer;
+	state.active_plane = active_plane;
+	state.halted = halted;
+	memcpy(state.Keys, Keys, 16);
+	memcpy(state.PrevKeys, PrevKeys, 16);
+	memcpy(state.RPLMemory, RPLMemory, RPL_SIZE);
+	memcpy(state.audio_pattern, audio_pattern, 16);
+	memcpy(state.rng_state, rng.state, sizeof(rng.state));
+	state.mode = mode;
+	state.quirks = quirks;
+	state.res = res;
+}
+
+void Chip8::SetCPUState(const CPUState& state)
+{
+	regs = state.regs;
+	pc = state.pc;
+	sp = state.sp;
+	StackSize = state.StackSize;
+	memcpy(Stack, state.Stack, sizeof(state.Stack));
+	EntryPoint = state.EntryPoint;
+	RamLimit = state.RamLimit;
+	sound_timer = state.sound_timer;
+	delay_timer = state.delay_timer;
+	active_plane = state.active_plane;
+	halted = state.halted;
+	memcpy(Keys, state.Keys, 16);
+	memcpy(PrevKeys, state.PrevKeys, 16);
+	memcpy(RPLMemory, state.RPLMemory, RPL_SIZE);
+	memcpy(audio_pattern, state.audio_pattern, 16);
+	memcpy(rng.state, state.rng_state, sizeof(rng.state));
+	mode = state.mode;
+	quirks = state.quirks;
+	res = state.res;
+	ResizeVRAM();
+	m_Run_Cycles = 0;
+	profiler_calls_stale = true;
+}
+
+//Save state file layout (little endian):
+//    StateHeader
+//    CPUState, raw
+//    RAM from 0x000 to RamLimit
+//    VRAM, one bit per pixel, one full plane after the other (plane 1 first)
+#pragma pack(push, 1)
+struct StateHeader {
+	char magic[4];          //"KIP8"
+	uint16_t version;       //Chip8::STATE_VERSION
+	uint16_t cpu_size;      //sizeof(Chip8::CPUState), rejects states written by a build with a different struct layout
+	uint32_t ram_size;      //RamLimit + 1
+	uint8_t vram_width;
+	uint8_t vram_height;
+	uint8_t vram_planes;
+	uint8_t reserved;
+	uint32_t payload_size;  //bytes following the header
+	uint32_t checksum;      //CRC-32 of the payload
+};
+#pragma pack(pop)
+
+const uint16_t Chip8::STATE_VERSION;
+static const int STATE_PLANES = 2;
+
+bool Chip8::SaveState(const std::string& filename)
+{
+	CPUState cpu;
+	memset((void*)&cpu, 0, sizeof(cpu)); //keep the padding bytes deterministic so identical states produce identical files
+	GetCPUState(cpu);
+
+	uint32_t ram_size = (uint32_t)RamLimit + 1;
+	uint32_t pixels = res.base_width * res.base_height;
+	uint32_t plane_bytes = (pixels + 7) / 8; //a partial last byte when the screen isn't a multiple of 8 pixels
+
+	std::vector<uint8_t> payload(sizeof(CPUState) + ram_size + (plane_bytes * STATE_PLANES), 0);
+	uint8_t* out = payload.data();
+	memcpy(out, &cpu, sizeof(CPUState));
+	out += sizeof(CPUState);
+	CopyRAM(0, out, ram_size);
+	out += ram_size;
+	for (int plane_it = 0; plane_it < STATE_PLANES; plane_it++)
+	{
+		uint8_t plane_mask = 1 << plane_it;
+		for (uint32_t it = 0; it < pixels; it++)
+		{
+			if (FrameBuffer[it] & plane_mask)
+				out[it / 8] |= 0x80 >> (it % 8);
+		}
+		out += plane_bytes;
+	}
+
+	StateHeader header;
+	memcpy(header.magic, "KIP8", 4);
+	header.version = STATE_VERSION;
+	header.cpu_size = (uint16_t)sizeof(CPUState);
+	header.ram_size = ram_size;
+	header.vram_width = res.base_width;
+	header.vram_height = res.base_height;
+	header.vram_planes = STATE_PLANES;
+	header.reserved = 0;
+	header.payload_size = (uint32_t)payload.size();
+	header.checksum = Crc32(payload.data(), payload.size());
+
+	std::ofstream ofd(filename, std::ios::binary | std::ios::out | std::ios::trunc);
+	if (!ofd.good())
+	{
+		LOG_ERROR_TO(logger, "Could not open file to save state: {}", filename);
+		return false;
+	}
+	ofd.write((char*)&header, sizeof(header));
+	ofd.write((char*)payload.data(), payload.size());
+	ofd.close();
+	if (!ofd.good())
+	{
+		LOG_ERROR_TO(logger, "Failed writing save state: {}", filename);
+		return false;
+	}
+
+	LOG_INFO_TO(logger, "Saved state ({} bytes): {}", sizeof(header) + payload.size(), filename);
+	return true;
+}
+
+bool Chip8::LoadState(const std::string& filename)
+{
+	MappedFile file;
+	if (!file.Open(filename))
+	{
+		LOG_ERROR_TO(logger, "Could not open save state: {}", filename);
+		return false;
+	}
+
+	StateHeader header;
+	if (file.Size() < sizeof(header))
+	{
+		LOG_ERROR_TO(logger, "Save state is truncated: {}", filename);
+		return false;
+	}
+	memcpy(&header, file.Data(), sizeof(header));
+
+	if (memcmp(header.magic, "KIP8", 4) != 0)
+	{
+		LOG_ERROR_TO(logger, "Not a KIP-8 save state: {}", filename);
+		return false;
+	}
+	if (header.version != STATE_VERSION || header.cpu_size != sizeof(CPUState))
+	{
+		LOG_ERROR_TO(logger, "Save state version {} does not match this build (version {}): {}", header.version, STATE_VERSION, filename);
+		return false;
+	}
+
+	uint32_t pixels = header.vram_width * header.vram_height;
+	uint32_t plane_bytes = (pixels + 7) / 8; //as SaveState wrote them, the size checks below hold the file to it
+	if (header.ram_size == 0 || header.ram_size > 0x10000 || header.vram_width > 128 || header.vram_height > 64 || header.vram_planes != STATE_PLANES
+		|| header.payload_size != sizeof(CPUState) + header.ram_size + (plane_bytes * STATE_PLANES)
+		|| file.Size() != sizeof(header) + header.payload_size)
+	{
+		LOG_ERROR_TO(logger, "Save state header is corrupt: {}", filename);
+		return false;
+	}
+
+	const uint8_t* in = file.Data() + sizeof(header);
+	if (Crc32(in, header.payload_size) != header.checksum)
+	{
+		LOG_ERROR_TO(logger, "Save state checksum mismatch, file is corrupt: {}", filename);
+		return false;
+	}
+
+	CPUState cpu;
+	memcpy((void*)&cpu, in, sizeof(CPUState));
+	in += sizeof(CPUState);
+	if ((uint32_t)cpu.RamLimit + 1 != header.ram_size || cpu.res.base_width != header.vram_width || cpu.res.base_height != header.vram_height
+		|| cpu.StackSize > 16 || cpu.sp >= cpu.StackSize || cpu.sp < -1)
+	{
+		LOG_ERROR_TO(logger, "Save state contents are corrupt: {}", filename);
+		return false;
+	}
+
+	SetCPUState(cpu);
+
+	ResetMemory(false);
+	SetRAM(0, in, header.ram_size);
+	in += header.ram_size;
+
+	std::fill(FrameBuffer.begin(), FrameBuffer.end(), 0);
+	for (int plane_it = 0; plane_it < STATE_PLANES; plane_it++)
+	{
+		uint8_t plane_mask = 1 << plane_it;
+		for (uint32_t it = 0; it < pixels && it / 8 < plane_bytes; it++)
+		{
+			if (in[it / 8] & (0x80 >> (it % 8)))
+				FrameBuffer[it] |= plane_mask;
+		}
+		in += plane_bytes;
+	}
+
+	RehashVRAM();
+	ClearPrevVRAM();
+	SetScreenDirty();
+	SetWipeScreen();
+
+	LOG_INFO_TO(logger, "Loaded save state: {}", filename);
+	return true;
+}
+
 void Chip8::Decode_Execute(uint16_t opcode) {
+	//locals for the framebuffer loops. byte stores through fb may alias any member, so using members directly
+	//would force them to be reloaded on every pixel
+	uint8_t* fb = FrameBuffer.data();
+	const uint8_t planes = active_plane;
+	const uint8_t width = res.base_width;
+	const uint8_t height = res.base_height;
 	uint8_t op_nibs[4] = { 0 };
 	op_nibs[0] = (uint8_t)((opcode & 0xf000) >> 12);
 	op_nibs[1] = (uint8_t)((opcode & 0x0f00) >> 8);
@@ -231,10 +820,11 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 	{
 		if ((opcode & 0x0FF0) == 0x0C0) // 0x00CN, scroll display down N pixels (SUPER-CHIP)
 		{
-			LOG_TRACE("[{:04X}] {:04X}\t00CN\tSCHIP  \tScroll down N", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t00CN\tSCHIP  \tScroll down N", pc - 2, opcode);
 			if (mode == SYSTEM_MODE::CHIP_8)
 			{
-				LOG_ERROR("Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+				LOG_ERROR_TO(logger, "Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+				faults.invalid_opcodes++;
 			}
 			else
 			{
@@ -243,23 +833,24 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 					break;
 				
 				SetScreenDirty();
+				vram_hash_stale = true; //scrolls touch every pixel, rehashing once on demand is cheaper than tracking each one
 
 				uint8_t yoffset = op_nibs[3];
-				uint8_t bytes_per_line = res.base_width;
+				uint8_t bytes_per_line = width;
 
-				for (uint8_t i = res.base_height - 1; i >= yoffset; i--) //i is the y iterator, j is the x iterator
+				for (uint8_t i = height - 1; i >= yoffset; i--) //i is the y iterator, j is the x iterator
 				{
 					for (uint8_t j = 0; j < bytes_per_line; j++)
 					{
-						FrameBuffer[i * (bytes_per_line)+j] &= ~active_plane; //erase the bits corresponding to the in use draw plane, which will be shifted
-						FrameBuffer[i * (bytes_per_line)+j] |= (FrameBuffer[(i - yoffset) * (bytes_per_line) + j]) & active_plane; // shift the affected bits by ORing them from source to destination
+						fb[i * (bytes_per_line)+j] &= ~planes; //erase the bits corresponding to the in use draw plane, which will be shifted
+						fb[i * (bytes_per_line)+j] |= (fb[(i - yoffset) * (bytes_per_line) + j]) & planes; // shift the affected bits by ORing them from source to destination
 					}
 				}
 				for (int8_t i = yoffset - 1; i >= 0; i--) //i is the y iterator, j is the x iterator
 				{
 					for (uint8_t j = 0; j < bytes_per_line; j++)
 					{
-						FrameBuffer[i * (bytes_per_line)+j] &= ~active_plane; //erase the bits corresponding to the in use draw plane, which will be shifted
+						fb[i * (bytes_per_line)+j] &= ~planes; //erase the bits corresponding to the in use draw plane, which will be shifted
 					}
 				}
 			}
@@ -267,14 +858,16 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 		}
 		if ((opcode & 0x0FF0) == 0x0D0) // 0x00DN, scroll display up N pixels (XO-Chip)
 		{
-			LOG_TRACE("[{:04X}] {:04X}\t00DN\tXO-CHIP\tScroll up N", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t00DN\tXO-CHIP\tScroll up N", pc - 2, opcode);
 			if (mode == SYSTEM_MODE::CHIP_8)
 			{
-				LOG_ERROR("Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+				LOG_ERROR_TO(logger, "Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+				faults.invalid_opcodes++;
 			}
 			else if(mode == SYSTEM_MODE::SUPER_CHIP)
 			{
-				LOG_ERROR("Opcode not valid in SUPER-CHIP Mode: {:04X}", opcode);
+				LOG_ERROR_TO(logger, "Opcode not valid in SUPER-CHIP Mode: {:04X}", opcode);
+				faults.invalid_opcodes++;
 			}
 			else
 			{
@@ -282,25 +875,26 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 					break;
 
 				SetScreenDirty();
+				vram_hash_stale = true;
 
 				uint8_t yoffset = op_nibs[3];
 				if (!res.hires)
 					yoffset *= 2;
-				uint8_t bytes_per_line = res.base_width;
+				uint8_t bytes_per_line = width;
 
-				for (int i = 0; i < res.base_height - yoffset; i++) //i is the y iterator, j is the x iterator
+				for (int i = 0; i < height - yoffset; i++) //i is the y iterator, j is the x iterator
 				{
 					for (uint8_t j = 0; j < bytes_per_line; j++)
 					{
-						FrameBuffer[i * (bytes_per_line)+j] &= ~active_plane; //erase the bits corresponding to the in use draw plane, which will be shifted
-						FrameBuffer[i * (bytes_per_line)+j] |= (FrameBuffer[(i + yoffset) * (bytes_per_line) + j]) & active_plane; // shift the affected bits by ORing them from source to destination
+						fb[i * (bytes_per_line)+j] &= ~planes; //erase the bits corresponding to the in use draw plane, which will be shifted
+						fb[i * (bytes_per_line)+j] |= (fb[(i + yoffset) * (bytes_per_line) + j]) & planes; // shift the affected bits by ORing them from source to destination
 					}
 				}
-				for (int i = res.base_height - (yoffset); i < res.base_height; i++) //i is the y iterator, j is the x iterator
+				for (int i = height - (yoffset); i < height; i++) //i is the y iterator, j is the x iterator
 				{
 					for (uint8_t j = 0; j < bytes_per_line; j++)
 					{
-						FrameBuffer[i * (bytes_per_line) + j] &= ~active_plane; //erase the bits corresponding to the in use draw plane, which will be shifted
+						fb[i * (bytes_per_line) + j] &= ~planes; //erase the bits corresponding to the in use draw plane, which will be shifted
 					}
 				}
 			}
@@ -310,13 +904,12 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 		{
 			case(0x0E0): // 0x00E0, clear screen
 			{
-				LOG_TRACE("[{:04X}] {:04X}\t00E0\tCHIP-8 \tClear screen", pc - 2, opcode);	
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t00E0\tCHIP-8 \tClear screen", pc - 2, opcode);	
 				
-				for (int it = 0; it < res.base_height * res.base_width; it++)
-				{
-					FrameBuffer[it] &= ~active_plane;
-					PreviousFramebuffer[it] &= ~active_plane;
-				}
+				for (int it = 0; it < height * width; it++)
+					SetPixel(it, fb[it] & ~planes);
+				for (uint8_t& pixel : PreviousFramebuffer)
+					pixel &= ~planes;
 
 				SetScreenDirty();
 				SetWipeScreen();
@@ -324,40 +917,47 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 			}
 			case(0x0EE): //0x00EE, return
 			{
-				LOG_TRACE("[{:04X}] {:04X}\t00EE\tCHIP-8 \tReturn", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t00EE\tCHIP-8 \tReturn", pc - 2, opcode);
 				if (sp >= 0)
 				{
 					//set program counter to top value of stack, decrement stack pointer
 					pc = Stack[sp];
 					sp--;
+					if (profiler)
+						profiler->Return();
 					break;
 				}
 				else
 				{
-					LOG_ERROR("Invalid stack operation. Stack underflow!");
-					LOG_INFO("PC: {:04X}", pc - 2);
+					LOG_ERROR_TO(logger, "Invalid stack operation. Stack underflow!");
+					faults.stack_errors++;
+					LOG_INFO_TO(logger, "PC: {:04X}", pc - 2);
 					Halt();
 					break;
 				}
 			}
 			case(0x0FB): //0x00FB, scroll right. 4 pixels in hi-res, 2 pixels in low-res (SUPER-CHIP)
 			{
-				LOG_TRACE("[{:04X}] {:04X}\t00FB\tSCHIP  \tScroll right", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t00FB\tSCHIP  \tScroll right", pc - 2, opcode);
 				if (mode == SYSTEM_MODE::CHIP_8)
-					LOG_ERROR("Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+				{
+					LOG_ERROR_TO(logger, "Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+					faults.invalid_opcodes++;
+				}
 				else
 				{
 					SetScreenDirty();
-					for (uint8_t y = 0; y < res.base_height; y++)
+					vram_hash_stale = true;
+					for (uint8_t y = 0; y < height; y++)
 					{
-						for (uint8_t x = res.base_width - 1; x >= 4; x--)
+						for (uint8_t x = width - 1; x >= 4; x--)
 						{
-							FrameBuffer[y * (res.base_width) + x] &= ~active_plane; //erase the bits corresponding to the in use draw plane, which will be shifted
-							FrameBuffer[y * (res.base_width) + x] |= ((FrameBuffer[y * (res.base_width) + x - 4]) & active_plane); // shift the affected bits by ORing them from source to destination
+							fb[y * (width) + x] &= ~planes; //erase the bits corresponding to the in use draw plane, which will be shifted
+							fb[y * (width) + x] |= ((fb[y * (width) + x - 4]) & planes); // shift the affected bits by ORing them from source to destination
 						}
 						for (int8_t x = 3; x >= 0; x--)
 						{
-							FrameBuffer[y * (res.base_width) + x] &= ~active_plane; //erase the bits corresponding to the in use draw plane, which will be shifted
+							fb[y * (width) + x] &= ~planes; //erase the bits corresponding to the in use draw plane, which will be shifted
 						}
 					}
 
@@ -366,22 +966,26 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 			}
 			case(0x0FC): //0x00FC, scroll left. 4 pixels in hi-res, 2 pixels in low-res (SUPER-CHIP)
 			{
-				LOG_TRACE("[{:04X}] {:04X}\t00FC\tSCHIP  \tScroll left", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t00FC\tSCHIP  \tScroll left", pc - 2, opcode);
 				if (mode == SYSTEM_MODE::CHIP_8)
-					LOG_ERROR("Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+				{
+					LOG_ERROR_TO(logger, "Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+					faults.invalid_opcodes++;
+				}
 				else
 				{
 					SetScreenDirty();
-					for (uint8_t y = 0; y < res.base_height; y++)
+					vram_hash_stale = true;
+					for (uint8_t y = 0; y < height; y++)
 					{
-						for (uint8_t x = 0; x < res.base_width - 4; x++)
+						for (uint8_t x = 0; x < width - 4; x++)
 						{
-							FrameBuffer[y * (res.base_width) + x] &= ~active_plane; //erase the bits corresponding to the in use draw plane, which will be shifted
-							FrameBuffer[y * (res.base_width) + x] |= ((FrameBuffer[y * (res.base_width) + x + 4]) & active_plane); // shift the affected bits by ORing them from source to destination
+							fb[y * (width) + x] &= ~planes; //erase the bits corresponding to the in use draw plane, which will be shifted
+							fb[y * (width) + x] |= ((fb[y * (width) + x + 4]) & planes); // shift the affected bits by ORing them from source to destination
 						}
-						for (uint8_t x = res.base_width - 4; x < res.base_width; x++)
+						for (uint8_t x = width - 4; x < width; x++)
 						{
-							FrameBuffer[y * (res.base_width) + x] &= ~active_plane; //erase the bits corresponding to the in use draw plane, which will be shifted
+							fb[y * (width) + x] &= ~planes; //erase the bits corresponding to the in use draw plane, which will be shifted
 						}
 					}
 				}
@@ -389,27 +993,35 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 			}
 			case(0x0FD): //0x00FD, Exit Interpreter (SUPER-CHIP)
 			{
-				LOG_TRACE("[{:04X}] {:04X}\t00FD\tSCHIP  \tExit interpreter", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t00FD\tSCHIP  \tExit interpreter", pc - 2, opcode);
 				if (mode == SYSTEM_MODE::CHIP_8)
-					LOG_ERROR("Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+				{
+					LOG_ERROR_TO(logger, "Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+					faults.invalid_opcodes++;
+				}
 				else
 				{
-					LOG_WARN("Exit Interpreter called by program.");
+					LOG_WARN_TO(logger, "Exit Interpreter called by program.");
 					Halt();
 				}
 				break;
 			}
 			case(0x0FE): //0x00FE, Disable Hi-Res (SUPER-CHIP)
 			{
-				LOG_TRACE("[{:04X}] {:04X}\t00FE\tSCHIP  \tDisable Hi-Res", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t00FE\tSCHIP  \tDisable Hi-Res", pc - 2, opcode);
 				if (mode == SYSTEM_MODE::CHIP_8)
-					LOG_ERROR("Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+				{
+					LOG_ERROR_TO(logger, "Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+					faults.invalid_opcodes++;
+				}
 				else
 				{
 					if (mode == SYSTEM_MODE::XO_CHIP)
 					{
-						std::fill_n(FrameBuffer, 128 * 64, 0); //wipes all draw planes clean
-						std::fill_n(PreviousFramebuffer, 128 * 64, 0);
+						std::fill(FrameBuffer.begin(), FrameBuffer.end(), 0); //wipes all draw planes clean
+						vram_hash = 0;
+						vram_hash_stale = false;
+						ClearPrevVRAM();
 						SetScreenDirty();
 						SetWipeScreen();
 					}
@@ -419,17 +1031,20 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 			}
 			case(0x0FF): //0x00FF, Enable Hi-Res (SUPER-CHIP)
 			{
-				LOG_TRACE("[{:04X}] {:04X}\t00FF\tSCHIP  \tEnable Hi-Res", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t00FF\tSCHIP  \tEnable Hi-Res", pc - 2, opcode);
 				if (mode == SYSTEM_MODE::CHIP_8)
 				{
-					LOG_ERROR("Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+					LOG_ERROR_TO(logger, "Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+					faults.invalid_opcodes++;
 				}
 				else
 				{
 					if (mode == SYSTEM_MODE::XO_CHIP)
 					{
-						std::fill_n(FrameBuffer, 128 * 64, 0); //wipes all draw planes clean
-						std::fill_n(PreviousFramebuffer, 128 * 64, 0);
+						std::fill(FrameBuffer.begin(), FrameBuffer.end(), 0); //wipes all draw planes clean
+						vram_hash = 0;
+						vram_hash_stale = false;
+						ClearPrevVRAM();
 						SetScreenDirty();
 						SetWipeScreen();
 					}
@@ -438,7 +1053,8 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 				break;
 			}
 			default:
-				LOG_ERROR("[{:04X}] {:04X}\tUnknown opcode", pc - 2, opcode);
+				LOG_ERROR_TO(logger, "[{:04X}] {:04X}\tUnknown opcode", pc - 2, opcode);
+				faults.invalid_opcodes++;
 				Halt();
 				break;
 		}
@@ -446,17 +1062,18 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 	}
 	case(0x1): //1NNN, jump
 	{
-		LOG_TRACE("[{:04X}] {:04X}\t1NNN\tCHIP-8 \tJump", pc - 2, opcode);
+		LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t1NNN\tCHIP-8 \tJump", pc - 2, opcode);
 		pc = (uint16_t)(opcode & 0x0FFF);
 		break;
 	}
 	case(0x2): //2NNN, call
 	{
-		LOG_TRACE("[{:04X}] {:04X}\t2NNN\tCHIP-8 \tCall", pc - 2, opcode);
+		LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t2NNN\tCHIP-8 \tCall", pc - 2, opcode);
 		//push current pc to top of stack
 		if (sp + 1 >= StackSize)
 		{
-			LOG_ERROR("Invalid stack operation. Stack overflow!\n\tPC: {:04X}", pc - 2);
+			LOG_ERROR_TO(logger, "Invalid stack operation. Stack overflow!\n\tPC: {:04X}", pc - 2);
+			faults.stack_errors++;
 			Halt();
 			break;
 		}
@@ -467,15 +1084,17 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 
 			//set pc to NNN
 			pc = (uint16_t)(opcode & 0x0FFF);
+			if (profiler)
+				profiler->Call(pc);
 		}
 		break;
 	}
 	case(0x3): //3XNN, skip over the next opcode if VX == NN
 	{
-		LOG_TRACE("[{:04X}] {:04X}\t3XNN\tCHIP-8 \tSkip if VX == NN", pc - 2, opcode);
+		LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t3XNN\tCHIP-8 \tSkip if VX == NN", pc - 2, opcode);
 		if (regs.v[op_nibs[1]] == (opcode & 0x00FF))
 		{
-			if (mode == SYSTEM_MODE::XO_CHIP && (((Memory[pc] << 8) | Memory[pc+1]) == 0xF000))
+			if (mode == SYSTEM_MODE::XO_CHIP && (Fetch(pc) == 0xF000))
 				pc += 2;
 			pc += 2;
 		}
@@ -483,10 +1102,10 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 	}
 	case(0x4): //4XNN, skip over the next opcode if VX != NN
 	{
-		LOG_TRACE("[{:04X}] {:04X}\t4XNN\tCHIP-8 \tSkip if VX != NN", pc - 2, opcode);
+		LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t4XNN\tCHIP-8 \tSkip if VX != NN", pc - 2, opcode);
 		if (regs.v[op_nibs[1]] != (opcode & 0x00FF))
 		{
-			if (mode == SYSTEM_MODE::XO_CHIP && (((Memory[pc] << 8) | Memory[pc+1]) == 0xF000))
+			if (mode == SYSTEM_MODE::XO_CHIP && (Fetch(pc) == 0xF000))
 				pc += 2;
 			pc += 2;
 		}
@@ -498,10 +1117,10 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 		{
 			case(0): //5XY0, skip over the next opcode if VX == VY
 			{
-				LOG_TRACE("[{:04X}] {:04X}\t5XY0\tCHIP-8 \tSkip if VX == VY", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t5XY0\tCHIP-8 \tSkip if VX == VY", pc - 2, opcode);
 				if (regs.v[op_nibs[1]] == regs.v[op_nibs[2]])
 				{
-					if (mode == SYSTEM_MODE::XO_CHIP && (((Memory[pc] << 8) | Memory[pc + 1]) == 0xF000))
+					if (mode == SYSTEM_MODE::XO_CHIP && (Fetch(pc) == 0xF000))
 						pc += 2;
 					pc += 2;
 				}
@@ -511,15 +1130,17 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 			{
 				if (mode == SYSTEM_MODE::CHIP_8)
 				{
-					LOG_ERROR("Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+					LOG_ERROR_TO(logger, "Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+					faults.invalid_opcodes++;
 					break;
 				}
 				else if (mode == SYSTEM_MODE::SUPER_CHIP)
 				{
-					LOG_ERROR("Opcode not valid in SUPER-CHIP Mode: {:04X}", opcode);
+					LOG_ERROR_TO(logger, "Opcode not valid in SUPER-CHIP Mode: {:04X}", opcode);
+					faults.invalid_opcodes++;
 					break;
 				}
-				LOG_TRACE("[{:04X}] {:04X}\t5XY2\tXO-CHIP\tSave VX to VY at I", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t5XY2\tXO-CHIP\tSave VX to VY at I", pc - 2, opcode);
 				bool ascending_order = op_nibs[1] < op_nibs[2] ? true : false;
 				uint8_t num_of_regs;
 				if (ascending_order)
@@ -532,7 +1153,8 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 				}
 				if (regs.i < 0 || regs.i >(RamLimit + 1 - (num_of_regs)))
 				{
-					LOG_ERROR("Attempted memory access violation.\nAttempt to store register contents outside bounds of Memory: {:04X}\n\tPC: {:04X}", regs.i, pc - 2);
+					LOG_ERROR_TO(logger, "Attempted memory access violation.\nAttempt to store register contents outside bounds of Memory: {:04X}\n\tPC: {:04X}", regs.i, pc - 2);
+					faults.memory_errors++;
 					Halt();
 					break;
 				}
@@ -540,14 +1162,14 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 				{
 					for (uint8_t it = 0; it < num_of_regs; it++)
 					{
-						Memory[regs.i + it] = regs.v[op_nibs[1] + it];
+						StoreByte(regs.i + it, regs.v[op_nibs[1] + it]);
 					}
 				}
 				else
 				{
 					for (uint8_t it = 0; it < num_of_regs; it++)
 					{
-						Memory[regs.i + it] = regs.v[op_nibs[1] - it];
+						StoreByte(regs.i + it, regs.v[op_nibs[1] - it]);
 					}
 				}
 
@@ -557,15 +1179,17 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 			{
 				if (mode == SYSTEM_MODE::CHIP_8)
 				{
-					LOG_ERROR("Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+					LOG_ERROR_TO(logger, "Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+					faults.invalid_opcodes++;
 					break;
 				}
 				else if (mode == SYSTEM_MODE::SUPER_CHIP)
 				{
-					LOG_ERROR("Opcode not valid in SUPER-CHIP Mode: {:04X}", opcode);
+					LOG_ERROR_TO(logger, "Opcode not valid in SUPER-CHIP Mode: {:04X}", opcode);
+					faults.invalid_opcodes++;
 					break;
 				}
-				LOG_TRACE("[{:04X}] {:04X}\t5XY3\tXO-CHIP\tLoad VX to VY from I", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t5XY3\tXO-CHIP\tLoad VX to VY from I", pc - 2, opcode);
 				bool ascending_order = op_nibs[1] < op_nibs[2] ? true : false;
 				uint8_t num_of_regs;
 				if (ascending_order)
@@ -578,7 +1202,8 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 				}
 				if (regs.i < 0 || regs.i >(RamLimit + 1 - (num_of_regs)))
 				{
-					LOG_ERROR("Attempted memory access violation.\nAttempt to load registers from outside bounds of Memory: {:04X}\n\tPC: {:04X}", regs.i, pc - 2);
+					LOG_ERROR_TO(logger, "Attempted memory access violation.\nAttempt to load registers from outside bounds of Memory: {:04X}\n\tPC: {:04X}", regs.i, pc - 2);
+					faults.memory_errors++;
 					Halt();
 					break;
 				}
@@ -586,14 +1211,14 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 				{
 					for (uint8_t it = 0; it < num_of_regs; it++)
 					{
-						regs.v[op_nibs[1] + it] = Memory[regs.i + it];
+						regs.v[op_nibs[1] + it] = LoadByte(regs.i + it);
 					}
 				}
 				else
 				{
 					for (uint8_t it = 0; it < num_of_regs; it++)
 					{
-						regs.v[op_nibs[1] - it] = Memory[regs.i + it];
+						regs.v[op_nibs[1] - it] = LoadByte(regs.i + it);
 					}
 				}
 
@@ -601,7 +1226,8 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 			}
 			default:
 			{
-				LOG_ERROR("[{:04X}] {:04X}\tUnknown opcode", pc - 2, opcode);
+				LOG_ERROR_TO(logger, "[{:04X}] {:04X}\tUnknown opcode", pc - 2, opcode);
+				faults.invalid_opcodes++;
 				Halt();
 				break;
 			}
@@ -611,14 +1237,14 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 	}
 	case(0x6): //6XNN, set X register to NN
 	{
-		LOG_TRACE("[{:04X}] {:04X}\t6XNN\tCHIP-8 \tSet VX = NN", pc - 2, opcode);
+		LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t6XNN\tCHIP-8 \tSet VX = NN", pc - 2, opcode);
 		uint8_t value = opcode & 0x00FF;
 		regs.v[op_nibs[1]] = value;
 		break;
 	}
 	case(0x7)://7XNN, add NN to X register
 	{
-		LOG_TRACE("[{:04X}] {:04X}\t7XNN\tCHIP-8 \tSet VX = VX + NN", pc - 2, opcode);
+		LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t7XNN\tCHIP-8 \tSet VX = VX + NN", pc - 2, opcode);
 		unsigned int value = opcode & 0x00FF;
 		unsigned int old_vx = regs.v[op_nibs[1]];
 		regs.v[op_nibs[1]] = (uint8_t)((old_vx + value) % 0x100);
@@ -630,24 +1256,24 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 		{
 		case(0x0): //8XY0 	Store the value of register VY in register VX
 				   //       VY is not affected
-			LOG_TRACE("[{:04X}] {:04X}\t8XY0\tCHIP-8 \tSet VX = VY", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t8XY0\tCHIP-8 \tSet VX = VY", pc - 2, opcode);
 			regs.v[op_nibs[1]] = regs.v[op_nibs[2]];			
 			break;
 		case(0x1): //8XY1 	Set VX to VX OR VY
 				   //       VY is not affected
-			LOG_TRACE("[{:04X}] {:04X}\t8XY1\tCHIP-8 \tSet VX = VX OR VY", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t8XY1\tCHIP-8 \tSet VX = VX OR VY", pc - 2, opcode);
 			regs.v[op_nibs[1]] = regs.v[op_nibs[1]] | regs.v[op_nibs[2]];
 			if (quirks.logic_flag_reset) { regs.v[0xF] = 0; }			
 			break;
 		case(0x2): //8XY2 	Set VX to VX AND VY
 				   //       VY is not affected
-			LOG_TRACE("[{:04X}] {:04X}\t8XY2\tCHIP-8 \tSet VX = VX AND VY", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t8XY2\tCHIP-8 \tSet VX = VX AND VY", pc - 2, opcode);
 			regs.v[op_nibs[1]] = regs.v[op_nibs[1]] & regs.v[op_nibs[2]];
 			if (quirks.logic_flag_reset) { regs.v[0xF] = 0; }
 			break;
 		case(0x3): //8XY3 	Set VX to VX XOR VY
 				   //       VY is not affected
-			LOG_TRACE("[{:04X}] {:04X}\t8XY3\tCHIP-8 \tSet VX = VX XOR VY", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t8XY3\tCHIP-8 \tSet VX = VX XOR VY", pc - 2, opcode);
 			regs.v[op_nibs[1]] = regs.v[op_nibs[1]] ^ regs.v[op_nibs[2]];
 			if (quirks.logic_flag_reset) { regs.v[0xF] = 0; }
 			break;
@@ -655,7 +1281,7 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 		{		   //       VY is not affected
 				   //       Set VF to 01 if a carry occurs (VX + VY > 255)
 				   //       Set VF to 00 if a carry does not occur (VX + VY <= 255)
-			LOG_TRACE("[{:04X}] {:04X}\t8XY4\tCHIP-8 \tSet VX = VX + VY", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t8XY4\tCHIP-8 \tSet VX = VX + VY", pc - 2, opcode);
 			uint8_t carry = 0;
 			if (regs.v[op_nibs[1]] + regs.v[op_nibs[2]] > 0xFF)
 				carry = 1;
@@ -667,7 +1293,7 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 		{		   //       VY is not affected
 				   //       Set VF to 00 if a borrow occurs ( VX < VY)
 				   //       Set VF to 01 if a borrow does not occur (VX >= VY)
-			LOG_TRACE("[{:04X}] {:04X}\t8XY5\tCHIP-8 \tSet VX = VX - VY", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t8XY5\tCHIP-8 \tSet VX = VX - VY", pc - 2, opcode);
 			uint8_t borrow = 1;
 			if (regs.v[op_nibs[1]] < regs.v[op_nibs[2]])
 				borrow = 0;
@@ -680,12 +1306,12 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 				   //       Shift VX right 1, store the shifted bit in VF
 			if (quirks.vip_shifts)
 			{
-				LOG_TRACE("[{:04X}] {:04X}\t8XY6\tCHIP-8 \tSet VX = VY >> 1", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t8XY6\tCHIP-8 \tSet VX = VY >> 1", pc - 2, opcode);
 				regs.v[op_nibs[1]] = regs.v[op_nibs[2]];
 			}
 			else
 			{
-				LOG_TRACE("[{:04X}] {:04X}\t8XY6\tSCHIP  \tSet VX = VX >> 1", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t8XY6\tSCHIP  \tSet VX = VX >> 1", pc - 2, opcode);
 			}
 			regs.v[0xF] = regs.v[op_nibs[1]] & 0x01;
 			regs.v[op_nibs[1]] = regs.v[op_nibs[1]] >> 1;
@@ -695,7 +1321,7 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 		{		   //       VY is not affected
 				   //       Set VF to 00 if a borrow occurs ( VY < VX)
 				   //       Set VF to 01 if a borrow does not occur (VY >= VX)
-			LOG_TRACE("[{:04X}] {:04X}\t8XY7\tCHIP-8 \tSet VX = VY - VX", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t8XY7\tCHIP-8 \tSet VX = VY - VX", pc - 2, opcode);
 			uint8_t borrow = 1;
 			if (regs.v[op_nibs[2]] < regs.v[op_nibs[1]])
 				borrow = 0;
@@ -708,18 +1334,19 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 				   //       Shift VX left 1, store the shifted bit in VF
 			if (quirks.vip_shifts)
 			{
-				LOG_TRACE("[{:04X}] {:04X}\t8XYE\tCHIP-8 \tSet VX = VY << 1", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t8XYE\tCHIP-8 \tSet VX = VY << 1", pc - 2, opcode);
 				regs.v[op_nibs[1]] = regs.v[op_nibs[2]];
 			}
 			else
 			{
-				LOG_TRACE("[{:04X}] {:04X}\t8XYE\tSCHIP  \tSet VX = VX << 1", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t8XYE\tSCHIP  \tSet VX = VX << 1", pc - 2, opcode);
 			}
 			regs.v[0xF] = (regs.v[op_nibs[1]]) >> 7;
 			regs.v[op_nibs[1]] = regs.v[op_nibs[1]] << 1;
 			break;
 		default:
-			LOG_ERROR("[{:04X}] {:04X}\tUnknown opcode", pc - 2, opcode);
+			LOG_ERROR_TO(logger, "[{:04X}] {:04X}\tUnknown opcode", pc - 2, opcode);
+			faults.invalid_opcodes++;
 			Halt();
 			break;
 		}
@@ -727,10 +1354,10 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 	}
 	case(0x9): //9XY0, skip over the next opcode if VX != VY
 	{
-		LOG_TRACE("[{:04X}] {:04X}\t9XY0\tCHIP-8 \tSkip if VX != VY", pc - 2, opcode);
+		LOG_TRACE_TO(logger, "[{:04X}] {:04X}\t9XY0\tCHIP-8 \tSkip if VX != VY", pc - 2, opcode);
 		if (regs.v[op_nibs[1]] != regs.v[op_nibs[2]])
 		{
-			if (mode == SYSTEM_MODE::XO_CHIP && (((Memory[pc] << 8) | Memory[pc+1]) == 0xF000))
+			if (mode == SYSTEM_MODE::XO_CHIP && (Fetch(pc) == 0xF000))
 				pc += 2;
 			pc += 2;
 		}
@@ -738,7 +1365,7 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 	}
 	case(0xA): //ANNN, set I register to NNN
 	{
-		LOG_TRACE("[{:04X}] {:04X}\tANNN\tCHIP-8 \tSet I = NNN", pc - 2, opcode);
+		LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tANNN\tCHIP-8 \tSet I = NNN", pc - 2, opcode);
 		regs.i = (uint16_t)(opcode & 0x0FFF);
  		break;
 	}
@@ -746,20 +1373,20 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 	{          //QUIRK vip_jump: jump to NNN + v0 
 		if (quirks.vip_jump)
 		{
-			LOG_TRACE("[{:04X}] {:04X}\tBNNN\tCHIP-8 \tJump V0 + NNN", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tBNNN\tCHIP-8 \tJump V0 + NNN", pc - 2, opcode);
 			pc = (uint16_t)((opcode & 0x0FFF) + regs.v[0x0]);
 		}
 		else
 		{
-			LOG_TRACE("[{:04X}] {:04X}\tBNNN\tSCHIP  \tJump VX + XNN", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tBNNN\tSCHIP  \tJump VX + XNN", pc - 2, opcode);
 			pc = (uint16_t)((opcode & 0x0FFF) + regs.v[op_nibs[1]]);
 		}
 		break;
 	}
 	case(0xC): //CXNN, Set VX to a random number with a mask of NN
 	{
-		LOG_TRACE("[{:04X}] {:04X}\tCXNN\tCHIP-8 \tSet VX = Random() & NN", pc - 2, opcode);
-		regs.v[op_nibs[1]] = rand() & (opcode & 0xFF);
+		LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tCXNN\tCHIP-8 \tSet VX = Random() & NN", pc - 2, opcode);
+		regs.v[op_nibs[1]] = rng.Next() & (opcode & 0xFF);
 		break;
 	}
 	case(0xD): //DXYN Draw Sprite
@@ -787,7 +1414,7 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 		uint8_t sprite_height = op_nibs[3];
 		if (mode != SYSTEM_MODE::CHIP_8)
 		{
-			LOG_TRACE("[{:04X}] {:04X}\tDXYN\tSCHIP  \tDraw Sprite", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tDXYN\tSCHIP  \tDraw Sprite", pc - 2, opcode);
 			if (sprite_height == 0)
 			{
 				sprite_height = 16;
@@ -797,7 +1424,7 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 			}
 		}
 		else
-			LOG_TRACE("[{:04X}] {:04X}\tDXYN\tCHIP-8 \tDraw Sprite", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tDXYN\tCHIP-8 \tDraw Sprite", pc - 2, opcode);
 
 
 		uint8_t pixel_size = 1;
@@ -848,15 +1475,16 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 
 				if (sprite_data_i + y >= RamLimit)
 				{
-					LOG_ERROR("Sprite data index out of bounds!\n\tPC: {:04X}", pc - 2);
+					LOG_ERROR_TO(logger, "Sprite data index out of bounds!\n\tPC: {:04X}", pc - 2);
+					faults.sprite_errors++;
 					Halt();
 				}
 
 				//sprite rows are 1 byte in low resolution mode, 2 bytes in high resolution mode
 				//this always reads in 2 bytes of data for a row, then uses bit shifts to keep 1 or both bytes depending on if it's low/high resolution mode
 				uint16_t upper_pixel, lower_pixel;
-				upper_pixel = Memory[sprite_data_i + (bytes_per_row * y)];
-				lower_pixel = Memory[sprite_data_i + ((bytes_per_row * y) + 1)];
+				upper_pixel = LoadByte(sprite_data_i + (bytes_per_row * y));
+				lower_pixel = LoadByte(sprite_data_i + ((bytes_per_row * y) + 1));
 				new_pixel = (upper_pixel << 8) | lower_pixel;
 				new_pixel = new_pixel >> (16 - sprite_width);
 
@@ -879,26 +1507,26 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 
 					if (new_pixel & (mask >> x))
 					{
-						if (FrameBuffer[((dest_y)*res.base_width) + (dest_x)] & plane_it)
+						if (fb[((dest_y)*res.base_width) + (dest_x)] & plane_it)
 						{
-							FrameBuffer[((dest_y)*res.base_width) + (dest_x)] &= ~plane_it;
+							SetPixel(((dest_y)*res.base_width) + (dest_x), fb[((dest_y)*res.base_width) + (dest_x)] & ~plane_it);
 							if (pixel_size == 2)
 							{
-								FrameBuffer[((dest_y)*res.base_width) + (dest_x + 1)] &= ~plane_it;
-								FrameBuffer[((dest_y + 1) * res.base_width) + (dest_x)] &= ~plane_it;
-								FrameBuffer[((dest_y + 1) * res.base_width) + (dest_x + 1)] &= ~plane_it;
+								SetPixel(((dest_y)*res.base_width) + (dest_x + 1), fb[((dest_y)*res.base_width) + (dest_x + 1)] & ~plane_it);
+								SetPixel(((dest_y + 1) * res.base_width) + (dest_x), fb[((dest_y + 1) * res.base_width) + (dest_x)] & ~plane_it);
+								SetPixel(((dest_y + 1) * res.base_width) + (dest_x + 1), fb[((dest_y + 1) * res.base_width) + (dest_x + 1)] & ~plane_it);
 							}
 							regs.v[0xF] = 1;
 							coll_this_line = true;
 						}
 						else
 						{
-							FrameBuffer[((dest_y)*res.base_width) + (dest_x)] |= plane_it;
+							SetPixel(((dest_y)*res.base_width) + (dest_x), fb[((dest_y)*res.base_width) + (dest_x)] | plane_it);
 							if (pixel_size == 2)
 							{
-								FrameBuffer[((dest_y)*res.base_width) + (dest_x + 1)] |= plane_it;
-								FrameBuffer[((dest_y + 1) * res.base_width) + (dest_x)] |= plane_it;
-								FrameBuffer[((dest_y + 1) * res.base_width) + (dest_x + 1)] |= plane_it;
+								SetPixel(((dest_y)*res.base_width) + (dest_x + 1), fb[((dest_y)*res.base_width) + (dest_x + 1)] | plane_it);
+								SetPixel(((dest_y + 1) * res.base_width) + (dest_x), fb[((dest_y + 1) * res.base_width) + (dest_x)] | plane_it);
+								SetPixel(((dest_y + 1) * res.base_width) + (dest_x + 1), fb[((dest_y + 1) * res.base_width) + (dest_x + 1)] | plane_it);
 							}
 						}
 					}
@@ -925,14 +1553,14 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 	{
 		if ((opcode & 0x00FF) == 0x009E) //EX9E, Skip the following instruction if the key corresponding to the hex value currently stored in register VX is pressed
 		{
-			LOG_TRACE("[{:04X}] {:04X}\tEX9E\tCHIP-8 \tSkip if Key VX Pressed", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tEX9E\tCHIP-8 \tSkip if Key VX Pressed", pc - 2, opcode);
 			if (regs.v[op_nibs[1]] > 0x000F)
 			{
-				LOG_WARN("Checking for invalid key code: {:02X}\n\tPC: {:04X}\n\tOP: {:04X}", regs.v[op_nibs[1]], pc - 2, opcode);
+				LOG_WARN_TO(logger, "Checking for invalid key code: {:02X}\n\tPC: {:04X}\n\tOP: {:04X}", regs.v[op_nibs[1]], pc - 2, opcode);
 			}
 			if (Keys[regs.v[op_nibs[1]] & 0x000F] != 0)
 			{
-				if (mode == SYSTEM_MODE::XO_CHIP && (((Memory[pc] << 8) | Memory[pc+1]) == 0xF000))
+				if (mode == SYSTEM_MODE::XO_CHIP && (Fetch(pc) == 0xF000))
 					pc += 2;
 				pc += 2;
 			}
@@ -940,20 +1568,21 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 		}
 		else if ((opcode & 0x00FF) == 0x00A1) //EXA1, Skip the following instruction if the key corresponding to the hex value currently stored in register VX is NOT pressed
 		{
-			LOG_TRACE("[{:04X}] {:04X}\tEXA1\tCHIP-8 \tSkip if Key VX Not Pressed", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tEXA1\tCHIP-8 \tSkip if Key VX Not Pressed", pc - 2, opcode);
 			if (regs.v[op_nibs[1]] > 0x000F)
 			{
-				LOG_WARN("Checking for invalid key code: {:02X}\n\tPC: {:04X}\n\tOP: {:04X}", regs.v[op_nibs[1]], pc - 2, opcode);
+				LOG_WARN_TO(logger, "Checking for invalid key code: {:02X}\n\tPC: {:04X}\n\tOP: {:04X}", regs.v[op_nibs[1]], pc - 2, opcode);
 			}
 			if (Keys[regs.v[op_nibs[1]] & 0x000F] == 0)
 			{
-				if (mode == SYSTEM_MODE::XO_CHIP && (((Memory[pc] << 8) | Memory[pc+1]) == 0xF000))
+				if (mode == SYSTEM_MODE::XO_CHIP && (Fetch(pc) == 0xF000))
 					pc += 2;
 				pc += 2;
 			}
 			break;
 		}
-		LOG_ERROR("[{:04X}] {:04X}\tUnknown opcode", pc - 2, opcode);
+		LOG_ERROR_TO(logger, "[{:04X}] {:04X}\tUnknown opcode", pc - 2, opcode);
+		faults.invalid_opcodes++;
 		Halt();
 		break;
 	}
@@ -963,24 +1592,27 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 		{
 			if (mode == SYSTEM_MODE::CHIP_8)
 			{
-				LOG_ERROR("Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+				LOG_ERROR_TO(logger, "Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+				faults.invalid_opcodes++;
 				break;
 			}
 			else if (mode == SYSTEM_MODE::SUPER_CHIP)
 			{
-				LOG_ERROR("Opcode not valid in SUPER-CHIP Mode: {:04X}", opcode);
+				LOG_ERROR_TO(logger, "Opcode not valid in SUPER-CHIP Mode: {:04X}", opcode);
+				faults.invalid_opcodes++;
 				break;
 			}
 			
-			LOG_TRACE("[{:04X}] {:04X}\tF000\tXO-CHIP\tSet I = NNNN", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tF000\tXO-CHIP\tSet I = NNNN", pc - 2, opcode);
 			if (pc + 1 > RamLimit)
 			{
-				LOG_ERROR("Attempted memory access violation.\nAttempt read outside bounds of Memory: {:04X}", pc);
+				LOG_ERROR_TO(logger, "Attempted memory access violation.\nAttempt read outside bounds of Memory: {:04X}", pc);
+				faults.memory_errors++;
 				Halt();
 			}
 			else
 			{
-				uint16_t addr = ((uint16_t)Memory[pc] << 8) | ((uint16_t)Memory[pc + 1]);
+				uint16_t addr = Fetch(pc);
 				regs.i = addr;
 				pc += 2;
 			}
@@ -993,17 +1625,19 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 		{
 			if (mode == SYSTEM_MODE::CHIP_8)
 			{
-				LOG_ERROR("Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+				LOG_ERROR_TO(logger, "Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+				faults.invalid_opcodes++;
 				break;
 			}
 			else if (mode == SYSTEM_MODE::SUPER_CHIP)
 			{
-				LOG_ERROR("Opcode not valid in SUPER-CHIP Mode: {:04X}", opcode);
+				LOG_ERROR_TO(logger, "Opcode not valid in SUPER-CHIP Mode: {:04X}", opcode);
+				faults.invalid_opcodes++;
 				break;
 			}
-			LOG_TRACE("[{:04X}] {:04X}\tFN01\tXO-CHIP\tSet Draw Plane(s)", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tFN01\tXO-CHIP\tSet Draw Plane(s)", pc - 2, opcode);
 			if (op_nibs[1] > 3) //TODO: allow more than 2 planes
-				LOG_WARN("Attempt to set invalid draw plane(s). Valid numbers are 0 - 3.");
+				LOG_WARN_TO(logger, "Attempt to set invalid draw plane(s). Valid numbers are 0 - 3.");
 			else
 				active_plane = op_nibs[1];
 			break;
@@ -1012,38 +1646,41 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 		{
 			if (mode == SYSTEM_MODE::CHIP_8)
 			{
-				LOG_ERROR("Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+				LOG_ERROR_TO(logger, "Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+				faults.invalid_opcodes++;
 				break;
 			}
 			else if (mode == SYSTEM_MODE::SUPER_CHIP)
 			{
-				LOG_ERROR("Opcode not valid in SUPER-CHIP Mode: {:04X}", opcode);
+				LOG_ERROR_TO(logger, "Opcode not valid in SUPER-CHIP Mode: {:04X}", opcode);
+				faults.invalid_opcodes++;
 				break;
 			}
 			if (opcode == 0xF002) 
 			{
-				LOG_TRACE("[{:04X}] {:04X}\tF002\tXO-CHIP\tLoad audio pattern buffer from I", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tF002\tXO-CHIP\tLoad audio pattern buffer from I", pc - 2, opcode);
 				if (regs.i + 15 > RamLimit)
 				{
-					LOG_ERROR("Attempted memory access violation.\nAttempt read outside bounds of Memory: {:04X}", regs.i);
+					LOG_ERROR_TO(logger, "Attempted memory access violation.\nAttempt read outside bounds of Memory: {:04X}", regs.i);
+					faults.memory_errors++;
 					Halt();
 					break;
 				}
 				//TODO: Implement XO-CHIP audio
 				for (int it = 0; it < 16; it++) //TODO: make this resize with configurable buffer length, not hard coded 16
 				{
-					audio_pattern[it] = Memory[regs.i + it];
+					audio_pattern[it] = LoadByte(regs.i + it);
 				}
 				
 			}
 			break;
 		}
 		case(0x07): //FX07, Store the current value of the delay timer in register VX
-			LOG_TRACE("[{:04X}] {:04X}\tFX07\tCHIP-8 \tSet VX = Delay Timer", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tFX07\tCHIP-8 \tSet VX = Delay Timer", pc - 2, opcode);
 			regs.v[op_nibs[1]] = GetDelayTimer();
 			break;
 		case(0x0A): //FX0A, Wait for a keypress and store the result in register VX
-			LOG_TRACE("[{:04X}] {:04X}\tFX0A\tCHIP-8 \tSet VX = Key [WAIT FOR KEY]", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tFX0A\tCHIP-8 \tSet VX = Key [WAIT FOR KEY]", pc - 2, opcode);
 			pc -= 2;
 			for (int i = 0; i < 16; i++)
 			{
@@ -1057,11 +1694,11 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 			}
 			break;
 		case(0x15): //FX15, Set the delay timer to the value of register VX
-			LOG_TRACE("[{:04X}] {:04X}\tFX15\tCHIP-8 \tSet Delay Timer = VX", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tFX15\tCHIP-8 \tSet Delay Timer = VX", pc - 2, opcode);
 			SetDelayTimer(regs.v[op_nibs[1]]);
 			break;
 		case(0x18): //FX18, Set the sound timer to the value of register VX
-			LOG_TRACE("[{:04X}] {:04X}\tFX18\tCHIP-8 \tSet Sound Timer = VX", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tFX18\tCHIP-8 \tSet Sound Timer = VX", pc - 2, opcode);
 			SetSoundTimer(regs.v[op_nibs[1]]);
 			break;
 		case(0x1E): //FX1E, Add the value stored in register VX to register I
@@ -1074,7 +1711,7 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 					regs.v[0xF] = 0;
 			}
 			regs.i += regs.v[op_nibs[1]];
-			LOG_TRACE("[{:04X}] {:04X}\tFX1E\tCHIP-8 \tSet I = I + VX", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tFX1E\tCHIP-8 \tSet I = I + VX", pc - 2, opcode);
 			break;
 		case(0x29): //FX29, Font character. Set I to the address for the font character stored in VX
 		{	        //The system font is loaded into memory starting at 0x50 on system start / reset
@@ -1085,12 +1722,12 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 			//    point I to a 10-byte font sprite for the digit in the lower nibble of VX (only digits 0-9)
 			if (quirks.schip_10_fonts && (regs.v[op_nibs[1]] > 0x0F) && (regs.v[op_nibs[1]] < 0x1A))
 			{
-				LOG_TRACE("[{:04X}] {:04X}\tFX29\tSCHIP  \tSet I = Large Font Char VX", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tFX29\tSCHIP  \tSet I = Large Font Char VX", pc - 2, opcode);
 				regs.i = 0x50 + ((regs.v[op_nibs[1]] & 0xF) * 10);
 			}
 			else
 			{
-				LOG_TRACE("[{:04X}] {:04X}\tFX29t\tCHIP-8 \tSet I = Font Char VX", pc - 2, opcode);
+				LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tFX29t\tCHIP-8 \tSet I = Font Char VX", pc - 2, opcode);
 				regs.i = ((regs.v[op_nibs[1]] & 0xF) * 5);
 			}
 			break;
@@ -1100,24 +1737,28 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 					//Large font characters are 0-9 only for SUPER-CHIP and 0-F for Octo & XO-Chip
 					//The characters are stored as 10 bytes each starting at 0x
 
-			LOG_TRACE("[{:04X}] {:04X}\tFX30\tSCHIP  \tSet I = Large Font Char VX", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tFX30\tSCHIP  \tSet I = Large Font Char VX", pc - 2, opcode);
 			if (mode == SYSTEM_MODE::CHIP_8)
-				LOG_ERROR("Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+			{
+				LOG_ERROR_TO(logger, "Opcode not valid in CHIP-8 Mode: {:04X}", opcode);
+				faults.invalid_opcodes++;
+			}
 			else
 			{
 				if ((regs.v[op_nibs[1]] > 0x9) && (mode == SYSTEM_MODE::SUPER_CHIP))
-					LOG_WARN("Improper argument. SUPER-CHIP only supports large font digits 0-9.");
+					LOG_WARN_TO(logger, "Improper argument. SUPER-CHIP only supports large font digits 0-9.");
 				regs.i = 0x50 + ((regs.v[op_nibs[1]] & 0xF) * 10);
 			}
 			break;
 		}
 		case(0x33): //FX33 Convert the value in VX to BCD, store the 3 byte value in memory at the address in I
 		{
-			LOG_TRACE("[{:04X}] {:04X}\tFX33\tCHIP-8 \tVX BCD, Store at I", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tFX33\tCHIP-8 \tVX BCD, Store at I", pc - 2, opcode);
 
 			if (regs.i < 0 || regs.i >(RamLimit - 2))
 			{
-				LOG_ERROR("Attempted memory access violation.\nAttempt to store BCD outside bounds of Memory: {:04X}\n\tPC: {:04X}", regs.i, pc - 2);
+				LOG_ERROR_TO(logger, "Attempted memory access violation.\nAttempt to store BCD outside bounds of Memory: {:04X}\n\tPC: {:04X}", regs.i, pc - 2);
+				faults.memory_errors++;
 				Halt();
 				break;
 			}
@@ -1131,19 +1772,20 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 
 			ones = VX % 10;
 
-			Memory[regs.i] = hundreds;
-			Memory[regs.i + 1] = tens;
-			Memory[regs.i + 2] = ones;
+			StoreByte(regs.i, hundreds);
+			StoreByte(regs.i + 1, tens);
+			StoreByte(regs.i + 2, ones);
 
 			break;
 		}
 		case(0x55): //FX55 Save registers in memory. Save register V0 through VX in memory starting at the address in I
 		{          
-			LOG_TRACE("[{:04X}] {:04X}\tFX55\tCHIP-8 \tSave V0 to VX at I", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tFX55\tCHIP-8 \tSave V0 to VX at I", pc - 2, opcode);
 			uint8_t num_of_regs = op_nibs[1] + 1;
 			if (regs.i < 0 || regs.i >(RamLimit + 1 - (num_of_regs)))
 			{
-				LOG_ERROR("Attempted memory access violation.\nAttempt to store register contents outside bounds of Memory: {:04X}\n\tPC: {:04X}", regs.i, pc - 2);
+				LOG_ERROR_TO(logger, "Attempted memory access violation.\nAttempt to store register contents outside bounds of Memory: {:04X}\n\tPC: {:04X}", regs.i, pc - 2);
+				faults.memory_errors++;
 				Halt();
 				break;
 			}
@@ -1152,7 +1794,7 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 			{
 				for (uint8_t it = 0; it < num_of_regs; it++)
 				{
-					Memory[regs.i] = regs.v[it];
+					StoreByte(regs.i, regs.v[it]);
 					regs.i++;
 				}
 			}
@@ -1160,7 +1802,7 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 			{
 				for (uint8_t it = 0; it < num_of_regs; it++)
 				{
-					Memory[regs.i + it] = regs.v[it];
+					StoreByte(regs.i + it, regs.v[it]);
 				}
 				if (quirks.schip_10_regs_read_write)
 					regs.i += num_of_regs - 1;
@@ -1169,13 +1811,14 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 		}
 		case(0x65): //FX65 Load memory into registers. Load the values in memory starting at the address in I into registers V0 to VX
 		{	  
-			LOG_TRACE("[{:04X}] {:04X}\tFX65\tCHIP-8 \tLoad V0 to VX from I", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tFX65\tCHIP-8 \tLoad V0 to VX from I", pc - 2, opcode);
 
 			uint8_t num_of_regs = op_nibs[1] + 1;
 
 			if (regs.i < 0 || regs.i >(RamLimit + 1 - num_of_regs))
 			{
-				LOG_ERROR("Attempted memory access violation.\nAttempt to load register contents from outside bounds of Memory: {:04X}\n\tPC: {:04X}", regs.i, pc - 2);
+				LOG_ERROR_TO(logger, "Attempted memory access violation.\nAttempt to load register contents from outside bounds of Memory: {:04X}\n\tPC: {:04X}", regs.i, pc - 2);
+				faults.memory_errors++;
 				Halt();
 				break;
 			}
@@ -1184,7 +1827,7 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 			{
 				for (uint8_t it = 0; it < num_of_regs; it++)
 				{
-					regs.v[it] = Memory[regs.i];
+					regs.v[it] = LoadByte(regs.i);
 					regs.i++;
 				}
 			}
@@ -1192,19 +1835,20 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 			{
 				for (uint8_t it = 0; it < num_of_regs; it++)
 				{
-					regs.v[it] = Memory[regs.i + it];
+					regs.v[it] = LoadByte(regs.i + it);
 				}
 			}
 			break;
 		}
 		case(0x75): //FX75 Save registers V0 to VX into RPL Memory (SUPER-CHIP)
 		{
-			LOG_TRACE("[{:04X}] {:04X}\tFX75\tSCHIP  \tSave V0 to VX in RPL Memory", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tFX75\tSCHIP  \tSave V0 to VX in RPL Memory", pc - 2, opcode);
 			uint8_t highest_reg = op_nibs[1];
-			if (highest_reg > 7)
+			uint8_t limit = mode == SYSTEM_MODE::XO_CHIP ? RPL_SIZE - 1 : 7; //XO-CHIP has 16 flags, SUPER-CHIP 8
+			if (highest_reg > limit)
 			{
-				LOG_WARN("Invalid argument. Attempting to save too many registers to RPL. Saving V0 to V7");
-				highest_reg = 7;
+				LOG_WARN_TO(logger, "Invalid argument. Attempting to save too many registers to RPL. Saving V0 to V{:X}", limit);
+				highest_reg = limit;
 			}
 
 			for (uint8_t i = 0; i <= highest_reg; i++)
@@ -1217,12 +1861,13 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 		}
 		case(0x85): //FX85 Load registers V0 to VX from RPL Memory (SUPER-CHIP)
 		{
-			LOG_TRACE("[{:04X}] {:04X}\tFX85\tSCHIP  \tLoad V0 to VX from RPL Memory", pc - 2, opcode);
+			LOG_TRACE_TO(logger, "[{:04X}] {:04X}\tFX85\tSCHIP  \tLoad V0 to VX from RPL Memory", pc - 2, opcode);
 			uint8_t highest_reg = op_nibs[1];
-			if (highest_reg > 7)
+			uint8_t limit = mode == SYSTEM_MODE::XO_CHIP ? RPL_SIZE - 1 : 7;
+			if (highest_reg > limit)
 			{
-				LOG_WARN("Invalid argument. Attempting to load too many registers from RPL. Loading V0 to V7");
-				highest_reg = 7;
+				LOG_WARN_TO(logger, "Invalid argument. Attempting to load too many registers from RPL. Loading V0 to V{:X}", limit);
+				highest_reg = limit;
 			}
 
 			for (uint8_t i = 0; i <= highest_reg; i++)
@@ -1232,14 +1877,16 @@ void Chip8::Decode_Execute(uint16_t opcode) {
 			break;
 		}
 		default:
-			LOG_ERROR("[{:04X}] {:04X}\tUnknown opcode", pc - 2, opcode);
+			LOG_ERROR_TO(logger, "[{:04X}] {:04X}\tUnknown opcode", pc - 2, opcode);
+			faults.invalid_opcodes++;
 			Halt();
 			break;
 		}
 		break;
 	}
 	default:
-		LOG_ERROR("[{:04X}] {:04X}\tUnknown opcode", pc - 2, opcode);
+		LOG_ERROR_TO(logger, "[{:04X}] {:04X}\tUnknown opcode", pc - 2, opcode);
+		faults.invalid_opcodes++;
 		Halt();
 		break;
 	}
@@ -0,0 +1,599 @@
+#include "Chip8Batch.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define CHIP8BATCH_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CHIP8BATCH_AVX2
+#else
+#include <cpuid.h>
+#define CHIP8BATCH_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+//LaneConfig bits. only what register opcodes look at, so lanes with different draw quirks still run together
+static const uint8_t CONFIG_MODE = 0x03;
+static const uint8_t CONFIG_LOGIC_FLAG_RESET = 0x04;
+static const uint8_t CONFIG_VIP_SHIFTS = 0x08;
+static const uint8_t CONFIG_VIP_JUMP = 0x10;
+
+const uint16_t Chip8Batch::NO_PAGE;
+
+#ifdef CHIP8BATCH_X86
+//Only the functions marked CHIP8BATCH_AVX2 are built for AVX2 and they only touch raw rows. Building the whole file
+//with /arch:AVX2 would also build the inline code it shares with other files (vector, Chip8.h) for AVX2, and the
+//linker is free to keep that copy for every caller, including the ones on CPUs without it.
+
+//the group mask of the 32 byte lanes at b, false when none of them are in the group
+CHIP8BATCH_AVX2 static inline bool Mask8(const uint8_t* g, size_t b, __m256i& m)
+{
+	m = _mm256_loadu_si256((const __m256i*)(g + b));
+	return !_mm256_testz_si256(m, m);
+}
+
+//same for 16 bit rows, 16 lanes at b with the byte mask widened to words
+CHIP8BATCH_AVX2 static inline bool Mask16(const uint8_t* g, size_t b, __m256i& m)
+{
+	__m128i bytes = _mm_loadu_si128((const __m128i*)(g + b));
+	if (_mm_testz_si128(bytes, bytes))
+		return false;
+	m = _mm256_cvtepi8_epi16(bytes);
+	return true;
+}
+
+CHIP8BATCH_AVX2 static inline __m256i Load8(const uint8_t* row, size_t b) { return _mm256_loadu_si256((const __m256i*)(row + b)); }
+CHIP8BATCH_AVX2 static inline __m256i Load8To16(const uint8_t* row, size_t b) { return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(row + b))); }
+CHIP8BATCH_AVX2 static inline __m256i Load16(const uint16_t* row, size_t b) { return _mm256_loadu_si256((const __m256i*)(row + b)); }
+
+//lanes outside the mask keep their old value
+CHIP8BATCH_AVX2 static inline void Store8(uint8_t* row, size_t b, __m256i val, __m256i m)
+{
+	_mm256_storeu_si256((__m256i*)(row + b), _mm256_blendv_epi8(Load8(row, b), val, m));
+}
+CHIP8BATCH_AVX2 static inline void Store16(uint16_t* row, size_t b, __m256i val, __m256i m)
+{
+	_mm256_storeu_si256((__m256i*)(row + b), _mm256_blendv_epi8(Load16(row, b), val, m));
+}
+
+CHIP8BATCH_AVX2 static inline __m256i Bit0(__m256i val) { return _mm256_and_si256(val, _mm256_set1_epi8(1)); }
+CHIP8BATCH_AVX2 static inline __m256i True1(__m256i mask) { return _mm256_and_si256(mask, _mm256_set1_epi8(1)); } //0xFF -> 1
+CHIP8BATCH_AVX2 static inline __m256i GreaterEqualU8(__m256i a, __m256i b) { return _mm256_cmpeq_epi8(_mm256_max_epu8(a, b), a); }
+
+//The opcodes of ExecuteVector that are worth vectorizing, over stride lanes. Mirrors the scalar cases there, returns
+//false for every other opcode
+CHIP8BATCH_AVX2 static bool ExecuteAvx2(uint16_t opcode, uint8_t lane_config, const uint8_t* g, size_t stride, uint8_t* const v[16], uint16_t* i, uint16_t* pc)
+{
+	const uint8_t x = (opcode >> 8) & 0xF;
+	const uint8_t y = (opcode >> 4) & 0xF;
+	const uint8_t nn = opcode & 0xFF;
+	const uint16_t nnn = opcode & 0xFFF;
+	uint8_t* vx = v[x];
+	uint8_t* vy = v[y];
+	uint8_t* vf = v[0xF];
+	__m256i m;
+
+	switch (opcode >> 12)
+	{
+	case(0x1): //1NNN
+		for (size_t b = 0; b < stride; b += 16)
+			if (Mask16(g, b, m)) Store16(pc, b, _mm256_set1_epi16((short)nnn), m);
+		return true;
+	case(0x6): //6XNN
+		for (size_t b = 0; b < stride; b += 32)
+			if (Mask8(g, b, m)) Store8(vx, b, _mm256_set1_epi8((char)nn), m);
+		return true;
+	case(0x7): //7XNN
+		for (size_t b = 0; b < stride; b += 32)
+			if (Mask8(g, b, m)) Store8(vx, b, _mm256_add_epi8(Load8(vx, b), _mm256_set1_epi8((char)nn)), m);
+		return true;
+	case(0x8):
+	{
+		const bool logic_reset = lane_config & CONFIG_LOGIC_FLAG_RESET;
+		const bool vip_shifts = lane_config & CONFIG_VIP_SHIFTS;
+		const uint8_t sub = opcode & 0xF;
+		switch (sub)
+		{
+		case(0x0):
+		case(0x1):
+		case(0x2):
+		case(0x3):
+			for (size_t b = 0; b < stride; b += 32)
+			{
+				if (!Mask8(g, b, m))
+					continue;
+				__m256i a = Load8(vx, b), c = Load8(vy, b);
+				__m256i result = sub == 0 ? c : sub == 1 ? _mm256_or_si256(a, c) : sub == 2 ? _mm256_and_si256(a, c) : _mm256_xor_si256(a, c);
+				Store8(vx, b, result, m);
+				if (sub && logic_reset)
+					Store8(vf, b, _mm256_setzero_si256(), m);
+			}
+			return true;
+		case(0x4): //8XY4, VF = carry
+			for (size_t b = 0; b < stride; b += 32)
+			{
+				if (!Mask8(g, b, m))
+					continue;
+				__m256i a = Load8(vx, b), c = Load8(vy, b);
+				__m256i sum = _mm256_add_epi8(a, c);
+				__m256i carry = _mm256_andnot_si256(_mm256_cmpeq_epi8(sum, a), GreaterEqualU8(a, sum)); //wrapped below a
+				Store8(vx, b, sum, m);
+				Store8(vf, b, True1(carry), m);
+			}
+			return true;
+		case(0x5): //8XY5, VF = no borrow
+		case(0x7): //8XY7, VX = VY - VX, VF = no borrow
+			for (size_t b = 0; b < stride; b += 32)
+			{
+				if (!Mask8(g, b, m))
+					continue;
+				__m256i a = Load8(vx, b), c = Load8(vy, b);
+				if (sub == 0x7)
+				{
+					__m256i t = a;
+					a = c;
+					c = t;
+				}
+				Store8(vx, b, _mm256_sub_epi8(a, c), m);
+				Store8(vf, b, True1(GreaterEqualU8(a, c)), m);
+			}
+			return true;
+		case(0x6): //8XY6, shift right
+		case(0xE): //8XYE, shift left
+			for (size_t b = 0; b < stride; b += 32)
+			{
+				if (!Mask8(g, b, m))
+					continue;
+				if (vip_shifts)
+					Store8(vx, b, Load8(vy, b), m);
+				__m256i a = Load8(vx, b);
+				Store8(vf, b, sub == 0xE ? Bit0(_mm256_srli_epi16(a, 7)) : Bit0(a), m);
+				a = Load8(vx, b); //VF may be VX
+				Store8(vx, b, sub == 0xE ? _mm256_add_epi8(a, a) : _mm256_and_si256(_mm256_srli_epi16(a, 1), _mm256_set1_epi8(0x7F)), m);
+			}
+			return true;
+		default:
+			return false;
+		}
+	}
+	case(0xA): //ANNN
+		for (size_t b = 0; b < stride; b += 16)
+			if (Mask16(g, b, m)) Store16(i, b, _mm256_set1_epi16((short)nnn), m);
+		return true;
+	case(0xB): //BNNN, NNN + V0 or XNN + VX
+	{
+		const uint8_t* offset = (lane_config & CONFIG_VIP_JUMP) ? v[0] : vx;
+		for (size_t b = 0; b < stride; b += 16)
+			if (Mask16(g, b, m)) Store16(pc, b, _mm256_add_epi16(_mm256_set1_epi16((short)nnn), Load8To16(offset, b)), m);
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+static uint64_t Xgetbv0()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	uint32_t low, high;
+	__asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+	return ((uint64_t)high << 32) | low;
+#endif
+}
+
+static bool DetectAvx2()
+{
+	unsigned int leaf1[4] = { 0 }, leaf7[4] = { 0 };
+#ifdef _MSC_VER
+	int regs[4];
+	__cpuid(regs, 0);
+	if (regs[0] < 7)
+		return false;
+	__cpuid(regs, 1);
+	memcpy(leaf1, regs, sizeof(regs));
+	__cpuidex(regs, 7, 0);
+	memcpy(leaf7, regs, sizeof(regs));
+#else
+	if (__get_cpuid_max(0, nullptr) < 7)
+		return false;
+	__get_cpuid(1, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+	__get_cpuid_count(7, 0, &leaf7[0], &leaf7[1], &leaf7[2], &leaf7[3]);
+#endif
+	bool osxsave = leaf1[2] & (1 << 27);
+	bool avx = leaf1[2] & (1 << 28);
+	bool avx2 = leaf7[1] & (1 << 5);
+	//the OS also has to save the YMM registers on a context switch
+	return osxsave && avx && avx2 && (Xgetbv0() & 0x6) == 0x6;
+}
+#endif
+
+bool Chip8Batch::Vectorized()
+{
+#ifdef CHIP8BATCH_X86
+	static const bool available = DetectAvx2();
+	return available;
+#else
+	return false;
+#endif
+}
+
+Chip8Batch::Chip8Batch(size_t lane_count, PageArena* arena)
+{
+	stride = (lane_count + 31) & ~(size_t)31;
+	for (size_t it = 0; it < lane_count; it++)
+		lanes.push_back(new Chip8(arena));
+
+	for (std::vector<uint8_t>& row : v)
+		row.assign(stride, 0);
+	i.assign(stride, 0);
+	pc.assign(stride, 0);
+	delay_timer.assign(stride, 0);
+	sound_timer.assign(stride, 0);
+	remaining.assign(stride, 0);
+	executed.assign(stride, 0);
+	ops.assign(stride, 0);
+	config.assign(stride, 0);
+	pending.assign(stride, 0);
+	group.assign(stride, 0);
+	code_page.assign(stride, NO_PAGE);
+	code.assign(stride, nullptr);
+}
+
+Chip8Batch::~Chip8Batch()
+{
+	for (Chip8* lane : lanes)
+		delete lane;
+}
+
+uint8_t Chip8Batch::LaneConfig(const Chip8& core)
+{
+	return (uint8_t)((core.mode & CONFIG_MODE) | (core.quirks.logic_flag_reset ? CONFIG_LOGIC_FLAG_RESET : 0)
+		| (core.quirks.vip_shifts ? CONFIG_VIP_SHIFTS : 0) | (core.quirks.vip_jump ? CONFIG_VIP_JUMP : 0));
+}
+
+void Chip8Batch::LoadLaneRegs(size_t lane)
+{
+	Chip8& core = *lanes[lane];
+	for (int x = 0; x < 16; x++)
+		core.regs.v[x] = v[x][lane];
+	core.regs.i = i[lane];
+	core.pc = pc[lane];
+	core.delay_timer = delay_timer[lane];
+	core.sound_timer = sound_timer[lane];
+	core.m_Run_Cycles = remaining[lane];
+}
+
+void Chip8Batch::StoreLaneRegs(size_t lane)
+{
+	Chip8& core = *lanes[lane];
+	for (int x = 0; x < 16; x++)
+		v[x][lane] = core.regs.v[x];
+	i[lane] = core.regs.i;
+	pc[lane] = core.pc;
+	delay_timer[lane] = core.delay_timer;
+	sound_timer[lane] = core.sound_timer;
+	remaining[lane] = core.m_Run_Cycles;
+}
+
+void Chip8Batch::LoadLanes(uint16_t cycles)
+{
+	for (size_t lane = 0; lane < lanes.size(); lane++)
+	{
+		//a profiled lane runs the core's own loop, which reports every instruction, access, call and frame to the
+		//profiler. it stays out of the SoA pass, its remaining cycles are 0 once Run returns
+		Chip8& core = *lanes[lane];
+		if (core.GetProfiler())
+		{
+			core.Run(cycles);
+			StoreLaneRegs(lane);
+			executed[lane] = 0;
+			code_page[lane] = NO_PAGE;
+			continue;
+		}
+
+		//the prologue of Chip8::Run
+		if (!core.GetHalted() && !core.GetDebugStepping())
+			core.m_Run_Cycles = cycles;
+		if (core.delay_timer)
+			core.delay_timer--;
+		if (core.sound_timer)
+			core.sound_timer--;
+
+		StoreLaneRegs(lane);
+		executed[lane] = 0;
+		code_page[lane] = NO_PAGE;
+		config[lane] = LaneConfig(core);
+	}
+}
+
+void Chip8Batch::StoreLanes()
+{
+	for (size_t lane = 0; lane < lanes.size(); lane++)
+	{
+		Chip8& core = *lanes[lane];
+		if (core.GetProfiler())
+			continue; //ran and finished its frame in LoadLanes
+		LoadLaneRegs(lane);
+		core.total_cycles += executed[lane];
+		if (core.verify_hash)
+			core.VerifyStateHash(core.GetStateHash());
+	}
+}
+
+void Chip8Batch::Run(uint16_t cycles)
+{
+	const size_t count = lanes.size();
+	LoadLanes(cycles);
+
+	//raw rows for the fetch loop. byte stores through a vector may alias any vector's internals, so going
+	//through the vectors would reload every data pointer on every lane
+	uint16_t* rem = remaining.data();
+	uint32_t* exec = executed.data();
+	uint16_t* op_row = ops.data();
+	uint16_t* pc_row = pc.data();
+	const uint8_t* cfg = config.data();
+
+	while (true)
+	{
+		//fetch for every lane still running, exactly like the loop in Chip8::Run. lanes in lockstep all fetch the
+		//first lane's opcode, which lets the whole cycle skip the grouping pass
+		uint8_t* pend = pending.data(); //swapped with group below
+		size_t live = 0;
+		size_t first = count;
+		bool lockstep = true;
+		for (size_t lane = 0; lane < count; lane++)
+		{
+			if (!rem[lane])
+			{
+				pend[lane] = 0;
+				continue;
+			}
+			rem[lane]--;
+			exec[lane]++;
+			uint16_t op = Fetch(lane);
+			op_row[lane] = op;
+			pc_row[lane] += 2;
+			pend[lane] = 0xFF;
+			if (!live++)
+				first = lane;
+			else
+				lockstep &= (op == op_row[first]) & (cfg[lane] == cfg[first]);
+		}
+		if (!live)
+			break;
+		stats.cycles += live;
+
+		if (lockstep)
+		{
+			group.swap(pending);
+			stats.groups++;
+			if (ExecuteVector(ops[first], config[first]))
+				stats.vector_cycles += live;
+			else
+				ExecuteScalar(ops[first]);
+			continue;
+		}
+
+		//otherwise execute one group of lanes sharing an opcode and config at a time until every lane has run
+		while (true)
+		{
+			while (first < count && !pending[first])
+				first++;
+			if (first == count)
+				break;
+
+			const uint16_t opcode = ops[first];
+			const uint8_t lane_config = config[first];
+			size_t members = 0;
+			for (size_t lane = 0; lane < count; lane++)
+			{
+				uint8_t in_group = (pending[lane] && ops[lane] == opcode && config[lane] == lane_config) ? 0xFF : 0;
+				group[lane] = in_group;
+				pending[lane] &= ~in_group;
+				members += in_group & 1;
+			}
+			stats.groups++;
+
+			if (ExecuteVector(opcode, lane_config))
+				stats.vector_cycles += members;
+			else
+				ExecuteScalar(opcode);
+		}
+	}
+
+	StoreLanes();
+}
+
+
+void Chip8Batch::ExecuteScalar(uint16_t opcode)
+{
+	for (size_t lane = 0; lane < lanes.size(); lane++)
+	{
+		if (!group[lane])
+			continue;
+		LoadLaneRegs(lane);
+		lanes[lane]->Decode_Execute(opcode);
+		StoreLaneRegs(lane);
+		code_page[lane] = NO_PAGE; //a write may have remapped the page
+	}
+}
+
+//Register-only opcodes over every lane in the group. Each case mirrors its Chip8::Decode_Execute counterpart,
+//including the order of the VF write, which matters when X or Y is F. Returns false for everything else.
+bool Chip8Batch::ExecuteVector(uint16_t opcode, uint8_t lane_config)
+{
+	const uint8_t x = (opcode >> 8) & 0xF;
+	const uint8_t y = (opcode >> 4) & 0xF;
+	const uint8_t nn = opcode & 0xFF;
+	const uint16_t nnn = opcode & 0xFFF;
+	const Chip8::SYSTEM_MODE mode = (Chip8::SYSTEM_MODE)(lane_config & CONFIG_MODE);
+	const uint8_t* g = group.data();
+	const size_t count = lanes.size();
+	std::vector<uint8_t>& vx = v[x];
+	std::vector<uint8_t>& vy = v[y];
+	std::vector<uint8_t>& vf = v[0xF];
+
+#ifdef CHIP8BATCH_X86
+	if (Vectorized())
+	{
+		uint8_t* rows[16];
+		for (int r = 0; r < 16; r++)
+			rows[r] = v[r].data();
+		if (ExecuteAvx2(opcode, lane_config, g, stride, rows, i.data(), pc.data()))
+			return true;
+	}
+#endif
+
+	//skips look past the next opcode for XO-CHIP's 4 byte F000 NNNN, which needs the lane's memory
+	auto skip = [&](size_t lane) {
+		if (mode == Chip8::SYSTEM_MODE::XO_CHIP && lanes[lane]->Fetch(pc[lane]) == 0xF000)
+			pc[lane] += 2;
+		pc[lane] += 2;
+	};
+
+	switch (opcode >> 12)
+	{
+	case(0x1): //1NNN
+		for (size_t lane = 0; lane < count; lane++)
+			if (g[lane]) pc[lane] = nnn;
+		return true;
+	case(0x3): //3XNN
+		for (size_t lane = 0; lane < count; lane++)
+			if (g[lane] && vx[lane] == nn) skip(lane);
+		return true;
+	case(0x4): //4XNN
+		for (size_t lane = 0; lane < count; lane++)
+			if (g[lane] && vx[lane] != nn) skip(lane);
+		return true;
+	case(0x5): //5XY0 only
+		if ((opcode & 0xF) != 0)
+			return false;
+		for (size_t lane = 0; lane < count; lane++)
+			if (g[lane] && vx[lane] == vy[lane]) skip(lane);
+		return true;
+	case(0x6): //6XNN
+		for (size_t lane = 0; lane < count; lane++)
+			if (g[lane]) vx[lane] = nn;
+		return true;
+	case(0x7): //7XNN
+		for (size_t lane = 0; lane < count; lane++)
+			if (g[lane]) vx[lane] = (uint8_t)(vx[lane] + nn);
+		return true;
+	case(0x8):
+	{
+		const bool logic_reset = lane_config & CONFIG_LOGIC_FLAG_RESET;
+		const bool vip_shifts = lane_config & CONFIG_VIP_SHIFTS;
+		switch (opcode & 0xF)
+		{
+		case(0x0):
+		case(0x1):
+		case(0x2):
+		case(0x3):
+		{
+			const uint8_t logic = opcode & 0xF;
+			for (size_t lane = 0; lane < count; lane++)
+			{
+				if (!g[lane])
+					continue;
+				uint8_t a = vx[lane], c = vy[lane];
+				vx[lane] = logic == 0 ? c : logic == 1 ? (a | c) : logic == 2 ? (a & c) : (a ^ c);
+				if (logic && logic_reset)
+					vf[lane] = 0;
+			}
+			return true;
+		}
+		case(0x4): //8XY4, VF = carry
+			for (size_t lane = 0; lane < count; lane++)
+			{
+				if (!g[lane])
+					continue;
+				uint8_t carry = (vx[lane] + vy[lane] > 0xFF) ? 1 : 0;
+				vx[lane] = (uint8_t)(vx[lane] + vy[lane]);
+				vf[lane] = carry;
+			}
+			return true;
+		case(0x5): //8XY5, VF = no borrow
+		case(0x7): //8XY7, VX = VY - VX, VF = no borrow
+		{
+			const bool reverse = (opcode & 0xF) == 0x7;
+			for (size_t lane = 0; lane < count; lane++)
+			{
+				if (!g[lane])
+					continue;
+				uint8_t a = vx[lane], c = vy[lane];
+				if (reverse)
+					std::swap(a, c);
+				vx[lane] = (uint8_t)(a - c);
+				vf[lane] = (a < c) ? 0 : 1;
+			}
+			return true;
+		}
+		case(0x6): //8XY6, shift right
+		case(0xE): //8XYE, shift left
+		{
+			const bool left = (opcode & 0xF) == 0xE;
+			for (size_t lane = 0; lane < count; lane++)
+			{
+				if (!g[lane])
+					continue;
+				if (vip_shifts)
+					vx[lane] = vy[lane];
+				vf[lane] = left ? (vx[lane] >> 7) : (vx[lane] & 0x01);
+				vx[lane] = left ? (uint8_t)(vx[lane] << 1) : (uint8_t)(vx[lane] >> 1);
+			}
+			return true;
+		}
+		default:
+			return false;
+		}
+	}
+	case(0x9): //9XY0
+		for (size_t lane = 0; lane < count; lane++)
+			if (g[lane] && vx[lane] != vy[lane]) skip(lane);
+		return true;
+	case(0xA): //ANNN
+		for (size_t lane = 0; lane < count; lane++)
+			if (g[lane]) i[lane] = nnn;
+		return true;
+	case(0xB): //BNNN, NNN + V0 or XNN + VX
+	{
+		std::vector<uint8_t>& offset = (lane_config & CONFIG_VIP_JUMP) ? v[0] : vx;
+		for (size_t lane = 0; lane < count; lane++)
+			if (g[lane]) pc[lane] = (uint16_t)(nnn + offset[lane]);
+		return true;
+	}
+	case(0xF):
+		switch (nn)
+		{
+		case(0x07): //FX07
+			for (size_t lane = 0; lane < count; lane++)
+				if (g[lane]) vx[lane] = delay_timer[lane];
+			return true;
+		case(0x15): //FX15
+			for (size_t lane = 0; lane < count; lane++)
+				if (g[lane]) delay_timer[lane] = vx[lane];
+			return true;
+		case(0x18): //FX18
+			for (size_t lane = 0; lane < count; lane++)
+				if (g[lane]) sound_timer[lane] = vx[lane];
+			return true;
+		case(0x1E): //FX1E, SUPER-CHIP sets VF on overflow past 0xFFF before adding
+			for (size_t lane = 0; lane < count; lane++)
+			{
+				if (!g[lane])
+					continue;
+				if (mode == Chip8::SYSTEM_MODE::SUPER_CHIP)
+					vf[lane] = (i[lane] + vx[lane] > 0xFFF) ? 1 : 0;
+				i[lane] += vx[lane];
+			}
+			return true;
+		default:
+			return false;
+		}
+	default:
+		return false;
+	}
+}
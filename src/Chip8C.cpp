@@ -0,0 +1,211 @@
+#include "Chip8C.h"
+#include "Chip8.h"
+#include "Logger.h"
+#include "Movie.h"
+#include <algorithm>
+#include <memory>
+
+struct kip8_core {
+	std::unique_ptr<Chip8> core;
+};
+
+static Chip8::SYSTEM_MODE ToMode(int mode)
+{
+	switch (mode)
+	{
+	case KIP8_MODE_SCHIP: return Chip8::SYSTEM_MODE::SUPER_CHIP;
+	case KIP8_MODE_XOCHIP: return Chip8::SYSTEM_MODE::XO_CHIP;
+	default: return Chip8::SYSTEM_MODE::CHIP_8;
+	}
+}
+
+static int FromMode(Chip8::SYSTEM_MODE mode)
+{
+	switch (mode)
+	{
+	case Chip8::SYSTEM_MODE::SUPER_CHIP: return KIP8_MODE_SCHIP;
+	case Chip8::SYSTEM_MODE::XO_CHIP: return KIP8_MODE_XOCHIP;
+	default: return KIP8_MODE_CHIP8;
+	}
+}
+
+uint32_t kip8_abi_version(void)
+{
+	return KIP8_ABI_VERSION;
+}
+
+void kip8_set_log_callback(kip8_log_callback callback, void* user, int level)
+{
+	spdlog::level::level_enum spd_level = (spdlog::level::level_enum)std::min(std::max(level, (int)KIP8_LOG_TRACE), (int)KIP8_LOG_OFF);
+	if (callback)
+		Logger::SetLogger(Logger::CreateCallbackLogger("KIP-8", callback, user, spd_level));
+	else
+		Logger::InitConsole(spd_level);
+}
+
+kip8_core* kip8_create(int mode)
+{
+	kip8_core* handle = new kip8_core();
+	handle->core = std::make_unique<Chip8>();
+	handle->core->SetSystemMode(ToMode(mode));
+	return handle;
+}
+
+void kip8_destroy(kip8_core* core)
+{
+	delete core;
+}
+
+void kip8_set_mode(kip8_core* core, int mode)
+{
+	core->core->SetSystemMode(ToMode(mode));
+}
+
+int kip8_get_mode(kip8_core* core)
+{
+	return FromMode(core->core->GetSystemMode());
+}
+
+void kip8_set_quirks(kip8_core* core, const kip8_quirks* quirks)
+{
+	Chip8::Quirks& out = core->core->quirks;
+	out.vip_jump = quirks->vip_jump != 0;
+	out.vip_shifts = quirks->vip_shifts != 0;
+	out.vip_regs_read_write = quirks->vip_regs_read_write != 0;
+	out.logic_flag_reset = quirks->logic_flag_reset != 0;
+	out.draw_wrap = quirks->draw_wrap != 0;
+	out.draw_vblank = quirks->draw_vblank != 0;
+	out.schip_10_fonts = quirks->schip_10_fonts != 0;
+	out.schip_10_regs_read_write = quirks->schip_10_regs_read_write != 0;
+}
+
+void kip8_get_quirks(kip8_core* core, kip8_quirks* quirks)
+{
+	const Chip8::Quirks& in = core->core->quirks;
+	quirks->vip_jump = in.vip_jump;
+	quirks->vip_shifts = in.vip_shifts;
+	quirks->vip_regs_read_write = in.vip_regs_read_write;
+	quirks->logic_flag_reset = in.logic_flag_reset;
+	quirks->draw_wrap = in.draw_wrap;
+	quirks->draw_vblank = in.draw_vblank;
+	quirks->schip_10_fonts = in.schip_10_fonts;
+	quirks->schip_10_regs_read_write = in.schip_10_regs_read_write;
+}
+
+void kip8_set_seed(kip8_core* core, uint64_t seed)
+{
+	core->core->SetSeed(seed);
+}
+
+int kip8_load(kip8_core* core, const uint8_t* rom, size_t size)
+{
+	if (!rom || size == 0 || size > 0x10000 - 0x200)
+	{
+		LOG_ERROR_TO(core->core->GetLogger(), "kip8_load: bad rom size {}", size);
+		return -1;
+	}
+	Chip8* chip = core->core.get();
+	uint8_t rpl[Chip8::RPL_SIZE];
+	memcpy(rpl, chip->GetRPLMem(), sizeof(rpl));
+	Movie::Boot(chip, std::vector<unsigned char>(rom, rom + size), chip->GetSeed(), chip->GetSystemMode(), chip->quirks, rpl);
+	return 0;
+}
+
+void kip8_reset(kip8_core* core)
+{
+	core->core->Reset("kip8_reset");
+}
+
+void kip8_run_frame(kip8_core* core, uint16_t cycles)
+{
+	core->core->Run(cycles);
+}
+
+void kip8_run_frames(kip8_core* core, uint32_t frames, uint16_t cycles)
+{
+	Chip8* chip = core->core.get();
+	for (uint32_t it = 0; it < frames; it++)
+		chip->Run(cycles);
+}
+
+uint64_t kip8_get_total_cycles(kip8_core* core)
+{
+	return core->core->GetTotalCycles();
+}
+
+int kip8_halted(kip8_core* core)
+{
+	return core->core->GetHalted() ? 1 : 0;
+}
+
+void kip8_set_keys(kip8_core* core, uint16_t keys)
+{
+	Chip8* chip = core->core.get();
+	chip->SetKeyMask(keys, chip->GetKeyMask());
+}
+
+const uint8_t* kip8_get_framebuffer(kip8_core* core, uint32_t* width, uint32_t* height)
+{
+	Chip8* chip = core->core.get();
+	if (width)
+		*width = chip->res.base_width;
+	if (height)
+		*height = chip->res.base_height;
+	return chip->GetVRAM();
+}
+
+void kip8_get_registers(kip8_core* core, kip8_registers* regs)
+{
+	Chip8* chip = core->core.get();
+	for (uint8_t it = 0; it < 16; it++)
+		regs->v[it] = *chip->GetRegV(it);
+	regs->i = *chip->GetRegI();
+	regs->pc = *chip->GetPC();
+	regs->sp = *chip->GetSP();
+	regs->delay_timer = chip->GetDelayTimer();
+	regs->sound_timer = chip->GetSoundTimer();
+}
+
+uint8_t kip8_get_sound_timer(kip8_core* core)
+{
+	return core->core->GetSoundTimer();
+}
+
+void kip8_read_ram(kip8_core* core, uint16_t addr, uint8_t* out, size_t len)
+{
+	len = std::min(len, (size_t)0x10000 - addr);
+	core->core->CopyRAM(addr, out, len);
+}
+
+void kip8_write_ram(kip8_core* core, uint16_t addr, const uint8_t* in, size_t len)
+{
+	len = std::min(len, (size_t)0x10000 - addr);
+	core->core->SetRAM(addr, in, len);
+}
+
+uint64_t kip8_get_state_hash(kip8_core* core)
+{
+	return core->core->GetStateHash();
+}
+
+kip8_core* kip8_snapshot(kip8_core* core)
+{
+	kip8_core* snapshot = new kip8_core();
+	snapshot->core.reset(core->core->Clone());
+	return snapshot;
+}
+
+void kip8_restore(kip8_core* core, const kip8_core* snapshot)
+{
+	core->core->Restore(*snapshot->core);
+}
+
+int kip8_save_state(kip8_core* core, const char* filename)
+{
+	return core->core->SaveState(filename) ? 0 : -1;
+}
+
+int kip8_load_state(kip8_core* core, const char* filename)
+{
+	return core->core->LoadState(filename) ? 0 : -1;
+}
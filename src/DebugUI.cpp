@@ -1,5 +1,38 @@
 #include "DebugUI.h"
 #include "imguial_button.h"
+#include <algorithm>
+#include <cmath>
+
+//the RAM heatmap's scale, the log of the highest counts in the profile. set every frame before the editor draws
+static struct {
+    const Profiler* profiler = nullptr;
+    float executed = 0, reads = 0, writes = 0;
+} heatmap;
+
+//writes red, executes green, reads blue, each on a log scale so a hot loop doesn't wash out everything else
+static ImU32 HeatmapColor(const ImU8* data, size_t off)
+{
+    if (!heatmap.profiler)
+        return 0;
+    auto heat = [](uint64_t count, float max) { return count && max > 0 ? std::log((float)count + 1) / max : 0.0f; };
+    float executed = heat(heatmap.profiler->GetExecuted((uint16_t)off), heatmap.executed);
+    float reads = heat(heatmap.profiler->GetReads((uint16_t)off), heatmap.reads);
+    float writes = heat(heatmap.profiler->GetWrites((uint16_t)off), heatmap.writes);
+    float strongest = std::max(executed, std::max(reads, writes));
+    if (strongest == 0)
+        return 0;
+    return IM_COL32((int)(writes * 255), (int)(executed * 255), (int)(reads * 255), (int)(60 + strongest * 120));
+}
+
+//the log window collects from the start, before Init, so what the database thread logs during startup shows up in
+//it. adding a sink isn't thread safe, so the UI is constructed before that thread starts
+void DebugUI::AttachLog()
+{
+    auto imgui_logger = std::make_shared<imgui_log_sink_mt>(log);
+    log->setFilterHeaderLabel("Filter");
+    Logger::GetLogger()->sinks().push_back(imgui_logger);
+    Logger::GetLogger()->set_level(spdlog::level::info);
+}
 
 void DebugUI::Init()
 {
@@ -11,10 +44,13 @@ void DebugUI::Init()
     SDL_GetWindowSize(fe_State->window, &win_w, &win_h);
 	ImGuiSDL::Initialize(fe_State->renderer, win_w, win_h);
     chip8_ram_editor.Cols = 32;
+    //guest RAM is paged, so the editor goes through the core instead of a flat buffer. mem_data is the core
+    chip8_ram_editor.ReadFn = [](const ImU8* data, size_t off) -> ImU8 { return ((Chip8*)data)->ReadRAM((uint16_t)off); };
+    chip8_ram_editor.WriteFn = [](ImU8* data, size_t off, ImU8 d) { ((Chip8*)data)->WriteRAM((uint16_t)off, d); };
+    chip8_ram_editor.BgColorFn = HeatmapColor;
     chip8_vram_editor.Cols = 64;
-    auto imgui_logger = std::make_shared<imgui_log_sink_mt>(log);
-    log->setFilterHeaderLabel("Filter");
-    Logger::GetLogger()->sinks().push_back(imgui_logger);
+    chip8_vram_editor.ReadFn = [](const ImU8* data, size_t off) -> ImU8 { return ((Chip8*)data)->GetVRAM()[off]; };
+    chip8_vram_editor.WriteFn = [](ImU8* data, size_t off, ImU8 d) { ((Chip8*)data)->WriteVRAM((uint16_t)off, d); };
     Logger::GetLogger()->set_level(spdlog::level::info);
 
     SDL_RendererInfo r_info;
@@ -81,6 +117,12 @@ void DebugUI::Draw()
     if(show_key_remap)
         ShowKeyRemapWindow(&show_key_remap);
 
+    if (show_profiler)
+        ShowProfilerWindow(&show_profiler);
+
+    if (show_timing)
+        ShowFrameTimingWindow(&show_timing);
+
 	SDL_Rect windowRect = { 0, 0, 1, 1 };
 	SDL_RenderSetClipRect(fe_State->renderer, &windowRect); //fixes an SDL bug for D3D backend
 	SDL_SetRenderDrawColor(fe_State->renderer, 114, 144, 154, 255);
@@ -319,7 +361,22 @@ void DebugUI::ShowRAMWindow(bool* p_open)
         ImGui::End();
         return;
     }    
-    chip8_ram_editor.DrawContents(fe_State->core->GetRAM(), sizeof(uint8_t) * (((unsigned long long)fe_State->core->GetRAMLimit())+1), 0); //TODO: don't hard code ram size
+    size_t ram_size = ((size_t)fe_State->core->GetRAMLimit()) + 1;
+    heatmap.profiler = fe_State->ram_Heatmap ? fe_State->core->GetProfiler() : nullptr;
+    if (heatmap.profiler)
+    {
+        uint64_t executed = 0, reads = 0, writes = 0;
+        for (size_t addr = 0; addr < ram_size; addr++)
+        {
+            executed = std::max(executed, heatmap.profiler->GetExecuted((uint16_t)addr));
+            reads = std::max(reads, heatmap.profiler->GetReads((uint16_t)addr));
+            writes = std::max(writes, heatmap.profiler->GetWrites((uint16_t)addr));
+        }
+        heatmap.executed = std::log((float)executed + 1);
+        heatmap.reads = std::log((float)reads + 1);
+        heatmap.writes = std::log((float)writes + 1);
+    }
+    chip8_ram_editor.DrawContents(fe_State->core, ram_size, 0);
     
     ImGui::End();
 }
@@ -332,9 +389,9 @@ void DebugUI::ShowVRAMWindow(bool* p_open)
         ImGui::End();
         return;
     }
-    static unsigned int res_w = fe_State->core->res.base_width;
-    static unsigned int res_h = fe_State->core->res.base_height;
-    chip8_vram_editor.DrawContents(fe_State->core->GetVRAM(), sizeof(uint8_t) * res_w * res_h, 0);
+    unsigned int res_w = fe_State->core->res.base_width; //the framebuffer is resized with the system mode
+    unsigned int res_h = fe_State->core->res.base_height;
+    chip8_vram_editor.DrawContents(fe_State->core, sizeof(uint8_t) * res_w * res_h, 0);
     ImGui::End();
 }
 
@@ -466,6 +523,277 @@ void DebugUI::ShowKeyRemapWindow(bool* p_open)
     ImGui::End();
 }
 
+void DebugUI::ShowProfilerWindow(bool* p_open)
+{
+    ImGui::SetNextWindowSize(ImVec2(560, 600), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Profiler", p_open))
+    {
+        ImGui::End();
+        return;
+    }
+    ImGui::Checkbox("Enabled", &fe_State->profiling);
+    ImGui::SameLine();
+    ImGui::Checkbox("RAM Heatmap", &fe_State->ram_Heatmap);
+    HelpMarker("Colors the RAM window: writes red, executed green, reads blue.");
+    Profiler* profiler = fe_State->profiler;
+    if (!profiler)
+    {
+        ImGui::TextDisabled("Nothing profiled yet.");
+        ImGui::End();
+        return;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear"))
+        profiler->Clear();
+    ImGui::SameLine();
+    if (ImGuiAl::Button("Export lcov", fe_State->last_File != ""))
+    {
+        std::string name = fe_State->last_File.substr(fe_State->last_File.find_last_of("/\\") + 1);
+        profiler->ExportLcov(fe_State->last_File + ".info", fe_State->last_File + ".lst", fe_State->file_data, name);
+    }
+    HelpMarker("Writes <rom>.info for lcov/genhtml and the <rom>.lst listing it refers to.");
+    ImGui::Text("Instructions: %llu", (unsigned long long)profiler->GetInstructions());
+
+    if (ImGui::CollapsingHeader("Opcode Classes"))
+    {
+        std::vector<size_t> order;
+        for (size_t it = 0; it < Profiler::ClassCount(); it++)
+            if (profiler->GetClassCount(it))
+                order.push_back(it);
+        std::sort(order.begin(), order.end(), [profiler](size_t a, size_t b) { return profiler->GetClassCount(a) > profiler->GetClassCount(b); });
+        ImGui::Columns(3, "classes");
+        for (size_t it : order)
+        {
+            double share = 100.0 * profiler->GetClassCount(it) / std::max<uint64_t>(1, profiler->GetInstructions());
+            ImGui::TextUnformatted(Profiler::ClassName(it)); ImGui::NextColumn();
+            ImGui::Text("%llu", (unsigned long long)profiler->GetClassCount(it)); ImGui::NextColumn();
+            ImGui::Text("%.1f%%", share); ImGui::NextColumn();
+        }
+        ImGui::Columns(1);
+    }
+
+    if (ImGui::CollapsingHeader("Subroutines", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        if (ImGuiAl::Button("Export Flame Graph", fe_State->last_File != ""))
+            profiler->ExportFolded(fe_State->last_File + ".folded");
+        HelpMarker("Writes <rom>.folded, folded call stacks for flamegraph.pl or speedscope.");
+        ImGui::SameLine();
+        if (ImGuiAl::Button("Reload Symbols", fe_State->last_File != ""))
+            profiler->LoadSymbolsFor(fe_State->last_File);
+        HelpMarker("Names routines from Octo labels in <rom>.sym.");
+        ImGui::SameLine();
+        ImGui::Text("Call depth: %zu", profiler->GetCallDepth());
+
+        const size_t shown = 50;
+        std::vector<Profiler::Routine> routines = profiler->GetRoutines();
+        auto key = [](const Profiler::Routine& routine, RoutineColumn column) -> uint64_t {
+            switch (column)
+            {
+            case ROUTINE_CALLS: return routine.calls;
+            case ROUTINE_SELF: return routine.self;
+            case ROUTINE_MAX_FRAME: return routine.max_frame;
+            default: return routine.total;
+            }
+        };
+        std::sort(routines.begin(), routines.end(), [&](const Profiler::Routine& a, const Profiler::Routine& b) {
+            if (routine_sort == ROUTINE_NAME)
+                return a.address < b.address;
+            return key(a, routine_sort) > key(b, routine_sort);
+        });
+
+        static const char* headers[] = { "Routine", "Calls", "Self", "Total", "Max/Frame" };
+        ImGui::Columns(5, "routines");
+        for (int it = 0; it < 5; it++)
+        {
+            if (ImGui::Selectable(headers[it], it == routine_sort))
+                routine_sort = (RoutineColumn)it;
+            ImGui::NextColumn();
+        }
+        ImGui::Separator();
+        uint64_t instructions = std::max<uint64_t>(1, profiler->GetInstructions());
+        for (size_t it = 0; it < std::min(shown, routines.size()); it++)
+        {
+            const Profiler::Routine& routine = routines[it];
+            ImGui::PushID((int)routine.address);
+            std::string name = profiler->RoutineName(routine.address);
+            if (ImGui::Selectable(name.c_str(), false, ImGuiSelectableFlags_SpanAllColumns) && routine.address != Profiler::TOP_LEVEL)
+            {
+                show_ram = true;
+                chip8_ram_editor.GotoAddrAndHighlight(routine.address, routine.address + 2);
+            }
+            if (ImGui::IsItemHovered() && routine.address != Profiler::TOP_LEVEL)
+                ImGui::SetTooltip("%04X", routine.address);
+            ImGui::NextColumn();
+            ImGui::Text("%llu", (unsigned long long)routine.calls); ImGui::NextColumn();
+            ImGui::Text("%llu (%.1f%%)", (unsigned long long)routine.self, 100.0 * routine.self / instructions); ImGui::NextColumn();
+            ImGui::Text("%llu (%.1f%%)", (unsigned long long)routine.total, 100.0 * routine.total / instructions); ImGui::NextColumn();
+            //a routine that needed the whole frame's cycles ran into the next frame
+            if (routine.address != Profiler::TOP_LEVEL && routine.max_frame >= fe_State->run_Cycles)
+                ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%llu", (unsigned long long)routine.max_frame);
+            else
+                ImGui::Text("%llu", (unsigned long long)routine.max_frame);
+            ImGui::NextColumn();
+            ImGui::PopID();
+        }
+        ImGui::Columns(1);
+    }
+
+    if (ImGui::CollapsingHeader("Hot Spots", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        const size_t shown = 100;
+        size_t ram_size = ((size_t)fe_State->core->GetRAMLimit()) + 1;
+        auto count = [profiler](uint16_t addr, HotSpotColumn column) -> uint64_t {
+            switch (column)
+            {
+            case HOT_EXECUTED: return profiler->GetExecuted(addr);
+            case HOT_READS: return profiler->GetReads(addr);
+            case HOT_WRITES: return profiler->GetWrites(addr);
+            default: return 0;
+            }
+        };
+        hot_spots.clear();
+        for (size_t addr = 0; addr < ram_size; addr++)
+            if (profiler->GetExecuted((uint16_t)addr) || profiler->GetReads((uint16_t)addr) || profiler->GetWrites((uint16_t)addr))
+                hot_spots.push_back((uint16_t)addr);
+        if (hot_spot_sort != HOT_ADDRESS) //already in address order
+        {
+            size_t top = std::min(shown, hot_spots.size());
+            std::partial_sort(hot_spots.begin(), hot_spots.begin() + top, hot_spots.end(), [&](uint16_t a, uint16_t b) {
+                return count(a, hot_spot_sort) > count(b, hot_spot_sort);
+            });
+        }
+
+        static const char* headers[] = { "Address", "Opcode", "Class", "Executed", "Reads", "Writes" };
+        static const int sort_of_header[] = { HOT_ADDRESS, -1, -1, HOT_EXECUTED, HOT_READS, HOT_WRITES };
+        ImGui::Columns(6, "hot_spots");
+        for (int it = 0; it < 6; it++)
+        {
+            bool sorted = sort_of_header[it] == hot_spot_sort;
+            if (sort_of_header[it] < 0)
+                ImGui::TextDisabled("%s", headers[it]);
+            else if (ImGui::Selectable(headers[it], sorted))
+                hot_spot_sort = (HotSpotColumn)sort_of_header[it];
+            ImGui::NextColumn();
+        }
+        ImGui::Separator();
+        for (size_t it = 0; it < std::min(shown, hot_spots.size()); it++)
+        {
+            uint16_t addr = hot_spots[it];
+            uint16_t opcode = (uint16_t)((fe_State->core->ReadRAM(addr) << 8) | fe_State->core->ReadRAM(addr + 1));
+            ImGui::PushID((int)addr);
+            char label[8];
+            snprintf(label, sizeof(label), "%04X", addr);
+            if (ImGui::Selectable(label, false, ImGuiSelectableFlags_SpanAllColumns))
+            {
+                show_ram = true;
+                chip8_ram_editor.GotoAddrAndHighlight(addr, addr + (profiler->GetExecuted(addr) ? 2 : 1));
+            }
+            ImGui::NextColumn();
+            if (profiler->GetExecuted(addr))
+            {
+                ImGui::Text("%04X", opcode); ImGui::NextColumn();
+                ImGui::TextUnformatted(Profiler::ClassName(Profiler::ClassOf(opcode))); ImGui::NextColumn();
+            }
+            else
+            {
+                ImGui::TextDisabled("%02X", opcode >> 8); ImGui::NextColumn();
+                ImGui::TextDisabled("data"); ImGui::NextColumn();
+            }
+            ImGui::Text("%llu", (unsigned long long)profiler->GetExecuted(addr)); ImGui::NextColumn();
+            ImGui::Text("%llu", (unsigned long long)profiler->GetReads(addr)); ImGui::NextColumn();
+            ImGui::Text("%llu", (unsigned long long)profiler->GetWrites(addr)); ImGui::NextColumn();
+            ImGui::PopID();
+        }
+        ImGui::Columns(1);
+    }
+    ImGui::End();
+}
+
+void DebugUI::ShowFrameTimingWindow(bool* p_open)
+{
+    ImGui::SetNextWindowSize(ImVec2(620, 480), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Frame Timing", p_open))
+    {
+        ImGui::End();
+        return;
+    }
+    FrameTimer* timer = fe_State->frame_Timer;
+    timer->Snapshot(timing_events);
+
+    if (ImGui::Button("Export Chrome Trace"))
+        timer->ExportChromeTrace(fe_State->last_File != "" ? fe_State->last_File + ".trace.json" : "kip8.trace.json");
+    HelpMarker("Writes every event still in the ring as <rom>.trace.json, for chrome://tracing or Perfetto.");
+
+    //percentiles over everything still in the ring
+    ImGui::Columns(6, "timing_stats");
+    static const char* headers[] = { "Zone", "Count", "p50 ms", "p95 ms", "p99 ms", "Max ms" };
+    for (const char* header : headers)
+    {
+        ImGui::TextDisabled("%s", header);
+        ImGui::NextColumn();
+    }
+    ImGui::Separator();
+    for (int zone = 0; zone < FrameTimer::ZONE_COUNT; zone++)
+    {
+        FrameTimer::Durations(timing_events, (FrameTimer::ZoneId)zone, timing_durations);
+        FrameTimer::Stats stats = FrameTimer::GetStats(timing_durations);
+        if (ImGui::Selectable(FrameTimer::ZoneName((FrameTimer::ZoneId)zone), zone == timing_zone, ImGuiSelectableFlags_SpanAllColumns))
+            timing_zone = zone;
+        ImGui::NextColumn();
+        ImGui::Text("%zu", stats.count); ImGui::NextColumn();
+        ImGui::Text("%.3f", stats.p50); ImGui::NextColumn();
+        ImGui::Text("%.3f", stats.p95); ImGui::NextColumn();
+        ImGui::Text("%.3f", stats.p99); ImGui::NextColumn();
+        ImGui::Text("%.3f", stats.max); ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+    ImGui::Separator();
+
+    //rolling p50/p95/p99 of the selected zone over the last window events, for its last history events
+    const size_t history = 600, window = 60;
+    FrameTimer::Durations(timing_events, (FrameTimer::ZoneId)timing_zone, timing_durations);
+    size_t first = timing_durations.size() > history ? timing_durations.size() - history : 0;
+    timing_p50.clear();
+    timing_p95.clear();
+    timing_p99.clear();
+    float highest = 0.001f;
+    for (size_t it = first; it < timing_durations.size(); it++)
+    {
+        size_t from = it + 1 > window ? it + 1 - window : 0;
+        timing_window.assign(timing_durations.begin() + from, timing_durations.begin() + it + 1);
+        FrameTimer::Stats stats = FrameTimer::GetStats(timing_window);
+        timing_p50.push_back(stats.p50);
+        timing_p95.push_back(stats.p95);
+        timing_p99.push_back(stats.p99);
+        highest = std::max(highest, stats.p99);
+    }
+
+    if (!timing_p50.empty())
+    {
+        static const ImU32 colors[3] = { IM_COL32(80, 200, 120, 255), IM_COL32(240, 200, 60, 255), IM_COL32(240, 80, 80, 255) };
+        const float* lines[3] = { timing_p50.data(), timing_p95.data(), timing_p99.data() };
+        char overlay[96];
+        snprintf(overlay, sizeof(overlay), "%s  p50 %.3f  p95 %.3f  p99 %.3f ms", FrameTimer::ZoneName((FrameTimer::ZoneId)timing_zone), timing_p50.back(), timing_p95.back(), timing_p99.back());
+        ImGui::PlotConfig conf;
+        conf.values.ys_list = lines;
+        conf.values.ys_count = 3;
+        conf.values.colors = colors;
+        conf.values.count = (int)timing_p50.size();
+        conf.scale.min = 0;
+        conf.scale.max = highest * 1.1f;
+        conf.tooltip.show = true;
+        conf.tooltip.format = "%g: %.3f ms";
+        conf.grid_y.show = true;
+        conf.grid_y.size = highest > 40 ? 10.0f : highest > 4 ? 1.0f : highest > 0.4f ? 0.1f : 0.01f;
+        conf.grid_y.subticks = 1;
+        conf.overlay_text = overlay;
+        conf.frame_size = ImVec2(ImGui::GetContentRegionAvail().x, std::max(80.0f, ImGui::GetContentRegionAvail().y));
+        conf.line_thickness = 1.5f;
+        ImGui::Plot("timing", conf);
+    }
+    ImGui::End();
+}
+
 void DebugUI::ShowMenuBar()
 {
     if (ImGui::BeginMainMenuBar())
@@ -510,6 +838,20 @@ void DebugUI::ShowMenuFile()
             fe_State->core->Load(fe_State->file_data);
         }
     }
+    ImGui::MenuItem("Reload On Change", "", &fe_State->hot_Reload);
+    ImGui::Separator();
+    if (ImGui::MenuItem("Save State", "F5", false, fe_State->last_File != ""))
+    {
+        fe_State->save_State = true;
+    }
+    if (ImGui::MenuItem("Load State", "F7", false, fe_State->last_File != ""))
+    {
+        fe_State->load_State = true;
+    }
+    if (ImGui::MenuItem(fe_State->recording ? "Stop Recording Movie" : "Record Movie", "", false, fe_State->last_File != ""))
+    {
+        fe_State->toggle_Recording = true;
+    }
     ImGui::Separator();
     if (ImGui::MenuItem("Quit", ""))
     {
@@ -523,6 +865,7 @@ void DebugUI::ShowMenuEmulation()
     ImGui::TextUnformatted("CPU Cycles:");
     ImGui::SameLine();
     ImGui::InputScalar("", ImGuiDataType_U32, &(fe_State->run_Cycles), &u32_one, NULL, "%u");
+    ImGui::MenuItem("Rewind", "Hold Backspace", &(fe_State->rewind_Enabled));
 
     if (ImGui::BeginMenu("System Mode"))
     {
@@ -573,6 +916,8 @@ void DebugUI::ShowMenuEmulation()
         ImGui::MenuItem("Draw Ops Wrap", NULL, &(fe_State->core->quirks.draw_wrap) );
         ImGui::MenuItem("Draw Ops Wait for Vblank", NULL, &(fe_State->core->quirks.draw_vblank) );
         ImGui::MenuItem("S-CHIP 1.0 Large Fonts", NULL, &(fe_State->core->quirks.schip_10_fonts) );
+        ImGui::Separator();
+        ImGui::MenuItem(fe_State->detecting_Quirks ? "Auto-Detect Unknown ROMs (running)" : "Auto-Detect Unknown ROMs", NULL, &(fe_State->detect_Quirks) );
         ImGui::EndMenu();
     }
 
@@ -587,6 +932,8 @@ void DebugUI::ShowMenuWindows()
     ImGui::MenuItem("VRAM", NULL, &show_vram);
     ImGui::MenuItem("Log", NULL, &show_log);
     ImGui::MenuItem("Audio Visualizer", NULL, &show_audio);
+    ImGui::MenuItem("Profiler", NULL, &show_profiler);
+    ImGui::MenuItem("Frame Timing", NULL, &show_timing);
 }
 
 void DebugUI::ShowMenuOptions()
@@ -703,7 +1050,7 @@ void DebugUI::ShowMenuOptions()
                 fe_State->screen_Colors[0].b = (Uint8)(background_color.z * 255.0);
                 fe_State->screen_Colors[0].a = (Uint8)(background_color.w * 255.0);
 
-                std::fill_n(fe_State->core->GetPrevVRAM(), 128 * 64, 0);
+                fe_State->core->ClearPrevVRAM();
                 fe_State->core->SetScreenDirty();
                 fe_State->core->SetWipeScreen();
             }
@@ -762,7 +1109,7 @@ void DebugUI::ShowMenuOptions()
                 fe_State->screen_Colors[1].b = (Uint8)(foreground_color_1.z * 255.0);
                 fe_State->screen_Colors[1].a = (Uint8)(foreground_color_1.w * 255.0);
 
-                std::fill_n(fe_State->core->GetPrevVRAM(), 128 * 64, 0);
+                fe_State->core->ClearPrevVRAM();
                 fe_State->core->SetScreenDirty();
                 fe_State->core->SetWipeScreen();
 
@@ -822,7 +1169,7 @@ void DebugUI::ShowMenuOptions()
                 fe_State->screen_Colors[2].b = (Uint8)(foreground_color_2.z * 255.0);
                 fe_State->screen_Colors[2].a = (Uint8)(foreground_color_2.w * 255.0);
 
-                std::fill_n(fe_State->core->GetPrevVRAM(), 128 * 64, 0);
+                fe_State->core->ClearPrevVRAM();
                 fe_State->core->SetScreenDirty();
                 fe_State->core->SetWipeScreen();
 
@@ -882,7 +1229,7 @@ void DebugUI::ShowMenuOptions()
                 fe_State->screen_Colors[3].b = (Uint8)(overlap_color.z * 255.0);
                 fe_State->screen_Colors[3].a = (Uint8)(overlap_color.w * 255.0);
 
-                std::fill_n(fe_State->core->GetPrevVRAM(), 128 * 64, 0);
+                fe_State->core->ClearPrevVRAM();
                 fe_State->core->SetScreenDirty();
                 fe_State->core->SetWipeScreen();
 
@@ -953,7 +1300,7 @@ void DebugUI::ShowMenuOptions()
                     fe_State->screen_Colors[it+4].b = (Uint8)(xeno_chip_colors[it].z * 255.0);
                     fe_State->screen_Colors[it+4].a = (Uint8)(xeno_chip_colors[it].w * 255.0);
 
-                    std::fill_n(fe_State->core->GetPrevVRAM(), 128 * 64, 0);
+                    fe_State->core->ClearPrevVRAM();
                     fe_State->core->SetScreenDirty();
                     fe_State->core->SetWipeScreen();
 
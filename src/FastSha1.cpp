@@ -0,0 +1,342 @@
+#include "FastSha1.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define FASTSHA1_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define FASTSHA1_TARGET
+#else
+#include <cpuid.h>
+#define FASTSHA1_TARGET __attribute__((target("sha,ssse3,sse4.1")))
+#endif
+#endif
+
+static inline uint32_t Rol(uint32_t value, int bits)
+{
+	return (value << bits) | (value >> (32 - bits));
+}
+
+//message word i, expanded in place in a ring of 16. expanding the whole schedule up front gets auto-vectorized two
+//words at a time, which stalls on the dependency three words back and runs at half the speed
+static inline uint32_t Word(uint32_t w[16], int i)
+{
+	if (i < 16)
+		return w[i];
+	w[i & 15] = Rol(w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15], 1);
+	return w[i & 15];
+}
+
+//five rounds with the variables renamed instead of shifted, after five they are back in place
+template<typename F>
+static inline void FiveRounds(uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d, uint32_t& e, F f, uint32_t k, uint32_t w[16], int i)
+{
+	e += Rol(a, 5) + f(b, c, d) + k + Word(w, i);
+	b = Rol(b, 30);
+	d += Rol(e, 5) + f(a, b, c) + k + Word(w, i + 1);
+	a = Rol(a, 30);
+	c += Rol(d, 5) + f(e, a, b) + k + Word(w, i + 2);
+	e = Rol(e, 30);
+	b += Rol(c, 5) + f(d, e, a) + k + Word(w, i + 3);
+	d = Rol(d, 30);
+	a += Rol(b, 5) + f(c, d, e) + k + Word(w, i + 4);
+	c = Rol(c, 30);
+}
+
+static void CompressScalar(uint32_t state[5], const uint8_t* data, size_t count)
+{
+	for (; count; count--, data += 64)
+	{
+		uint32_t w[16];
+		for (int it = 0; it < 16; it++)
+			w[it] = (uint32_t)data[it * 4] << 24 | (uint32_t)data[it * 4 + 1] << 16 | (uint32_t)data[it * 4 + 2] << 8 | data[it * 4 + 3];
+
+		uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+		auto choose = [](uint32_t x, uint32_t y, uint32_t z) { return z ^ (x & (y ^ z)); };
+		auto parity = [](uint32_t x, uint32_t y, uint32_t z) { return x ^ y ^ z; };
+		auto majority = [](uint32_t x, uint32_t y, uint32_t z) { return (x & y) | (z & (x | y)); };
+		for (int it = 0; it < 20; it += 5)
+			FiveRounds(a, b, c, d, e, choose, 0x5A827999, w, it);
+		for (int it = 20; it < 40; it += 5)
+			FiveRounds(a, b, c, d, e, parity, 0x6ED9EBA1, w, it);
+		for (int it = 40; it < 60; it += 5)
+			FiveRounds(a, b, c, d, e, majority, 0x8F1BBCDC, w, it);
+		for (int it = 60; it < 80; it += 5)
+			FiveRounds(a, b, c, d, e, parity, 0xCA62C1D6, w, it);
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+	}
+}
+
+#ifdef FASTSHA1_X86
+//four rounds per sha1rnds4, the message schedule runs three groups ahead with sha1msg1/sha1msg2
+FASTSHA1_TARGET static void CompressShaNi(uint32_t state[5], const uint8_t* data, size_t count)
+{
+	const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090A0B0C0D0E0FULL); //big-endian words, reversed
+	__m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0x1B);
+	__m128i e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+	__m128i e1, msg0, msg1, msg2, msg3;
+
+	for (; count; count--, data += 64)
+	{
+		__m128i abcd_save = abcd;
+		__m128i e0_save = e0;
+
+		msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 0)), mask);
+		e0 = _mm_add_epi32(e0, msg0);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), mask);
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+		msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), mask);
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+		msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), mask);
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+		msg3 = _mm_xor_si128(msg3, msg1);
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+		msg3 = _mm_xor_si128(msg3, msg1);
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+		msg3 = _mm_xor_si128(msg3, msg1);
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+		msg3 = _mm_xor_si128(msg3, msg1);
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+		e0 = _mm_sha1nexte_epu32(e0, e0_save);
+		abcd = _mm_add_epi32(abcd, abcd_save);
+	}
+
+	_mm_storeu_si128((__m128i*)state, _mm_shuffle_epi32(abcd, 0x1B));
+	state[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+
+static bool DetectShaNi()
+{
+	unsigned int leaf1[4] = { 0 }, leaf7[4] = { 0 };
+#ifdef _MSC_VER
+	int regs[4];
+	__cpuid(regs, 0);
+	if (regs[0] < 7)
+		return false;
+	__cpuid(regs, 1);
+	memcpy(leaf1, regs, sizeof(regs));
+	__cpuidex(regs, 7, 0);
+	memcpy(leaf7, regs, sizeof(regs));
+#else
+	if (__get_cpuid_max(0, nullptr) < 7)
+		return false;
+	__get_cpuid(1, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+	__get_cpuid_count(7, 0, &leaf7[0], &leaf7[1], &leaf7[2], &leaf7[3]);
+#endif
+	bool ssse3 = leaf1[2] & (1 << 9);
+	bool sse41 = leaf1[2] & (1 << 19);
+	bool sha = leaf7[1] & (1 << 29);
+	return ssse3 && sse41 && sha;
+}
+#endif
+
+bool FastSha1::HardwareAccelerated()
+{
+#ifdef FASTSHA1_X86
+	static const bool available = DetectShaNi();
+	return available;
+#else
+	return false;
+#endif
+}
+
+void FastSha1::Blocks(const uint8_t* data, size_t count)
+{
+#ifdef FASTSHA1_X86
+	if (HardwareAccelerated())
+	{
+		CompressShaNi(state, data, count);
+		return;
+	}
+#endif
+	CompressScalar(state, data, count);
+}
+
+void FastSha1::Reset()
+{
+	state[0] = 0x67452301;
+	state[1] = 0xEFCDAB89;
+	state[2] = 0x98BADCFE;
+	state[3] = 0x10325476;
+	state[4] = 0xC3D2E1F0;
+	buffered = 0;
+	total = 0;
+}
+
+void FastSha1::Update(const uint8_t* data, size_t len)
+{
+	total += len;
+	if (buffered)
+	{
+		size_t count = std::min(len, sizeof(buffer) - buffered);
+		memcpy(buffer + buffered, data, count);
+		buffered += count;
+		data += count;
+		len -= count;
+		if (buffered < sizeof(buffer))
+			return;
+		Blocks(buffer, 1);
+		buffered = 0;
+	}
+	if (len >= 64)
+	{
+		Blocks(data, len / 64);
+		data += len & ~(size_t)63;
+		len &= 63;
+	}
+	memcpy(buffer, data, len);
+	buffered = len;
+}
+
+void FastSha1::Final(uint8_t digest[DIGEST_SIZE])
+{
+	uint64_t bits = total * 8;
+	buffer[buffered++] = 0x80;
+	if (buffered > 56)
+	{
+		memset(buffer + buffered, 0, sizeof(buffer) - buffered);
+		Blocks(buffer, 1);
+		buffered = 0;
+	}
+	memset(buffer + buffered, 0, 56 - buffered);
+	for (int it = 0; it < 8; it++)
+		buffer[56 + it] = (uint8_t)(bits >> (56 - it * 8));
+	Blocks(buffer, 1);
+
+	for (int it = 0; it < 5; it++)
+	{
+		digest[it * 4] = (uint8_t)(state[it] >> 24);
+		digest[it * 4 + 1] = (uint8_t)(state[it] >> 16);
+		digest[it * 4 + 2] = (uint8_t)(state[it] >> 8);
+		digest[it * 4 + 3] = (uint8_t)state[it];
+	}
+	Reset();
+}
+
+std::string FastSha1::FinalHex()
+{
+	uint8_t digest[DIGEST_SIZE];
+	Final(digest);
+	return ToHex(digest);
+}
+
+std::string FastSha1::ToHex(const uint8_t digest[DIGEST_SIZE])
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string hex(DIGEST_SIZE * 2, '0');
+	for (size_t it = 0; it < DIGEST_SIZE; it++)
+	{
+		hex[it * 2] = digits[digest[it] >> 4];
+		hex[it * 2 + 1] = digits[digest[it] & 0xF];
+	}
+	return hex;
+}
+
+std::string FastSha1::Hash(const uint8_t* data, size_t len)
+{
+	FastSha1 sha1;
+	sha1.Update(data, len);
+	return sha1.FinalHex();
+}
@@ -0,0 +1,89 @@
+#include "FileWatcher.h"
+#include "Logger.h"
+#include <filesystem>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+bool FileWatcher::Watch(const std::string& file)
+{
+	Stop();
+	filename = file;
+	std::filesystem::path path(filename);
+	name = path.filename().string();
+#ifdef __linux__
+	std::string directory = path.has_parent_path() ? path.parent_path().string() : ".";
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd < 0 || inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		LOG_ERROR("Could not watch {} for changes", filename);
+		Stop();
+		return false;
+	}
+#else
+	if (!Stat(size, mtime))
+	{
+		LOG_ERROR("Could not watch {} for changes", filename);
+		filename = "";
+		return false;
+	}
+	last_check = std::chrono::steady_clock::now();
+#endif
+	return true;
+}
+
+void FileWatcher::Stop()
+{
+#ifdef __linux__
+	if (inotify_fd >= 0)
+		close(inotify_fd); //removes the watch with it
+	inotify_fd = -1;
+#endif
+	filename = "";
+}
+
+bool FileWatcher::Stat(uint64_t& file_size, int64_t& file_mtime)
+{
+	std::error_code error;
+	file_size = std::filesystem::file_size(filename, error);
+	if (!error)
+		file_mtime = (int64_t)std::filesystem::last_write_time(filename, error).time_since_epoch().count();
+	return !error;
+}
+
+bool FileWatcher::Poll()
+{
+	if (filename == "")
+		return false;
+	bool changed = false;
+#ifdef __linux__
+	//events for other files in the directory are read and dropped
+	alignas(struct inotify_event) char buffer[4096];
+	ssize_t length;
+	while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0)
+	{
+		for (char* at = buffer; at < buffer + length;)
+		{
+			const struct inotify_event* event = (const struct inotify_event*)at;
+			if (event->len && name == event->name)
+				changed = true;
+			at += sizeof(struct inotify_event) + event->len;
+		}
+	}
+#else
+	auto now = std::chrono::steady_clock::now();
+	if (now - last_check < std::chrono::milliseconds(POLL_MS))
+		return false;
+	last_check = now;
+	uint64_t new_size;
+	int64_t new_mtime;
+	if (Stat(new_size, new_mtime) && (new_size != size || new_mtime != mtime))
+	{
+		size = new_size;
+		mtime = new_mtime;
+		changed = true;
+	}
+#endif
+	return changed;
+}
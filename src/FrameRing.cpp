@@ -0,0 +1,293 @@
+#include "FrameRing.h"
+#include "Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//the layout is plain C, the seqlock words and latest are used through std::atomic of the same size
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "atomics must match the shared layout");
+
+static std::atomic<uint32_t>& Sequence(const kip8_frame_slot* slot)
+{
+	return *reinterpret_cast<std::atomic<uint32_t>*>(const_cast<uint32_t*>(&slot->sequence));
+}
+
+static std::atomic<uint64_t>& Latest(const kip8_frame_ring_header* header)
+{
+	return *reinterpret_cast<std::atomic<uint64_t>*>(const_cast<uint64_t*>(&header->latest));
+}
+
+#ifdef _WIN32
+static std::string MappingName(const std::string& name)
+{
+	return "Local\\" + (name.size() && name[0] == '/' ? name.substr(1) : name);
+}
+
+bool FrameRing::Create(const std::string& name, uint32_t slots)
+{
+	Close();
+	size_t map_size = sizeof(kip8_frame_ring_header) + (size_t)slots * sizeof(kip8_frame_slot);
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)map_size >> 32), (DWORD)map_size, MappingName(name).c_str());
+	if (!mapping)
+	{
+		LOG_ERROR("Could not create shared memory frame ring {}", name);
+		return false;
+	}
+	map_handle = mapping;
+	if (!Map(map_size, true))
+		return false;
+	owner = true;
+	shm_name = name;
+
+	kip8_frame_ring_header* header = (kip8_frame_ring_header*)data;
+	memset(data, 0, map_size);
+	header->version = KIP8_FRAME_RING_VERSION;
+	header->slot_count = slots;
+	header->slot_size = sizeof(kip8_frame_slot);
+	header->header_size = sizeof(kip8_frame_ring_header);
+	header->writer_pid = (uint32_t)GetCurrentProcessId();
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = KIP8_FRAME_RING_MAGIC; //last, readers check it before anything else
+	LOG_INFO("Publishing frames to shared memory ring {} ({} slots, {} bytes)", name, slots, map_size);
+	return true;
+}
+
+bool FrameRing::Open(const std::string& name)
+{
+	Close();
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, MappingName(name).c_str());
+	if (!mapping)
+	{
+		LOG_ERROR("No shared memory frame ring named {}", name);
+		return false;
+	}
+	map_handle = mapping;
+	if (!Map(0, false))
+		return false;
+	if (!CheckHeader())
+	{
+		LOG_ERROR("{} is not a KIP-8 frame ring of version {}", name, KIP8_FRAME_RING_VERSION);
+		Close();
+		return false;
+	}
+	shm_name = name;
+	return true;
+}
+
+bool FrameRing::Map(size_t map_size, bool writable)
+{
+	void* view = MapViewOfFile((HANDLE)map_handle, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, map_size);
+	if (!view)
+	{
+		LOG_ERROR("Could not map shared memory frame ring");
+		Close();
+		return false;
+	}
+	MEMORY_BASIC_INFORMATION info;
+	VirtualQuery(view, &info, sizeof(info));
+	data = (uint8_t*)view;
+	size = map_size ? map_size : (size_t)info.RegionSize;
+	return true;
+}
+
+void FrameRing::Close()
+{
+	if (data && owner)
+		((kip8_frame_ring_header*)data)->writer_pid = 0;
+	if (data)
+		UnmapViewOfFile(data);
+	if (map_handle)
+		CloseHandle(map_handle);
+	data = nullptr;
+	map_handle = nullptr;
+	size = 0;
+	owner = false;
+	published = 0;
+}
+#else
+bool FrameRing::Create(const std::string& name, uint32_t slots)
+{
+	Close();
+	size_t map_size = sizeof(kip8_frame_ring_header) + (size_t)slots * sizeof(kip8_frame_slot);
+	shm_unlink(name.c_str()); //readers still mapping an old ring keep it, they just stop getting frames
+	fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd == -1 || ftruncate(fd, (off_t)map_size) != 0)
+	{
+		LOG_ERROR("Could not create shared memory frame ring {}", name);
+		Close();
+		return false;
+	}
+	if (!Map(map_size, true))
+		return false;
+	owner = true;
+	shm_name = name;
+
+	//ftruncate zeroed everything
+	kip8_frame_ring_header* header = (kip8_frame_ring_header*)data;
+	header->version = KIP8_FRAME_RING_VERSION;
+	header->slot_count = slots;
+	header->slot_size = sizeof(kip8_frame_slot);
+	header->header_size = sizeof(kip8_frame_ring_header);
+	header->writer_pid = (uint32_t)getpid();
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = KIP8_FRAME_RING_MAGIC; //last, readers check it before anything else
+	LOG_INFO("Publishing frames to shared memory ring {} ({} slots, {} bytes)", name, slots, map_size);
+	return true;
+}
+
+bool FrameRing::Open(const std::string& name)
+{
+	Close();
+	fd = shm_open(name.c_str(), O_RDONLY, 0);
+	struct stat info;
+	if (fd == -1 || fstat(fd, &info) != 0)
+	{
+		LOG_ERROR("No shared memory frame ring named {}", name);
+		Close();
+		return false;
+	}
+	if (!Map((size_t)info.st_size, false))
+		return false;
+	if (!CheckHeader())
+	{
+		LOG_ERROR("{} is not a KIP-8 frame ring of version {}", name, KIP8_FRAME_RING_VERSION);
+		Close();
+		return false;
+	}
+	shm_name = name;
+	return true;
+}
+
+bool FrameRing::Map(size_t map_size, bool writable)
+{
+	void* view = map_size ? mmap(nullptr, map_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	if (view == MAP_FAILED)
+	{
+		LOG_ERROR("Could not map shared memory frame ring");
+		Close();
+		return false;
+	}
+	data = (uint8_t*)view;
+	size = map_size;
+	return true;
+}
+
+void FrameRing::Close()
+{
+	if (data && owner)
+	{
+		((kip8_frame_ring_header*)data)->writer_pid = 0;
+		shm_unlink(shm_name.c_str());
+	}
+	if (data)
+		munmap(data, size);
+	if (fd != -1)
+		close(fd);
+	data = nullptr;
+	fd = -1;
+	size = 0;
+	owner = false;
+	published = 0;
+}
+#endif
+
+bool FrameRing::CheckHeader()
+{
+	const kip8_frame_ring_header* header = Header();
+	return size >= sizeof(kip8_frame_ring_header) && header->magic == KIP8_FRAME_RING_MAGIC && header->version == KIP8_FRAME_RING_VERSION
+		&& header->slot_size == sizeof(kip8_frame_slot) && header->slot_count && size >= header->header_size + (size_t)header->slot_count * header->slot_size;
+}
+
+void FrameRing::Publish(Chip8* core, const uint32_t* palette)
+{
+	if (!data || !owner)
+		return;
+	kip8_frame_ring_header* header = (kip8_frame_ring_header*)data;
+	kip8_frame_slot* slot = (kip8_frame_slot*)(data + sizeof(kip8_frame_ring_header)) + published % header->slot_count;
+
+	std::atomic<uint32_t>& sequence = Sequence(slot);
+	uint32_t start = sequence.load(std::memory_order_relaxed);
+	sequence.store(start + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release); //odd before any of the data below
+
+	slot->frame = published;
+	slot->total_cycles = core->GetTotalCycles();
+	for (uint8_t it = 0; it < 16; it++)
+		slot->v[it] = *core->GetRegV(it);
+	slot->i = *core->GetRegI();
+	slot->pc = *core->GetPC();
+	memcpy(slot->stack, core->GetStack(), sizeof(slot->stack));
+	slot->sp = *core->GetSP();
+	slot->delay_timer = core->GetDelayTimer();
+	slot->sound_timer = core->GetSoundTimer();
+	slot->mode = (uint8_t)core->GetSystemMode();
+	slot->width = core->res.base_width;
+	slot->height = core->res.base_height;
+	slot->hires = core->res.hires;
+	slot->halted = core->GetHalted();
+	slot->keys = core->GetKeyMask();
+	memcpy(slot->palette, palette, sizeof(slot->palette));
+	memcpy(slot->vram, core->GetVRAM(), (size_t)slot->width * slot->height);
+
+	sequence.store(start + 2, std::memory_order_release);
+	published++;
+	Latest(header).store(published, std::memory_order_release);
+}
+
+const kip8_frame_slot* FrameRing::Slot(uint64_t frame)
+{
+	const kip8_frame_ring_header* header = Header();
+	return (const kip8_frame_slot*)(data + header->header_size) + frame % header->slot_count;
+}
+
+uint32_t FrameRing::BeginRead(const kip8_frame_slot* slot)
+{
+	uint32_t sequence = Sequence(slot).load(std::memory_order_acquire);
+	while (sequence & 1)
+	{
+		std::this_thread::yield(); //a slot is written in well under a microsecond
+		sequence = Sequence(slot).load(std::memory_order_acquire);
+	}
+	return sequence;
+}
+
+bool FrameRing::EndRead(const kip8_frame_slot* slot, uint32_t sequence)
+{
+	std::atomic_thread_fence(std::memory_order_acquire); //everything read from the slot before the check
+	return Sequence(slot).load(std::memory_order_relaxed) == sequence;
+}
+
+uint64_t FrameRing::GetLatest()
+{
+	if (!data || Header()->magic != KIP8_FRAME_RING_MAGIC)
+		return 0;
+	return Latest(Header()).load(std::memory_order_acquire);
+}
+
+bool FrameRing::ReadLatest(kip8_frame_slot& out)
+{
+	while (true)
+	{
+		uint64_t latest = GetLatest();
+		if (latest == 0)
+			return false;
+		const kip8_frame_slot* slot = Slot(latest - 1);
+		uint32_t sequence = BeginRead(slot);
+		memcpy(&out, slot, offsetof(kip8_frame_slot, vram));
+		memcpy(out.vram, slot->vram, std::min<size_t>((size_t)out.width * out.height, KIP8_FRAME_MAX_PIXELS)); //may be torn
+		if (EndRead(slot, sequence) && out.frame == latest - 1)
+			return true;
+	}
+}
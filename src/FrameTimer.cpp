@@ -0,0 +1,178 @@
+#include "FrameTimer.h"
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+static const char* zone_names[FrameTimer::ZONE_COUNT] = { "AdvanceCore", "HandleInput", "DrawScreen", "ImGui Draw", "RenderPresent", "Audio", "Frame" };
+
+static int64_t SteadyNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t ThreadNumber()
+{
+	static std::atomic<uint32_t> next{ 0 };
+	thread_local uint32_t number = next.fetch_add(1, std::memory_order_relaxed);
+	return number;
+}
+
+FrameTimer::FrameTimer() : epoch(SteadyNanoseconds()), slots(new Slot[CAPACITY])
+{
+}
+
+int64_t FrameTimer::Now() const
+{
+	return SteadyNanoseconds() - epoch;
+}
+
+const char* FrameTimer::ZoneName(ZoneId zone)
+{
+	return zone < ZONE_COUNT ? zone_names[zone] : "?";
+}
+
+void FrameTimer::Record(ZoneId zone, int64_t begin, int64_t end, uint32_t arg)
+{
+	uint64_t index = head.fetch_add(1, std::memory_order_relaxed);
+	Slot& slot = slots[index & (CAPACITY - 1)];
+	slot.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.begin.store(begin, std::memory_order_relaxed);
+	slot.end.store(end, std::memory_order_relaxed);
+	slot.arg.store(arg, std::memory_order_relaxed);
+	slot.thread.store(ThreadNumber(), std::memory_order_relaxed);
+	slot.zone.store(zone, std::memory_order_relaxed);
+	slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+void FrameTimer::Snapshot(std::vector<Event>& out, size_t max_events) const
+{
+	out.clear();
+	uint64_t last = head.load(std::memory_order_acquire);
+	uint64_t count = std::min<uint64_t>(std::min<uint64_t>(last, CAPACITY), max_events);
+	out.reserve((size_t)count);
+	for (uint64_t index = last - count; index < last; index++)
+	{
+		const Slot& slot = slots[index & (CAPACITY - 1)];
+		if (slot.sequence.load(std::memory_order_acquire) != index + 1)
+			continue; //not written yet or already overwritten
+		Event event;
+		event.begin = slot.begin.load(std::memory_order_relaxed);
+		event.end = slot.end.load(std::memory_order_relaxed);
+		event.arg = slot.arg.load(std::memory_order_relaxed);
+		event.thread = slot.thread.load(std::memory_order_relaxed);
+		event.zone = (ZoneId)slot.zone.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) != index + 1)
+			continue;
+		out.push_back(event);
+	}
+}
+
+void FrameTimer::Durations(const std::vector<Event>& events, ZoneId zone, std::vector<float>& out)
+{
+	out.clear();
+	for (const Event& event : events)
+		if (event.zone == zone)
+			out.push_back((float)(event.end - event.begin) / 1000000.0f);
+}
+
+FrameTimer::Stats FrameTimer::GetStats(std::vector<float> durations)
+{
+	Stats stats;
+	stats.count = durations.size();
+	if (durations.empty())
+		return stats;
+	auto percentile = [&durations](float p) {
+		size_t rank = std::min(durations.size() - 1, (size_t)(p * durations.size()));
+		std::nth_element(durations.begin(), durations.begin() + rank, durations.end());
+		return durations[rank];
+	};
+	stats.p50 = percentile(0.50f);
+	stats.p95 = percentile(0.95f);
+	stats.p99 = percentile(0.99f);
+	stats.max = *std::max_element(durations.begin(), durations.end());
+	return stats;
+}
+
+void FrameTimer::GetRates(double& fps, double& ips, double& frame_ms) const
+{
+	fps = ips = frame_ms = 0;
+	std::vector<Event> events;
+	Snapshot(events);
+	int64_t since = Now() - 1000000000;
+	uint64_t frames = 0, instructions = 0;
+	int64_t frame_time = 0, first = -1;
+	for (const Event& event : events)
+	{
+		if (event.end < since)
+			continue;
+		if (first < 0 || event.begin < first)
+			first = std::max(event.begin, since);
+		if (event.zone == FRAME)
+		{
+			frames++;
+			frame_time += event.end - event.begin;
+		}
+		else if (event.zone == ADVANCE_CORE)
+			instructions += event.arg;
+	}
+	//right after startup, or when the ring holds less than a second, rate over what there is
+	double seconds = first < 0 ? 0 : (double)(Now() - first) / 1000000000.0;
+	if (seconds <= 0)
+		return;
+	fps = frames / seconds;
+	ips = instructions / seconds;
+	frame_ms = frames ? (double)frame_time / frames / 1000000.0 : 0;
+}
+
+bool FrameTimer::ExportChromeTrace(const std::string& filename) const
+{
+	std::vector<Event> events;
+	Snapshot(events);
+	std::ofstream ofd(filename, std::ios::out | std::ios::trunc);
+	if (!ofd.good())
+	{
+		LOG_ERROR("Could not write trace: {}", filename);
+		return false;
+	}
+
+	//complete events ("ph":"X") with microsecond timestamps, one track per recording thread
+	ofd << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	std::vector<std::pair<uint32_t, const char*>> threads; //named after what they record
+	for (const Event& event : events)
+	{
+		const char* name = event.zone == FRAME ? "main" : event.zone == AUDIO_CALLBACK ? "audio" : nullptr;
+		auto known = std::find_if(threads.begin(), threads.end(), [&event](const std::pair<uint32_t, const char*>& thread) { return thread.first == event.thread; });
+		if (known == threads.end())
+			threads.push_back({ event.thread, name ? name : "thread" });
+		else if (name)
+			known->second = name;
+	}
+	char line[256];
+	for (const auto& thread : threads)
+	{
+		snprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n", thread.first, thread.second);
+		ofd << line;
+	}
+	for (const Event& event : events)
+	{
+		snprintf(line, sizeof(line), "{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+			ZoneName(event.zone), event.thread, event.begin / 1000.0, (event.end - event.begin) / 1000.0);
+		ofd << line;
+		if (event.zone == ADVANCE_CORE)
+			ofd << ",\"args\":{\"instructions\":" << event.arg << "}";
+		ofd << "},\n";
+	}
+	ofd << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"KIP-8\"}}\n]}\n";
+	ofd.close();
+	if (!ofd.good())
+	{
+		LOG_ERROR("Failed writing trace: {}", filename);
+		return false;
+	}
+	LOG_INFO("Wrote {} timing events to {}", events.size(), filename);
+	return true;
+}
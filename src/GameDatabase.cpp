@@ -0,0 +1,410 @@
+#include "GameDatabase.h"
+#include "Checksum.h"
+#include "Logger.h"
+#pragma warning(push, 0)
+#include <json/json.h>
+#pragma warning(pop)
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+//game_db.bin: header, games, bucket seeds, slots, strings. strings are offsets into the string block, all terminated
+#pragma pack(push, 1)
+struct GameDbHeader {
+	char magic[4];
+	uint16_t version;
+	uint16_t reserved;
+	uint32_t game_count;
+	uint32_t slot_count;
+	uint32_t bucket_count;
+	int32_t default_game; //-1 without a "default" entry
+	uint32_t strings_size;
+};
+
+struct GameDbGame {
+	uint32_t key;
+	uint32_t title;
+	uint8_t mode;
+	uint8_t quirks_set;
+	uint8_t quirks_on;
+	uint8_t has_tickrate;
+	uint16_t tickrate;
+	uint16_t rotation;
+	uint32_t colors[4];
+};
+
+struct GameDbSlot {
+	uint8_t sha1[20];
+	uint32_t key;  //EMPTY_SLOT for unused slots
+	int32_t game;  //-1 when the key has no settings
+};
+#pragma pack(pop)
+
+static const uint16_t GAME_DB_VERSION = 1;
+static const uint32_t EMPTY_SLOT = 0xFFFFFFFF;
+
+const uint32_t GameDatabase::DEFAULT_COLORS[4] = { 0x001B1B, 0x008080, 0x4CA6A6, 0x99CCCC };
+
+static bool ParseSha1(const std::string& hex, uint8_t out[20])
+{
+	if (hex.size() != 40)
+		return false;
+	for (int it = 0; it < 20; it++)
+	{
+		int val = 0;
+		for (int nibble = 0; nibble < 2; nibble++)
+		{
+			char c = hex[it * 2 + nibble];
+			int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+			if (digit < 0)
+				return false;
+			val = val << 4 | digit;
+		}
+		out[it] = (uint8_t)val;
+	}
+	return true;
+}
+
+//SHA1s are already uniformly distributed, their first 8 bytes are the key
+static uint64_t HashKey(const uint8_t sha1[20])
+{
+	uint64_t key = 0;
+	for (int it = 0; it < 8; it++)
+		key = key << 8 | sha1[it];
+	return key;
+}
+
+static uint32_t SlotOf(uint64_t key, uint16_t seed, uint32_t slot_count)
+{
+	return (uint32_t)(Mix64(key + seed) % slot_count);
+}
+
+static uint32_t ParseColor(const Json::Value& options, const char* name, uint32_t fallback)
+{
+	std::string hex = options.get(name, "").asString();
+	if (hex.size() != 7 || hex[0] != '#')
+		return fallback;
+	char* end;
+	unsigned long val = strtoul(hex.c_str() + 1, &end, 16);
+	return *end ? fallback : (uint32_t)val;
+}
+
+static int ParseNumber(const Json::Value& value, int fallback)
+{
+	if (value.isNumeric())
+		return value.asInt();
+	if (!value.isString())
+		return fallback;
+	char* end;
+	long val = strtol(value.asCString(), &end, 10);
+	return end == value.asCString() ? fallback : (int)val;
+}
+
+static bool ReadJson(const std::string& filename, Json::Value& root)
+{
+	std::ifstream ifd(filename);
+	if (!ifd.good())
+		return false;
+	Json::CharReaderBuilder builder;
+	std::string errors;
+	if (!Json::parseFromStream(builder, ifd, &root, &errors) || !root.isObject())
+	{
+		LOG_ERROR("Could not parse {}: {}", filename, errors);
+		return false;
+	}
+	return true;
+}
+
+bool GameDatabase::Open(const std::string& compiled, const std::string& hashes_json, const std::string& settings_json)
+{
+	namespace fs = std::filesystem;
+	std::error_code error;
+	fs::file_time_type compiled_time = fs::last_write_time(compiled, error);
+	bool stale = error.value() != 0;
+	for (const std::string& source : { hashes_json, settings_json })
+	{
+		fs::file_time_type source_time = fs::last_write_time(source, error);
+		if (!error && !stale && source_time > compiled_time)
+			stale = true;
+	}
+
+	if (!stale && file.Open(compiled) && Attach(file.Data(), file.Size()))
+	{
+		LOG_INFO("Loaded game database {} ({} games)", compiled, game_count);
+		return true;
+	}
+	file.Close();
+
+	built.clear();
+	if (!Compile(hashes_json, settings_json, built) || !Attach(built.data(), built.size()))
+	{
+		LOG_INFO("No game database, every rom starts with the default settings");
+		return false;
+	}
+	std::ofstream ofd(compiled, std::ios::binary | std::ios::out | std::ios::trunc);
+	ofd.write((const char*)built.data(), built.size());
+	ofd.close();
+	if (!ofd.good())
+		LOG_WARN("Could not write compiled game database {}, using it from memory", compiled);
+	LOG_INFO("Compiled {} and {} into {} ({} games)", hashes_json, settings_json, compiled, game_count);
+	return true;
+}
+
+bool GameDatabase::Attach(const uint8_t* image, size_t image_size)
+{
+	data = nullptr;
+	slot_count = 0;
+	GameDbHeader header;
+	if (image_size < sizeof(header))
+		return false;
+	memcpy(&header, image, sizeof(header));
+	size_t needed = sizeof(header) + (size_t)header.game_count * sizeof(GameDbGame) + (size_t)header.bucket_count * sizeof(uint16_t)
+		+ (size_t)header.slot_count * sizeof(GameDbSlot) + header.strings_size;
+	if (memcmp(header.magic, "KGDB", 4) != 0 || header.version != GAME_DB_VERSION || image_size != needed
+		|| header.slot_count == 0 || header.bucket_count == 0 || header.default_game >= (int32_t)header.game_count
+		|| header.strings_size == 0 || image[image_size - 1] != 0)
+	{
+		LOG_ERROR("Compiled game database is corrupt or from another version");
+		return false;
+	}
+
+	data = image;
+	game_count = header.game_count;
+	slot_count = header.slot_count;
+	bucket_count = header.bucket_count;
+	default_game = header.default_game;
+	strings_size = header.strings_size;
+	const uint8_t* at = image + sizeof(header);
+	games = (const GameDbGame*)at;
+	at += (size_t)game_count * sizeof(GameDbGame);
+	seeds = (const uint16_t*)at;
+	at += (size_t)bucket_count * sizeof(uint16_t);
+	slots = (const GameDbSlot*)at;
+	at += (size_t)slot_count * sizeof(GameDbSlot);
+	strings = (const char*)at;
+	return true;
+}
+
+bool GameDatabase::Compile(const std::string& hashes_json, const std::string& settings_json, std::vector<uint8_t>& out)
+{
+	Json::Value hashes, settings;
+	if (!ReadJson(hashes_json, hashes))
+		return false;
+	ReadJson(settings_json, settings);
+
+	std::string string_block(1, '\0'); //offset 0 is the empty string
+	auto add_string = [&string_block](const std::string& str) {
+		if (str.empty())
+			return (uint32_t)0;
+		uint32_t offset = (uint32_t)string_block.size();
+		string_block.append(str);
+		string_block.push_back('\0');
+		return offset;
+	};
+
+	//one game per game_settings key, with the defaults LoadPrefs used to fill in
+	std::vector<GameDbGame> games_out;
+	std::vector<std::string> game_keys;
+	int32_t default_index = -1;
+	for (const std::string& key : settings.getMemberNames())
+	{
+		const Json::Value& entry = settings[key];
+		if (!entry.isObject())
+			continue;
+		const Json::Value& options = entry["options"];
+		GameDbGame game;
+		memset(&game, 0, sizeof(game));
+		game.key = add_string(key);
+		game.title = add_string(entry.get("title", "").asString());
+		std::string platform = entry.get("platform", "chip8").asString();
+		game.mode = (uint8_t)(platform == "chip8" ? Chip8::SYSTEM_MODE::CHIP_8 : platform == "schip" ? Chip8::SYSTEM_MODE::SUPER_CHIP : Chip8::SYSTEM_MODE::XO_CHIP);
+		int tickrate = ParseNumber(options["tickrate"], -1);
+		game.has_tickrate = tickrate >= 0;
+		game.tickrate = (uint16_t)std::max(0, std::min(tickrate, 0xFFFF));
+		game.rotation = (uint16_t)ParseNumber(options["screenRotation"], 0);
+		game.colors[0] = ParseColor(options, "backgroundColor", DEFAULT_COLORS[0]);
+		game.colors[1] = ParseColor(options, "fillColor", DEFAULT_COLORS[1]);
+		game.colors[2] = ParseColor(options, "fillColor2", DEFAULT_COLORS[2]);
+		game.colors[3] = ParseColor(options, "blendColor", DEFAULT_COLORS[3]);
+		static const std::pair<const char*, uint8_t> quirk_options[] = { { "shiftQuirks", SHIFT }, { "loadStoreQuirks", LOAD_STORE },
+			{ "jumpQuirks", JUMP }, { "vBlankQuirks", VBLANK }, { "logicQuirks", LOGIC }, { "clipQuirks", CLIP } };
+		for (const auto& quirk : quirk_options)
+		{
+			if (!options.isObject() || !options.isMember(quirk.first))
+				continue;
+			game.quirks_set |= quirk.second;
+			if (options[quirk.first].asBool())
+				game.quirks_on |= quirk.second;
+		}
+		if (key == "default")
+			default_index = (int32_t)games_out.size();
+		games_out.push_back(game);
+		game_keys.push_back(key);
+	}
+
+	struct Hash {
+		uint8_t sha1[20];
+		uint64_t key;
+		uint32_t name;
+		int32_t game;
+	};
+	std::vector<Hash> entries;
+	for (const std::string& sha1 : hashes.getMemberNames())
+	{
+		Hash hash;
+		if (!hashes[sha1].isString() || !ParseSha1(sha1, hash.sha1))
+		{
+			LOG_WARN("Skipping bad hashmap.json entry {}", sha1);
+			continue;
+		}
+		std::string key = hashes[sha1].asString();
+		hash.key = HashKey(hash.sha1);
+		hash.name = add_string(key);
+		auto found = std::find(game_keys.begin(), game_keys.end(), key);
+		hash.game = found == game_keys.end() ? -1 : (int32_t)(found - game_keys.begin());
+		entries.push_back(hash);
+	}
+
+	//hash and displace: biggest buckets first, each gets the first seed that lands all its keys on free slots
+	uint32_t buckets = std::max<uint32_t>(1, (uint32_t)entries.size() / 4);
+	uint32_t slot_total = std::max<uint32_t>(1, (uint32_t)(entries.size() + entries.size() / 8 + 1));
+	std::vector<uint16_t> seeds_out;
+	std::vector<GameDbSlot> slots_out;
+	while (true)
+	{
+		std::vector<std::vector<size_t>> by_bucket(buckets);
+		for (size_t it = 0; it < entries.size(); it++)
+			by_bucket[entries[it].key % buckets].push_back(it);
+		std::vector<uint32_t> order(buckets);
+		for (uint32_t it = 0; it < buckets; it++)
+			order[it] = it;
+		std::stable_sort(order.begin(), order.end(), [&by_bucket](uint32_t a, uint32_t b) { return by_bucket[a].size() > by_bucket[b].size(); });
+
+		seeds_out.assign(buckets, 0);
+		slots_out.assign(slot_total, GameDbSlot());
+		for (GameDbSlot& slot : slots_out)
+		{
+			memset(&slot, 0, sizeof(slot));
+			slot.key = EMPTY_SLOT;
+			slot.game = -1;
+		}
+		bool placed_all = true;
+		for (uint32_t bucket : order)
+		{
+			const std::vector<size_t>& members = by_bucket[bucket];
+			if (members.empty())
+				break;
+			bool placed = false;
+			for (uint32_t seed = 0; seed <= 0xFFFF && !placed; seed++)
+			{
+				std::vector<uint32_t> taken;
+				for (size_t member : members)
+				{
+					uint32_t slot = SlotOf(entries[member].key, (uint16_t)seed, slot_total);
+					if (slots_out[slot].key != EMPTY_SLOT || std::find(taken.begin(), taken.end(), slot) != taken.end())
+						break;
+					taken.push_back(slot);
+				}
+				if (taken.size() != members.size())
+					continue;
+				for (size_t it = 0; it < members.size(); it++)
+				{
+					const Hash& hash = entries[members[it]];
+					memcpy(slots_out[taken[it]].sha1, hash.sha1, 20);
+					slots_out[taken[it]].key = hash.name;
+					slots_out[taken[it]].game = hash.game;
+				}
+				seeds_out[bucket] = (uint16_t)seed;
+				placed = true;
+			}
+			if (!placed)
+			{
+				placed_all = false;
+				break;
+			}
+		}
+		if (placed_all)
+			break;
+		slot_total += slot_total / 4 + 1; //a bit more room and try again. never happened with the real database
+	}
+
+	GameDbHeader header;
+	memcpy(header.magic, "KGDB", 4);
+	header.version = GAME_DB_VERSION;
+	header.reserved = 0;
+	header.game_count = (uint32_t)games_out.size();
+	header.slot_count = slot_total;
+	header.bucket_count = buckets;
+	header.default_game = default_index;
+	header.strings_size = (uint32_t)string_block.size();
+
+	auto append = [&out](const void* src, size_t len) {
+		out.insert(out.end(), (const uint8_t*)src, (const uint8_t*)src + len);
+	};
+	append(&header, sizeof(header));
+	append(games_out.data(), games_out.size() * sizeof(GameDbGame));
+	append(seeds_out.data(), seeds_out.size() * sizeof(uint16_t));
+	append(slots_out.data(), slots_out.size() * sizeof(GameDbSlot));
+	append(string_block.data(), string_block.size());
+	return true;
+}
+
+void GameDatabase::ReadGame(int32_t index, Game& game)
+{
+	GameDbGame packed;
+	memcpy(&packed, &games[index], sizeof(packed));
+	auto read_string = [this](uint32_t offset) { return offset < strings_size ? std::string(strings + offset) : std::string(); };
+	game.key = read_string(packed.key);
+	game.title = read_string(packed.title);
+	game.mode = (Chip8::SYSTEM_MODE)std::min<uint8_t>(packed.mode, Chip8::SYSTEM_MODE::XO_CHIP);
+	game.has_settings = true;
+	game.has_tickrate = packed.has_tickrate != 0;
+	game.tickrate = packed.tickrate;
+	game.rotation = packed.rotation;
+	memcpy(game.colors, packed.colors, sizeof(game.colors));
+	game.quirks_set = packed.quirks_set;
+	game.quirks_on = packed.quirks_on;
+}
+
+bool GameDatabase::Find(const std::string& sha1, Game& game)
+{
+	uint8_t digest[20];
+	if (!data || !ParseSha1(sha1, digest))
+		return false;
+	uint64_t key = HashKey(digest);
+	GameDbSlot slot;
+	memcpy(&slot, &slots[SlotOf(key, seeds[key % bucket_count], slot_count)], sizeof(slot));
+	if (slot.key == EMPTY_SLOT || memcmp(slot.sha1, digest, 20) != 0)
+		return false;
+
+	game = Game();
+	if (slot.game >= 0 && slot.game < (int32_t)game_count)
+		ReadGame(slot.game, game);
+	else
+		memcpy(game.colors, DEFAULT_COLORS, sizeof(game.colors));
+	game.key = slot.key < strings_size ? std::string(strings + slot.key) : std::string();
+	return true;
+}
+
+bool GameDatabase::FindDefault(Game& game)
+{
+	if (!data || default_game < 0)
+		return false;
+	game = Game();
+	ReadGame(default_game, game);
+	return true;
+}
+
+void GameDatabase::ApplyQuirks(const Game& game, Chip8::Quirks& quirks)
+{
+	//This emulator assumes schip 1.1 behavior is normal and enables quirks for other behaviors. Octo takes the
+	//opposite approach and assumes Cosmac VIP is normal behavior, so the first three are set opposite the database
+	auto option = [&game](uint8_t bit, bool current) { return game.quirks_set & bit ? (game.quirks_on & bit) != 0 : current; };
+	quirks.vip_shifts = !option(SHIFT, !quirks.vip_shifts);
+	quirks.vip_regs_read_write = !option(LOAD_STORE, !quirks.vip_regs_read_write);
+	quirks.vip_jump = !option(JUMP, !quirks.vip_jump);
+	quirks.draw_vblank = option(VBLANK, quirks.draw_vblank);
+	quirks.logic_flag_reset = option(LOGIC, quirks.logic_flag_reset);
+	quirks.draw_wrap = option(CLIP, quirks.draw_wrap);
+}
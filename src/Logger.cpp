@@ -3,8 +3,29 @@
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/sinks/rotating_file_sink.h"
 #include "spdlog/sinks/dist_sink.h"
+#include "spdlog/sinks/basic_file_sink.h"
+#include "spdlog/sinks/null_sink.h"
+#include "spdlog/sinks/base_sink.h"
 #pragma warning(pop)
 
+class CallbackSink : public spdlog::sinks::base_sink<std::mutex>
+{
+public:
+	CallbackSink(Logger::Callback callback, void* user) : callback(callback), user(user) {}
+
+protected:
+	void sink_it_(const spdlog::details::log_msg& msg) override
+	{
+		std::string text(msg.payload.data(), msg.payload.size());
+		callback((int)msg.level, text.c_str(), text.size(), user);
+	}
+	void flush_() override {}
+
+private:
+	Logger::Callback callback;
+	void* user;
+};
+
 std::shared_ptr<spdlog::logger> Logger::s_Logger;
 
 void Logger::Init()
@@ -17,3 +38,33 @@ void Logger::Init()
 	s_Logger->sinks().push_back(console_sink);
 	s_Logger->set_level(spdlog::level::info);
 }
+
+void Logger::InitConsole(spdlog::level::level_enum level)
+{
+	s_Logger = std::make_shared<spdlog::logger>("KIP-8", std::make_shared<spdlog::sinks::stderr_color_sink_mt>());
+	s_Logger->set_pattern("%^[%T] %n: %v%$");
+	s_Logger->set_level(level);
+}
+
+std::shared_ptr<spdlog::logger> Logger::CreateWorkerLogger(const std::string& name, const std::string& filename, spdlog::level::level_enum level)
+{
+	std::shared_ptr<spdlog::logger> logger;
+	if (filename == "")
+	{
+		//level off as well, so discarded messages aren't even formatted
+		logger = std::make_shared<spdlog::logger>(name, std::make_shared<spdlog::sinks::null_sink_st>());
+		logger->set_level(spdlog::level::off);
+		return logger;
+	}
+	logger = std::make_shared<spdlog::logger>(name, std::make_shared<spdlog::sinks::basic_file_sink_st>(filename, true));
+	logger->set_pattern("[%T] %n: %v");
+	logger->set_level(level);
+	return logger;
+}
+
+std::shared_ptr<spdlog::logger> Logger::CreateCallbackLogger(const std::string& name, Callback callback, void* user, spdlog::level::level_enum level)
+{
+	std::shared_ptr<spdlog::logger> logger = std::make_shared<spdlog::logger>(name, std::make_shared<CallbackSink>(callback, user));
+	logger->set_level(level);
+	return logger;
+}
@@ -2,16 +2,108 @@
 #include "CLI11.hpp"
 #include "Chip8.h"
 #include "SDLFrontEnd.h"
+#include "FastSha1.h"
+#include "RomLibrary.h"
+#include "RomLoader.h"
+#include "StartupTimeline.h"
 #include <iostream>
+#include <fstream>
 
+//runs an input movie against the core without the SDL frontend, as fast as possible
+//with coverage set, the replay is profiled and written out as an lcov tracefile, see Profiler::ExportLcov. with
+//folded set, its call stacks are written for flame graphs, see Profiler::ExportFolded
+static int ReplayMovie(Chip8* core, const std::string& rom_file, const std::string& movie_file, const std::string& coverage_file, const std::string& folded_file)
+{
+	Movie movie;
+	if (!movie.Open(movie_file))
+		return 1;
+
+	RomLoader::Rom rom;
+	if (rom_file == "" || !RomLoader::Read(rom_file, rom))
+	{
+		LOG_ERROR("Replay needs the movie's rom file (--rom).");
+		return 1;
+	}
+
+	if (rom.sha1 != movie.GetRomSHA1())
+	{
+		LOG_ERROR("Rom SHA1 {} does not match the movie's rom {}", rom.sha1, movie.GetRomSHA1());
+		return 1;
+	}
+
+	std::unique_ptr<Profiler> profiler;
+	if (coverage_file != "" || folded_file != "")
+	{
+		profiler = std::make_unique<Profiler>();
+		profiler->LoadSymbolsFor(rom_file);
+		core->SetProfiler(profiler.get());
+	}
+
+	Movie::ReplayResult result;
+	bool in_sync = movie.Replay(core, rom.data, result);
+
+	if (profiler)
+	{
+		core->SetProfiler(nullptr);
+		std::string test_name = movie_file.substr(movie_file.find_last_of("/\\") + 1);
+		test_name = test_name.substr(0, test_name.find_last_of('.'));
+		if (coverage_file != "" && !profiler->ExportLcov(coverage_file, rom_file + ".lst", rom.data, test_name))
+			return 1;
+		if (folded_file != "" && !profiler->ExportFolded(folded_file))
+			return 1;
+	}
+
+	std::cout << "frames: " << result.frames << std::endl;
+	std::cout << "cycles: " << result.cycles << std::endl;
+	std::cout << "wall time: " << result.microseconds / 1000.0 << " ms (" << (result.microseconds ? result.frames * 1000000.0 / result.microseconds : 0.0) << " frames/s)" << std::endl;
+	std::cout << "framebuffer crc: " << std::hex << result.vram_crc << std::dec << std::endl;
+	if (in_sync)
+		std::cout << "result: framebuffers identical to recording" << std::endl;
+	else
+		std::cout << "result: DESYNC, first mismatch at frame " << result.first_desync_frame << std::endl;
+
+	return in_sync ? 0 : 2;
+}
+
+//indexes every rom under a directory and lists them with what the game database knows about them
+static int ScanLibrary(const std::string& root)
+{
+	RomLibrary library;
+	library.LoadIndex("rom_library.idx");
+	RomLibrary::ScanStats stats;
+	if (!library.Scan(root, &stats))
+		return 1;
+	GameDatabase database;
+	database.Open("game_db.bin", "hashmap.json", "game_settings.json");
+	library.Join(database);
+
+	for (const RomLibrary::Entry& entry : library.GetEntries())
+		std::cout << entry.sha1 << "  " << (entry.platform == "" ? "?" : entry.platform) << "  " << entry.title << "  " << entry.path << std::endl;
+	std::cout << stats.files << " roms, " << stats.hashed << " hashed, " << stats.reused << " from the index, " << stats.removed << " removed, "
+		<< stats.failed << " unreadable in " << stats.milliseconds << " ms (" << (FastSha1::HardwareAccelerated() ? "SHA-NI" : "scalar") << " SHA1)" << std::endl;
+	return 0;
+}
 
 int main(int argc, char* argv[])
 {
-	Logger::Init();
+	{
+		StartupTimeline::Phase phase("logger");
+		Logger::Init();
+	}
 
 	std::string filename = "";
 	bool enableGUI = false, enableChip8 = true, enableSuperChip = false, enableXOChip = false; //enableOcto = false;
 	int CPUSpeed = 9;
+	uint64_t seed = 0;
+	std::string replay_file = "";
+	std::string coverage_file = "";
+	std::string folded_file = "";
+	std::string trace_file = "";
+	std::string shm_name = "";
+	std::string library_dir = "";
+	std::string render_driver = "";
+	std::string library_root = "";
+	bool startup_profile = false;
 	
 	CLI::App app{"Cross platform CHIP-8 interpreter"};
 
@@ -21,9 +113,24 @@ int main(int argc, char* argv[])
 	app.add_flag("-S,--Super-Chip", enableSuperChip, "Set system mode to Super-Chip");
 	app.add_flag("-X,--XO-Chip", enableXOChip, "Set system mode to XO-Chip");
 	app.add_option("-s,--speed", CPUSpeed, "Set CPU cycles per frame");
+	app.add_option("--replay", replay_file, "Replay an input movie headlessly at full speed (requires --rom)");
+	app.add_option("--coverage", coverage_file, "With --replay, write which rom code the movie ran as an lcov tracefile (the rom listing goes next to the rom)");
+	app.add_option("--folded", folded_file, "With --replay, write the movie's guest call stacks in folded format for flame graphs (names from <rom>.sym)");
+	app.add_option("--trace", trace_file, "On exit, write how long each phase of the last frames took as a Chrome trace (chrome://tracing, Perfetto)");
+	app.add_option("--shm", shm_name, "Publish every frame to a shared memory ring with this name (e.g. /kip8) for external tools");
+	app.add_option("--scan-library", library_dir, "Index every rom under a directory, print what the game database knows about them and exit");
+	app.add_option("--renderer", render_driver, "SDL render driver to use instead of opengl (e.g. direct3d, metal, software)");
+	app.add_flag("--startup-profile", startup_profile, "Log how long each part of startup took once the first frame is up");
+	app.add_option("--library", library_root, "Directory of roms for the launcher, which opens at startup when no rom is given");
+	auto seed_option = app.add_option("--seed", seed, "Seed the random number generator for reproducible runs");
 	CLI11_PARSE(app, argc, argv);
 
+	if (library_dir != "")
+		return ScanLibrary(library_dir);
+
 	Chip8* core = new Chip8();
+	if (*seed_option)
+		core->SetSeed(seed);
 
 	if(enableXOChip)
 		core->SetSystemMode(Chip8::SYSTEM_MODE::XO_CHIP);
@@ -33,15 +140,36 @@ int main(int argc, char* argv[])
 		core->SetSystemMode(Chip8::SYSTEM_MODE::CHIP_8);
 	core->Reset();
 
+	if (replay_file != "")
+	{
+		int result = ReplayMovie(core, filename, replay_file, coverage_file, folded_file);
+		delete core;
+		return result;
+	}
+
+	if (render_driver != "")
+		SDL_SetHint(SDL_HINT_RENDER_DRIVER, render_driver.c_str());
+
 	SDLFrontEnd* frontend = new SDLFrontEnd(core, enableGUI);
+	if (startup_profile)
+		frontend->ProfileStartup();
 	
 	frontend->SetRunCycles(std::max<int>(0,CPUSpeed));
+	if (shm_name != "")
+		frontend->ExportFrames(shm_name);
+	if (library_root != "")
+		frontend->SetLibrary(library_root, filename == "");
 
 	if (filename != "")
+	{
+		StartupTimeline::Phase phase("rom");
 		frontend->Load(filename);
+	}
 
 	while (frontend->Run()) {} //just run the emulator until the frontend says not to
 
+	if (trace_file != "")
+		frontend->ExportTrace(trace_file);
 	delete frontend;
 	delete core;
 	
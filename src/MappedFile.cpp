@@ -0,0 +1,103 @@
+#include "MappedFile.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) //zero length files can't be mapped
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	file_handle = file;
+	map_handle = mapping;
+	data = (const uint8_t*)view;
+	size = (size_t)file_size.QuadPart;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data)
+		UnmapViewOfFile(data);
+	if (map_handle)
+		CloseHandle(map_handle);
+	if (file_handle)
+		CloseHandle(file_handle);
+	data = nullptr;
+	map_handle = nullptr;
+	file_handle = nullptr;
+	size = 0;
+}
+#else
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+	int file = open(filename.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(file, &st) != 0 || st.st_size == 0) //zero length files can't be mapped
+	{
+		close(file);
+		return false;
+	}
+
+	void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (view == MAP_FAILED)
+	{
+		close(file);
+		return false;
+	}
+
+	fd = file;
+	data = (const uint8_t*)view;
+	size = (size_t)st.st_size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data)
+		munmap((void*)data, size);
+	if (fd >= 0)
+		close(fd);
+	data = nullptr;
+	fd = -1;
+	size = 0;
+}
+#endif
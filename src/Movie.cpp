@@ -0,0 +1,305 @@
+#include "Movie.h"
+#include "Checksum.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "Stopwatch.h"
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+//Movie file layout (little endian):
+//    MovieHeader
+//    run_count * MovieRun
+//    sync_count * uint32_t framebuffer CRC
+#pragma pack(push, 1)
+struct MovieHeader {
+	char magic[4];      //"KMOV"
+	uint16_t version;
+	uint8_t mode;
+	uint8_t reserved;
+	uint64_t seed;
+	uint16_t quirks;    //bit packed, see PackQuirks
+	uint8_t rpl[Chip8::RPL_SIZE];
+	char rom_sha1[40];
+	uint32_t frame_count;
+	uint32_t run_count;
+	uint32_t sync_interval;
+	uint32_t sync_count;
+};
+
+//version 1, from before XO-CHIP's 16 flags. still read
+struct MovieHeaderV1 {
+	char magic[4];
+	uint16_t version;
+	uint8_t mode;
+	uint8_t reserved;
+	uint64_t seed;
+	uint16_t quirks;
+	uint8_t rpl[8];
+	char rom_sha1[40];
+	uint32_t frame_count;
+	uint32_t run_count;
+	uint32_t sync_interval;
+	uint32_t sync_count;
+};
+
+struct MovieRun {
+	uint16_t keys;
+	uint16_t prev_keys;
+	uint16_t cycles;
+	uint32_t count;
+};
+#pragma pack(pop)
+
+static const uint16_t MOVIE_VERSION = 2;
+
+static uint16_t PackQuirks(const Chip8::Quirks& quirks)
+{
+	return (quirks.vip_jump << 0) | (quirks.vip_shifts << 1) | (quirks.vip_regs_read_write << 2) | (quirks.logic_flag_reset << 3)
+		| (quirks.draw_wrap << 4) | (quirks.draw_vblank << 5) | (quirks.schip_10_fonts << 6) | (quirks.schip_10_regs_read_write << 7);
+}
+
+static Chip8::Quirks UnpackQuirks(uint16_t bits)
+{
+	Chip8::Quirks quirks;
+	quirks.vip_jump = bits & (1 << 0);
+	quirks.vip_shifts = bits & (1 << 1);
+	quirks.vip_regs_read_write = bits & (1 << 2);
+	quirks.logic_flag_reset = bits & (1 << 3);
+	quirks.draw_wrap = bits & (1 << 4);
+	quirks.draw_vblank = bits & (1 << 5);
+	quirks.schip_10_fonts = bits & (1 << 6);
+	quirks.schip_10_regs_read_write = bits & (1 << 7);
+	return quirks;
+}
+
+static uint32_t VRAMCrc(Chip8* core)
+{
+	return Crc32(core->GetVRAM(), core->res.base_width * core->res.base_height);
+}
+
+void Movie::BootCore(Chip8* core, uint64_t seed, Chip8::SYSTEM_MODE mode, const Chip8::Quirks& quirks)
+{
+	//loads boot with the core's own seed. an unseeded core stays unseeded then, its later resets still draw new seeds
+	bool unseeded = !core->HasSeed() && seed == core->GetSeed();
+	core->SetSeed(seed);
+	core->SetSystemMode(mode); //also resets the core, which reseeds the generator
+	core->quirks = quirks;
+	core->ResetMemory(mode == Chip8::SYSTEM_MODE::SUPER_CHIP);
+	if (unseeded)
+		core->ClearSeed();
+}
+
+void Movie::Boot(Chip8* core, const std::vector<unsigned char>& rom, uint64_t seed, Chip8::SYSTEM_MODE mode, const Chip8::Quirks& quirks, const uint8_t* rpl)
+{
+	BootCore(core, seed, mode, quirks);
+	core->Load(rom);
+	core->SetRPLMem((uint8_t*)rpl);
+}
+
+void Movie::Boot(Chip8* core, const RomImage& rom, uint64_t seed, Chip8::SYSTEM_MODE mode, const Chip8::Quirks& quirks, const uint8_t* rpl)
+{
+	BootCore(core, seed, mode, quirks);
+	core->Load(rom);
+	core->SetRPLMem((uint8_t*)rpl);
+}
+
+void Movie::Begin(Chip8* core, const std::vector<unsigned char>& rom, const std::string& sha1)
+{
+	seed = core->GetSeed();
+	mode = core->GetSystemMode();
+	quirks = core->quirks;
+	memcpy(rpl, core->GetRPLMem(), sizeof(rpl));
+	rom_sha1 = sha1;
+	frame_count = 0;
+	runs.clear();
+	sync_crcs.clear();
+
+	Boot(core, rom, seed, mode, quirks, rpl);
+	LOG_INFO("Recording movie. Seed: {}", seed);
+}
+
+void Movie::RecordFrame(Chip8* core, uint16_t cycles)
+{
+	Input input;
+	input.keys = core->GetKeyMask();
+	input.prev_keys = core->GetPrevKeyMask();
+	input.cycles = cycles;
+
+	if (!runs.empty() && runs.back().input == input)
+		runs.back().count++;
+	else
+		runs.push_back({ input, 1 });
+}
+
+void Movie::EndFrame(Chip8* core)
+{
+	frame_count++;
+	if (frame_count % sync_interval == 0)
+		sync_crcs.push_back(VRAMCrc(core));
+}
+
+bool Movie::Save(const std::string& filename)
+{
+	MovieHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "KMOV", 4);
+	header.version = MOVIE_VERSION;
+	header.mode = (uint8_t)mode;
+	header.seed = seed;
+	header.quirks = PackQuirks(quirks);
+	memcpy(header.rpl, rpl, sizeof(header.rpl));
+	memcpy(header.rom_sha1, rom_sha1.data(), std::min<size_t>(rom_sha1.size(), sizeof(header.rom_sha1)));
+	header.frame_count = frame_count;
+	header.run_count = (uint32_t)runs.size();
+	header.sync_interval = sync_interval;
+	header.sync_count = (uint32_t)sync_crcs.size();
+
+	std::ofstream ofd(filename, std::ios::binary | std::ios::out | std::ios::trunc);
+	if (!ofd.good())
+	{
+		LOG_ERROR("Could not open file to save movie: {}", filename);
+		return false;
+	}
+	ofd.write((char*)&header, sizeof(header));
+	for (Run& run : runs)
+	{
+		MovieRun out = { run.input.keys, run.input.prev_keys, run.input.cycles, run.count };
+		ofd.write((char*)&out, sizeof(out));
+	}
+	ofd.write((char*)sync_crcs.data(), sync_crcs.size() * sizeof(uint32_t));
+	ofd.close();
+	if (!ofd.good())
+	{
+		LOG_ERROR("Failed writing movie: {}", filename);
+		return false;
+	}
+
+	LOG_INFO("Saved movie ({} frames, {} runs): {}", frame_count, runs.size(), filename);
+	return true;
+}
+
+bool Movie::Open(const std::string& filename)
+{
+	MappedFile file;
+	if (!file.Open(filename))
+	{
+		LOG_ERROR("Could not open movie: {}", filename);
+		return false;
+	}
+
+	MovieHeader header;
+	MovieHeaderV1 old;
+	size_t header_size = sizeof(header);
+	if (file.Size() >= sizeof(old) && memcmp(file.Data(), "KMOV", 4) == 0 && file.Data()[4] == 1 && file.Data()[5] == 0)
+	{
+		memcpy(&old, file.Data(), sizeof(old));
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, old.magic, 4);
+		header.version = MOVIE_VERSION;
+		header.mode = old.mode;
+		header.seed = old.seed;
+		header.quirks = old.quirks;
+		memcpy(header.rpl, old.rpl, sizeof(old.rpl));
+		memcpy(header.rom_sha1, old.rom_sha1, sizeof(header.rom_sha1));
+		header.frame_count = old.frame_count;
+		header.run_count = old.run_count;
+		header.sync_interval = old.sync_interval;
+		header.sync_count = old.sync_count;
+		header_size = sizeof(old);
+	}
+	else if (file.Size() < sizeof(header))
+	{
+		LOG_ERROR("Movie is truncated: {}", filename);
+		return false;
+	}
+	else
+		memcpy(&header, file.Data(), sizeof(header));
+	if (memcmp(header.magic, "KMOV", 4) != 0 || header.version != MOVIE_VERSION)
+	{
+		LOG_ERROR("Not a supported KIP-8 movie: {}", filename);
+		return false;
+	}
+	if (file.Size() != header_size + ((size_t)header.run_count * sizeof(MovieRun)) + ((size_t)header.sync_count * sizeof(uint32_t))
+		|| header.mode > Chip8::SYSTEM_MODE::XO_CHIP || header.sync_interval == 0)
+	{
+		LOG_ERROR("Movie is corrupt: {}", filename);
+		return false;
+	}
+
+	seed = header.seed;
+	mode = (Chip8::SYSTEM_MODE)header.mode;
+	quirks = UnpackQuirks(header.quirks);
+	memcpy(rpl, header.rpl, sizeof(rpl));
+	rom_sha1.assign(header.rom_sha1, strnlen(header.rom_sha1, sizeof(header.rom_sha1)));
+	frame_count = header.frame_count;
+	sync_interval = header.sync_interval;
+
+	const uint8_t* in = file.Data() + header_size;
+	runs.resize(header.run_count);
+	uint64_t total_frames = 0;
+	for (Run& run : runs)
+	{
+		MovieRun stored;
+		memcpy(&stored, in, sizeof(stored));
+		in += sizeof(stored);
+		run.input.keys = stored.keys;
+		run.input.prev_keys = stored.prev_keys;
+		run.input.cycles = stored.cycles;
+		run.count = stored.count;
+		total_frames += stored.count;
+	}
+	sync_crcs.resize(header.sync_count);
+	memcpy(sync_crcs.data(), in, header.sync_count * sizeof(uint32_t));
+
+	if (total_frames != frame_count)
+	{
+		LOG_ERROR("Movie frame count does not match its input runs: {}", filename);
+		return false;
+	}
+	return true;
+}
+
+bool Movie::Replay(Chip8* core, const std::vector<unsigned char>& rom, ReplayResult& result)
+{
+	stopwatch::Stopwatch timer;
+	Boot(core, rom, seed, mode, quirks, rpl);
+	bool in_sync = RunInputs(core, result);
+	result.microseconds = timer.elapsed<stopwatch::mus>();
+	return in_sync;
+}
+
+bool Movie::Replay(Chip8* core, const RomImage& rom, ReplayResult& result) const
+{
+	stopwatch::Stopwatch timer;
+	Boot(core, rom, seed, mode, quirks, rpl);
+	bool in_sync = RunInputs(core, result);
+	result.microseconds = timer.elapsed<stopwatch::mus>();
+	return in_sync;
+}
+
+bool Movie::RunInputs(Chip8* core, ReplayResult& result) const
+{
+	result = ReplayResult();
+	size_t sync_index = 0;
+	for (const Run& run : runs)
+	{
+		for (uint32_t it = 0; it < run.count; it++)
+		{
+			core->SetKeyMask(run.input.keys, run.input.prev_keys);
+			core->Run(run.input.cycles);
+			result.cycles += run.input.cycles;
+			result.frames++;
+
+			if (result.frames % sync_interval == 0 && sync_index < sync_crcs.size())
+			{
+				if (VRAMCrc(core) != sync_crcs[sync_index] && result.first_desync_frame < 0)
+					result.first_desync_frame = result.frames;
+				sync_index++;
+			}
+		}
+	}
+
+	result.vram_crc = VRAMCrc(core);
+	return result.first_desync_frame < 0;
+}
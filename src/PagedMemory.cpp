@@ -0,0 +1,104 @@
+#include "PagedMemory.h"
+#include <algorithm>
+#include <cstring>
+
+PageArena::PageArena(size_t pages_per_slab) : slab_pages(std::max<size_t>(1, pages_per_slab))
+{
+}
+
+PageArena::~PageArena()
+{
+	for (MemoryPage* slab : slabs)
+		delete[] slab;
+}
+
+MemoryPage* PageArena::Allocate()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if (!free_list)
+	{
+		MemoryPage* slab = new MemoryPage[slab_pages];
+		slabs.push_back(slab);
+		for (size_t it = 0; it < slab_pages; it++)
+		{
+			slab[it].owner = this;
+			memcpy(slab[it].data, &free_list, sizeof(free_list));
+			free_list = &slab[it];
+		}
+	}
+
+	MemoryPage* page = free_list;
+	memcpy(&free_list, page->data, sizeof(free_list));
+	page->refs.store(1, std::memory_order_relaxed);
+	in_use++;
+	return page;
+}
+
+void PageArena::Free(MemoryPage* page)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	memcpy(page->data, &free_list, sizeof(free_list));
+	free_list = page;
+	in_use--;
+}
+
+size_t PageArena::GetPagesInUse()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return in_use;
+}
+
+size_t PageArena::GetBytesReserved()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return slabs.size() * slab_pages * sizeof(MemoryPage);
+}
+
+PageArena& PageArena::Default()
+{
+	//never destroyed, cores may still release pages during static destruction
+	static PageArena* arena = new PageArena();
+	return *arena;
+}
+
+MemoryPage* PageArena::ZeroPage()
+{
+	static MemoryPage zero_page; //static storage, so data starts zeroed
+	return &zero_page;
+}
+
+MemoryPage* PageArena::AddRef(MemoryPage* page)
+{
+	if (page->owner)
+		page->refs.fetch_add(1, std::memory_order_relaxed);
+	return page;
+}
+
+void PageArena::Release(MemoryPage* page)
+{
+	if (page->owner && page->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		page->owner->Free(page);
+}
+
+RomImage::RomImage(const std::vector<unsigned char>& buffer, PageArena* arena) : size(buffer.size())
+{
+	if (!arena)
+		arena = &PageArena::Default();
+
+	size_t usable = std::min<size_t>(buffer.size(), 0x10000 - LOAD_ADDRESS);
+	size_t full_pages = usable / MemoryPage::SIZE;
+	for (size_t it = 0; it < full_pages; it++)
+	{
+		MemoryPage* page = arena->Allocate();
+		memcpy(page->data, buffer.data() + (it * MemoryPage::SIZE), MemoryPage::SIZE);
+		page->hash = page->ComputeHash();
+		pages.push_back(page);
+	}
+	tail.assign(buffer.begin() + (full_pages * MemoryPage::SIZE), buffer.begin() + usable);
+}
+
+RomImage::~RomImage()
+{
+	for (MemoryPage* page : pages)
+		PageArena::Release(page);
+}
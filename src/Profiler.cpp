@@ -0,0 +1,364 @@
+#include "Profiler.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+struct OpcodeClass {
+	uint16_t mask;
+	uint16_t value;
+	const char* name;
+};
+
+//first match wins, so the specific 0x00XX forms come before 0NNN
+static const OpcodeClass opcode_classes[] = {
+	{ 0xFFFF, 0x00E0, "00E0 CLS" },
+	{ 0xFFFF, 0x00EE, "00EE RET" },
+	{ 0xFFF0, 0x00C0, "00CN SCD" },
+	{ 0xFFF0, 0x00D0, "00DN SCU" },
+	{ 0xFFFF, 0x00FB, "00FB SCR" },
+	{ 0xFFFF, 0x00FC, "00FC SCL" },
+	{ 0xFFFF, 0x00FD, "00FD EXIT" },
+	{ 0xFFFF, 0x00FE, "00FE LOW" },
+	{ 0xFFFF, 0x00FF, "00FF HIGH" },
+	{ 0xF000, 0x0000, "0NNN SYS" },
+	{ 0xF000, 0x1000, "1NNN JP" },
+	{ 0xF000, 0x2000, "2NNN CALL" },
+	{ 0xF000, 0x3000, "3XNN SE" },
+	{ 0xF000, 0x4000, "4XNN SNE" },
+	{ 0xF00F, 0x5000, "5XY0 SE" },
+	{ 0xF00F, 0x5002, "5XY2 SAVE" },
+	{ 0xF00F, 0x5003, "5XY3 LOAD" },
+	{ 0xF000, 0x6000, "6XNN LD" },
+	{ 0xF000, 0x7000, "7XNN ADD" },
+	{ 0xF00F, 0x8000, "8XY0 LD" },
+	{ 0xF00F, 0x8001, "8XY1 OR" },
+	{ 0xF00F, 0x8002, "8XY2 AND" },
+	{ 0xF00F, 0x8003, "8XY3 XOR" },
+	{ 0xF00F, 0x8004, "8XY4 ADD" },
+	{ 0xF00F, 0x8005, "8XY5 SUB" },
+	{ 0xF00F, 0x8006, "8XY6 SHR" },
+	{ 0xF00F, 0x8007, "8XY7 SUBN" },
+	{ 0xF00F, 0x800E, "8XYE SHL" },
+	{ 0xF00F, 0x9000, "9XY0 SNE" },
+	{ 0xF000, 0xA000, "ANNN LD I" },
+	{ 0xF000, 0xB000, "BNNN JP V0" },
+	{ 0xF000, 0xC000, "CXNN RND" },
+	{ 0xF000, 0xD000, "DXYN DRW" },
+	{ 0xF0FF, 0xE09E, "EX9E SKP" },
+	{ 0xF0FF, 0xE0A1, "EXA1 SKNP" },
+	{ 0xFFFF, 0xF000, "F000 LD I LONG" },
+	{ 0xF0FF, 0xF001, "FX01 PLANE" },
+	{ 0xFFFF, 0xF002, "F002 AUDIO" },
+	{ 0xF0FF, 0xF007, "FX07 LD DT" },
+	{ 0xF0FF, 0xF00A, "FX0A LD K" },
+	{ 0xF0FF, 0xF015, "FX15 DT" },
+	{ 0xF0FF, 0xF018, "FX18 ST" },
+	{ 0xF0FF, 0xF01E, "FX1E ADD I" },
+	{ 0xF0FF, 0xF029, "FX29 FONT" },
+	{ 0xF0FF, 0xF030, "FX30 BIGFONT" },
+	{ 0xF0FF, 0xF033, "FX33 BCD" },
+	{ 0xF0FF, 0xF03A, "FX3A PITCH" },
+	{ 0xF0FF, 0xF055, "FX55 SAVE" },
+	{ 0xF0FF, 0xF065, "FX65 LOAD" },
+	{ 0xF0FF, 0xF075, "FX75 SAVEFLAGS" },
+	{ 0xF0FF, 0xF085, "FX85 LOADFLAGS" },
+};
+static const size_t INVALID_CLASS = sizeof(opcode_classes) / sizeof(opcode_classes[0]);
+
+static const uint8_t* ClassTable()
+{
+	static const std::vector<uint8_t> table = []() {
+		std::vector<uint8_t> result(Profiler::ADDRESSES, (uint8_t)INVALID_CLASS);
+		for (size_t opcode = 0; opcode < Profiler::ADDRESSES; opcode++)
+		{
+			for (size_t index = 0; index < INVALID_CLASS; index++)
+			{
+				if ((opcode & opcode_classes[index].mask) == opcode_classes[index].value)
+				{
+					result[opcode] = (uint8_t)index;
+					break;
+				}
+			}
+		}
+		return result;
+	}();
+	return table.data();
+}
+
+Profiler::Profiler() : class_of(ClassTable()), executed(ADDRESSES), reads(ADDRESSES), writes(ADDRESSES), classes(ClassCount()),
+	routine_frame(ADDRESSES), routine_max_frame(ADDRESSES)
+{
+	nodes.push_back({ TOP_LEVEL, 0 });
+}
+
+void Profiler::Clear()
+{
+	std::fill(executed.begin(), executed.end(), 0);
+	std::fill(reads.begin(), reads.end(), 0);
+	std::fill(writes.begin(), writes.end(), 0);
+	std::fill(classes.begin(), classes.end(), 0);
+	std::fill(routine_max_frame.begin(), routine_max_frame.end(), 0);
+	instructions = 0;
+	//the tree stays, the program may be inside any of its nodes
+	for (CallNode& node : nodes)
+		node.self = node.calls = node.frame = 0;
+	frame_nodes.clear();
+}
+
+void Profiler::Call(uint16_t target)
+{
+	uint64_t key = ((uint64_t)current << 16) | target;
+	auto found = children.find(key);
+	uint32_t node;
+	if (found != children.end())
+		node = found->second;
+	else
+	{
+		node = (uint32_t)nodes.size();
+		nodes.push_back({ target, current });
+		children.emplace(key, node);
+	}
+	nodes[node].calls++;
+	call_stack.push_back(current);
+	current = node;
+}
+
+void Profiler::Return()
+{
+	if (call_stack.empty())
+		return; //the core faults on this, nothing to unwind
+	current = call_stack.back();
+	call_stack.pop_back();
+}
+
+//charges each node's instructions this frame to every routine on its path, once per routine so recursion isn't
+//counted twice, and keeps the highest total each routine reached
+void Profiler::EndFrame()
+{
+	if (frame_nodes.empty())
+		return;
+	std::vector<uint16_t> routines;
+	for (uint32_t index : frame_nodes)
+	{
+		uint64_t count = nodes[index].frame;
+		nodes[index].frame = 0;
+		size_t path_start = routines.size();
+		for (uint32_t it = index;; it = nodes[it].parent)
+		{
+			uint16_t routine = nodes[it].routine;
+			if (std::find(routines.begin() + path_start, routines.end(), routine) == routines.end())
+				routines.push_back(routine);
+			if (it == 0)
+				break;
+		}
+		for (size_t it = path_start; it < routines.size(); it++)
+			routine_frame[routines[it]] += count;
+	}
+	for (uint16_t routine : routines)
+	{
+		routine_max_frame[routine] = std::max(routine_max_frame[routine], routine_frame[routine]);
+		routine_frame[routine] = 0;
+	}
+	frame_nodes.clear();
+}
+
+std::vector<Profiler::Routine> Profiler::GetRoutines() const
+{
+	std::unordered_map<uint16_t, Routine> routines;
+	std::vector<uint16_t> path;
+	for (uint32_t index = 0; index < nodes.size(); index++)
+	{
+		const CallNode& node = nodes[index];
+		Routine& routine = routines[node.routine];
+		routine.address = node.routine;
+		routine.calls += node.calls;
+		routine.self += node.self;
+		if (!node.self)
+			continue;
+		path.clear();
+		for (uint32_t it = index;; it = nodes[it].parent)
+		{
+			if (std::find(path.begin(), path.end(), nodes[it].routine) == path.end())
+			{
+				path.push_back(nodes[it].routine);
+				routines[nodes[it].routine].total += node.self;
+			}
+			if (it == 0)
+				break;
+		}
+	}
+
+	std::vector<Routine> result;
+	for (auto& entry : routines)
+	{
+		if (!entry.second.calls && !entry.second.total)
+			continue;
+		entry.second.max_frame = routine_max_frame[entry.first];
+		result.push_back(entry.second);
+	}
+	return result;
+}
+
+bool Profiler::LoadSymbols(const std::string& filename)
+{
+	symbols.clear();
+	std::ifstream ifd(filename);
+	if (!ifd.good())
+		return false;
+	std::string line;
+	while (std::getline(ifd, line))
+	{
+		line = line.substr(0, line.find('#'));
+		for (char& c : line)
+			if (c == ':' || c == '=' || c == ',' || c == '\t' || c == '\r')
+				c = ' ';
+		std::string name = "";
+		long address = -1;
+		size_t start = 0;
+		while ((start = line.find_first_not_of(' ', start)) != std::string::npos)
+		{
+			size_t end = line.find(' ', start);
+			std::string token = line.substr(start, end == std::string::npos ? std::string::npos : end - start);
+			start = end;
+			char* parsed_end = nullptr;
+			long value = strtol(token.c_str(), &parsed_end, 0);
+			if (*parsed_end == '\0' && address < 0)
+				address = value;
+			else if (name == "")
+				name = token;
+		}
+		//the first label for an address names it
+		if (name != "" && address >= 0 && address < (long)ADDRESSES)
+			symbols.emplace((uint16_t)address, name);
+	}
+	LOG_INFO("Loaded {} symbols from {}", symbols.size(), filename);
+	return true;
+}
+
+bool Profiler::LoadSymbolsFor(const std::string& rom_file)
+{
+	if (LoadSymbols(rom_file + ".sym"))
+		return true;
+	size_t dot = rom_file.find_last_of('.');
+	size_t slash = rom_file.find_last_of("/\\");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		return LoadSymbols(rom_file.substr(0, dot) + ".sym");
+	return false;
+}
+
+std::string Profiler::RoutineName(uint16_t address) const
+{
+	if (address == TOP_LEVEL)
+		return "(top)";
+	auto found = symbols.find(address);
+	if (found != symbols.end())
+		return found->second;
+	char name[16];
+	snprintf(name, sizeof(name), "sub_%04X", address);
+	return name;
+}
+
+bool Profiler::ExportFolded(const std::string& filename) const
+{
+	std::ofstream ofd(filename, std::ios::out | std::ios::trunc);
+	if (!ofd.good())
+	{
+		LOG_ERROR("Could not write folded stacks: {}", filename);
+		return false;
+	}
+	//every node's path is its parent's plus one name, and parents always come first
+	std::vector<std::string> paths(nodes.size());
+	size_t stacks = 0;
+	for (uint32_t index = 0; index < nodes.size(); index++)
+	{
+		const CallNode& node = nodes[index];
+		paths[index] = index == 0 ? RoutineName(node.routine) : paths[node.parent] + ";" + RoutineName(node.routine);
+		if (!node.self)
+			continue;
+		ofd << paths[index] << " " << node.self << "\n";
+		stacks++;
+	}
+	ofd.close();
+	if (!ofd.good())
+	{
+		LOG_ERROR("Failed writing folded stacks: {}", filename);
+		return false;
+	}
+	LOG_INFO("Wrote {} call stacks to {}", stacks, filename);
+	return true;
+}
+
+size_t Profiler::ClassCount()
+{
+	return INVALID_CLASS + 1;
+}
+
+const char* Profiler::ClassName(size_t index)
+{
+	return index < INVALID_CLASS ? opcode_classes[index].name : "invalid";
+}
+
+size_t Profiler::ClassOf(uint16_t opcode)
+{
+	return ClassTable()[opcode];
+}
+
+bool Profiler::ExportLcov(const std::string& tracefile, const std::string& listing, const std::vector<uint8_t>& rom, const std::string& test_name) const
+{
+	std::ofstream list(listing, std::ios::out | std::ios::trunc);
+	if (!list.good())
+	{
+		LOG_ERROR("Could not write rom listing: {}", listing);
+		return false;
+	}
+	std::ofstream trace(tracefile, std::ios::out | std::ios::trunc);
+	if (!trace.good())
+	{
+		LOG_ERROR("Could not write coverage tracefile: {}", tracefile);
+		return false;
+	}
+
+	//lcov test names only allow word characters
+	std::string name = test_name;
+	for (char& c : name)
+		if (!isalnum((unsigned char)c) && c != '_')
+			c = '_';
+	trace << "TN:" << name << "\n";
+	trace << "SF:" << listing << "\n";
+
+	size_t lines = (rom.size() + 1) / 2;
+	size_t hit = 0;
+	char text[64];
+	for (size_t line = 0; line < lines; line++)
+	{
+		uint32_t addr = 0x200 + (uint32_t)line * 2;
+		uint16_t word = (uint16_t)(rom[line * 2] << 8);
+		if (line * 2 + 1 < rom.size())
+			word |= rom[line * 2 + 1];
+		snprintf(text, sizeof(text), "%04X  %04X  %s\n", addr, word, ClassName(ClassOf(word)));
+		list << text;
+
+		uint64_t count = addr < ADDRESSES ? executed[addr] : 0;
+		if (addr + 1 < ADDRESSES)
+			count += executed[addr + 1];
+		trace << "DA:" << line + 1 << "," << count << "\n";
+		if (count)
+			hit++;
+	}
+	trace << "LH:" << hit << "\n";
+	trace << "LF:" << lines << "\n";
+	trace << "end_of_record\n";
+
+	list.close();
+	trace.close();
+	if (!list.good() || !trace.good())
+	{
+		LOG_ERROR("Failed writing coverage to {}", tracefile);
+		return false;
+	}
+	LOG_INFO("Wrote coverage of {} of {} rom words to {}", hit, lines, tracefile);
+	return true;
+}
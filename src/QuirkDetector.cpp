@@ -0,0 +1,227 @@
+#include "QuirkDetector.h"
+#include "Logger.h"
+#include "Movie.h"
+#include <algorithm>
+#include <fstream>
+
+QuirkDetector::QuirkDetector(unsigned int threads) : thread_count(threads)
+{
+	if (thread_count == 0)
+	{
+		unsigned int hardware = std::thread::hardware_concurrency();
+		thread_count = hardware > 1 ? hardware - 1 : 1;
+	}
+}
+
+QuirkDetector::~QuirkDetector()
+{
+	Cancel();
+	pool.reset(); //finishes the cancelled tasks before their arenas go away
+}
+
+bool QuirkDetector::LoadCache(const std::string& filename)
+{
+	cache_file = filename;
+	std::ifstream ifd(filename);
+	if (!ifd.good())
+	{
+		LOG_INFO("No detected quirks cache at {}", filename);
+		return false;
+	}
+
+	Json::CharReaderBuilder builder;
+	std::string errors;
+	if (!Json::parseFromStream(builder, ifd, &cache, &errors) || !cache.isObject())
+	{
+		LOG_ERROR("Could not parse detected quirks cache {}: {}", filename, errors);
+		cache = Json::Value(Json::objectValue);
+		return false;
+	}
+	LOG_INFO("Loaded {} detected quirk configs from {}", cache.size(), filename);
+	return true;
+}
+
+bool QuirkDetector::SaveCache()
+{
+	if (cache_file == "")
+		return false;
+	std::ofstream ofd(cache_file);
+	if (!ofd.good())
+	{
+		LOG_ERROR("Could not write detected quirks cache: {}", cache_file);
+		return false;
+	}
+	Json::StreamWriterBuilder writer;
+	ofd << Json::writeString(writer, cache);
+	return true;
+}
+
+bool QuirkDetector::Lookup(const std::string& sha1, Chip8::Quirks& quirks)
+{
+	if (!cache.isMember(sha1))
+		return false;
+	const Json::Value& entry = cache[sha1];
+	quirks.vip_shifts = entry.get("vip_shifts", quirks.vip_shifts).asBool();
+	quirks.vip_regs_read_write = entry.get("vip_regs_read_write", quirks.vip_regs_read_write).asBool();
+	quirks.vip_jump = entry.get("vip_jump", quirks.vip_jump).asBool();
+	quirks.logic_flag_reset = entry.get("logic_flag_reset", quirks.logic_flag_reset).asBool();
+	quirks.draw_wrap = entry.get("draw_wrap", quirks.draw_wrap).asBool();
+	quirks.draw_vblank = entry.get("draw_vblank", quirks.draw_vblank).asBool();
+	return true;
+}
+
+Chip8::Quirks QuirkDetector::Combination(const Chip8::Quirks& base, int index)
+{
+	Chip8::Quirks quirks = base;
+	quirks.vip_shifts = (index & 0x01) != 0;
+	quirks.vip_regs_read_write = (index & 0x02) != 0;
+	quirks.vip_jump = (index & 0x04) != 0;
+	quirks.logic_flag_reset = (index & 0x08) != 0;
+	quirks.draw_wrap = (index & 0x10) != 0;
+	quirks.draw_vblank = (index & 0x20) != 0;
+	return quirks;
+}
+
+int QuirkDetector::Index(const Chip8::Quirks& quirks)
+{
+	return (quirks.vip_shifts ? 0x01 : 0) | (quirks.vip_regs_read_write ? 0x02 : 0) | (quirks.vip_jump ? 0x04 : 0)
+		| (quirks.logic_flag_reset ? 0x08 : 0) | (quirks.draw_wrap ? 0x10 : 0) | (quirks.draw_vblank ? 0x20 : 0);
+}
+
+uint16_t QuirkDetector::ScriptedKeys(uint32_t frame)
+{
+	//tap each key in turn for 10 frames out of every 30, enough to get past title screens and FX0A waits
+	uint32_t period = frame / 30;
+	if (frame % 30 >= 10)
+		return 0;
+	return (uint16_t)(1 << (period % 16));
+}
+
+void QuirkDetector::StartPool()
+{
+	if (pool)
+		return;
+	for (unsigned int it = 0; it < thread_count; it++)
+		arenas.push_back(std::make_unique<PageArena>());
+	quiet_logger = Logger::CreateWorkerLogger("Quirk detector", "", spdlog::level::off);
+	pool = std::make_unique<ThreadPool>(thread_count);
+}
+
+void QuirkDetector::Start(const std::vector<unsigned char>& rom, const std::string& sha1, Chip8::SYSTEM_MODE mode, const Chip8::Quirks& base, uint16_t cycles)
+{
+	Cancel();
+	StartPool();
+
+	job = std::make_shared<Job>();
+	job->rom = std::make_unique<RomImage>(rom);
+	job->sha1 = sha1;
+	job->mode = mode;
+	job->base = base;
+	job->cycles = cycles;
+	job->scores.resize(COMBINATIONS);
+	LOG_INFO("Detecting quirks for {} on {} threads", sha1, pool->GetThreadCount());
+
+	for (int index = 0; index < COMBINATIONS; index++)
+	{
+		//each task holds the job so a cancelled detection can finish in the background after a new one starts
+		std::shared_ptr<Job> current = job;
+		pool->Submit([this, current, index] {
+			int worker = ThreadPool::CurrentWorker();
+			RunCombination(*current, index, arenas[worker].get(), quiet_logger);
+			current->remaining.fetch_sub(1, std::memory_order_release);
+		});
+	}
+}
+
+void QuirkDetector::Cancel()
+{
+	if (job)
+		job->cancel.store(true, std::memory_order_relaxed);
+	job = nullptr;
+}
+
+void QuirkDetector::RunCombination(Job& job, int index, PageArena* arena, std::shared_ptr<spdlog::logger> logger)
+{
+	Score& score = job.scores[index];
+	score.quirks = Combination(job.base, index);
+	int differs = index ^ Index(job.base);
+	for (int bit = 0; bit < 6; bit++)
+		score.distance += (differs >> bit) & 1;
+
+	Chip8 core(arena, logger);
+	uint8_t rpl[Chip8::RPL_SIZE] = { 0 };
+	Movie::Boot(&core, *job.rom, 0, job.mode, score.quirks, rpl);
+
+	uint16_t prev_keys = 0;
+	for (uint32_t frame = 0; frame < FRAMES; frame++)
+	{
+		if (job.cancel.load(std::memory_order_relaxed))
+			return;
+		uint16_t keys = ScriptedKeys(frame);
+		core.SetKeyMask(keys, prev_keys);
+		prev_keys = keys;
+		core.Run(job.cycles);
+		score.frames = frame + 1;
+		if (core.GetHalted())
+		{
+			score.halted = true;
+			break;
+		}
+	}
+
+	//halting early is the worst outcome, then anything that would have crashed on real hardware. faults count per
+	//instruction executed, or configs that run fewer instructions (vblank waits) would look better for it
+	score.faults = core.GetFaults();
+	if (score.halted)
+		score.penalty += 1000000000 + (uint64_t)(FRAMES - score.frames) * 1000000;
+	uint64_t weighted = (uint64_t)score.faults.invalid_opcodes * 2 + (uint64_t)score.faults.stack_errors * 2
+		+ score.faults.memory_errors + score.faults.sprite_errors;
+	score.penalty += weighted * 1000000 / std::max<uint64_t>(1, core.GetTotalCycles());
+}
+
+void QuirkDetector::Pick(Job& job, Result& result)
+{
+	result.sha1 = job.sha1;
+	result.scores = job.scores;
+
+	const Score* best = &job.scores[0];
+	uint64_t worst = 0;
+	for (const Score& score : job.scores)
+	{
+		worst = std::max(worst, score.penalty);
+		if (score.penalty < best->penalty || (score.penalty == best->penalty && score.distance < best->distance))
+			best = &score;
+	}
+	result.quirks = best->quirks;
+	result.conclusive = best->penalty < worst;
+}
+
+bool QuirkDetector::Poll(Result& result)
+{
+	if (!job || job->remaining.load(std::memory_order_acquire) != 0)
+		return false;
+
+	Pick(*job, result);
+	job = nullptr;
+
+	if (!result.conclusive)
+	{
+		//not cached, so the rom is tried again next time instead of being stuck with the defaults
+		LOG_INFO("Quirk detection for {} was inconclusive, keeping the default quirks", result.sha1);
+		return true;
+	}
+
+	Json::Value entry;
+	entry["vip_shifts"] = result.quirks.vip_shifts;
+	entry["vip_regs_read_write"] = result.quirks.vip_regs_read_write;
+	entry["vip_jump"] = result.quirks.vip_jump;
+	entry["logic_flag_reset"] = result.quirks.logic_flag_reset;
+	entry["draw_wrap"] = result.quirks.draw_wrap;
+	entry["draw_vblank"] = result.quirks.draw_vblank;
+	cache[result.sha1] = entry;
+	SaveCache();
+
+	LOG_INFO("Detected quirks for {}: shifts {}, load/store {}, jump {}, logic {}, wrap {}, vblank {}", result.sha1, result.quirks.vip_shifts, result.quirks.vip_regs_read_write,
+		result.quirks.vip_jump, result.quirks.logic_flag_reset, result.quirks.draw_wrap, result.quirks.draw_vblank);
+	return true;
+}
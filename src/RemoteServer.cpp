@@ -0,0 +1,527 @@
+#include "RemoteServer.h"
+#include "Logger.h"
+#include "Movie.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+typedef SOCKET socket_t;
+#define CLOSE_SOCKET closesocket
+#define SHUTDOWN_BOTH SD_BOTH
+#define SEND_FLAGS 0
+#else
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+typedef int socket_t;
+#define CLOSE_SOCKET close
+#define SHUTDOWN_BOTH SHUT_RDWR
+#define SEND_FLAGS MSG_NOSIGNAL //a client going away is not worth a SIGPIPE
+#endif
+
+static const uint16_t MAX_ROM_SIZE = 0x10000 - 0x200;
+static const size_t DELTA_GAP = 4; //unchanged bytes worth bridging instead of starting a new run, a run header is 4 bytes
+
+static bool InitSockets()
+{
+#ifdef _WIN32
+	static bool started = false;
+	if (!started)
+	{
+		WSADATA data;
+		if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+		{
+			LOG_ERROR("WSAStartup failed");
+			return false;
+		}
+		started = true;
+	}
+#endif
+	return true;
+}
+
+static bool MakeAddress(const std::string& path, sockaddr_un& addr)
+{
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path))
+	{
+		LOG_ERROR("Socket path is too long: {}", path);
+		return false;
+	}
+	memcpy(addr.sun_path, path.c_str(), path.size());
+	return true;
+}
+
+static long Receive(intptr_t s, uint8_t* buffer, size_t len)
+{
+	while (true)
+	{
+		long count = (long)recv((socket_t)s, (char*)buffer, (int)len, 0);
+#ifndef _WIN32
+		if (count < 0 && errno == EINTR)
+			continue;
+#endif
+		return count;
+	}
+}
+
+static bool SendAll(intptr_t s, const uint8_t* buffer, size_t len)
+{
+	while (len)
+	{
+		long count = (long)send((socket_t)s, (const char*)buffer, (int)len, SEND_FLAGS);
+		if (count <= 0)
+		{
+#ifndef _WIN32
+			if (count < 0 && errno == EINTR)
+				continue;
+#endif
+			return false;
+		}
+		buffer += count;
+		len -= count;
+	}
+	return true;
+}
+
+static uint16_t Get16(const uint8_t* in) { return (uint16_t)(in[0] | in[1] << 8); }
+static uint32_t Get32(const uint8_t* in) { return (uint32_t)Get16(in) | (uint32_t)Get16(in + 2) << 16; }
+static uint64_t Get64(const uint8_t* in) { return (uint64_t)Get32(in) | (uint64_t)Get32(in + 4) << 32; }
+
+static void Set32(uint8_t* out, uint32_t val)
+{
+	for (int it = 0; it < 4; it++)
+		out[it] = (uint8_t)(val >> (it * 8));
+}
+
+void RemoteClient::Put16(std::vector<uint8_t>& out, uint16_t val)
+{
+	out.push_back((uint8_t)val);
+	out.push_back((uint8_t)(val >> 8));
+}
+
+void RemoteClient::Put32(std::vector<uint8_t>& out, uint32_t val)
+{
+	Put16(out, (uint16_t)val);
+	Put16(out, (uint16_t)(val >> 16));
+}
+
+void RemoteClient::Put64(std::vector<uint8_t>& out, uint64_t val)
+{
+	Put32(out, (uint32_t)val);
+	Put32(out, (uint32_t)(val >> 32));
+}
+
+RemoteServer::Session::Session() : core(&arena)
+{
+}
+
+void RemoteServer::Session::Handle(const uint8_t* body, size_t size, std::vector<uint8_t>& reply)
+{
+	auto start = std::chrono::steady_clock::now();
+	const uint8_t* at = body;
+	const uint8_t* end = body + size;
+	while (at < end)
+	{
+		uint8_t opcode = *at++;
+		reply.push_back(opcode);
+		size_t status_at = reply.size();
+		reply.push_back(KIP8_RC_OK);
+		uint8_t status = Execute(opcode, at, end, reply);
+		stats.commands++;
+		if (status != KIP8_RC_OK)
+		{
+			reply[status_at] = status;
+			//can't find the next command without knowing how long this one was
+			if (status == KIP8_RC_BAD_ARGUMENTS || status == KIP8_RC_UNKNOWN_COMMAND)
+				break;
+		}
+	}
+	stats.messages++;
+	stats.microseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint8_t RemoteServer::Session::Execute(uint8_t opcode, const uint8_t*& at, const uint8_t* end, std::vector<uint8_t>& reply)
+{
+	size_t left = end - at;
+	switch (opcode)
+	{
+	case KIP8_RC_PING:
+		return KIP8_RC_OK;
+
+	case KIP8_RC_LOAD:
+	{
+		if (left < 5)
+			return KIP8_RC_BAD_ARGUMENTS;
+		uint8_t mode = at[0];
+		uint32_t rom_size = Get32(at + 1);
+		if (mode > Chip8::SYSTEM_MODE::XO_CHIP || rom_size == 0 || rom_size > MAX_ROM_SIZE || left - 5 < rom_size)
+			return KIP8_RC_BAD_ARGUMENTS;
+		std::vector<unsigned char> rom(at + 5, at + 5 + rom_size);
+		at += 5 + rom_size;
+
+		uint8_t rpl[Chip8::RPL_SIZE];
+		memcpy(rpl, core.GetRPLMem(), sizeof(rpl));
+		Movie::Boot(&core, rom, seed, (Chip8::SYSTEM_MODE)mode, core.quirks, rpl);
+		loaded = true;
+		last_frame.clear();
+		return KIP8_RC_OK;
+	}
+
+	case KIP8_RC_SET_QUIRKS:
+	{
+		if (left < 3)
+			return KIP8_RC_BAD_ARGUMENTS;
+		uint8_t bits = at[0];
+		cycles = Get16(at + 1);
+		at += 3;
+		Chip8::Quirks& quirks = core.quirks;
+		quirks.vip_jump = (bits & KIP8_RC_QUIRK_VIP_JUMP) != 0;
+		quirks.vip_shifts = (bits & KIP8_RC_QUIRK_VIP_SHIFTS) != 0;
+		quirks.vip_regs_read_write = (bits & KIP8_RC_QUIRK_VIP_REGS_READ_WRITE) != 0;
+		quirks.logic_flag_reset = (bits & KIP8_RC_QUIRK_LOGIC_FLAG_RESET) != 0;
+		quirks.draw_wrap = (bits & KIP8_RC_QUIRK_DRAW_WRAP) != 0;
+		quirks.draw_vblank = (bits & KIP8_RC_QUIRK_DRAW_VBLANK) != 0;
+		quirks.schip_10_fonts = (bits & KIP8_RC_QUIRK_SCHIP_10_FONTS) != 0;
+		quirks.schip_10_regs_read_write = (bits & KIP8_RC_QUIRK_SCHIP_10_REGS_READ_WRITE) != 0;
+		return KIP8_RC_OK;
+	}
+
+	case KIP8_RC_SET_SEED:
+		if (left < 8)
+			return KIP8_RC_BAD_ARGUMENTS;
+		seed = Get64(at);
+		at += 8;
+		return KIP8_RC_OK;
+
+	case KIP8_RC_STEP:
+	{
+		if (left < 4)
+			return KIP8_RC_BAD_ARGUMENTS;
+		uint16_t frames = Get16(at);
+		uint16_t count = Get16(at + 2);
+		if (left - 4 < (size_t)count * 2)
+			return KIP8_RC_BAD_ARGUMENTS;
+		const uint8_t* keys = at + 4;
+		at += 4 + (size_t)count * 2;
+		if (!loaded)
+			return KIP8_RC_NO_ROM;
+
+		uint16_t run = 0;
+		while (run < frames && !core.GetHalted())
+		{
+			if (count)
+				core.SetKeyMask(Get16(keys + std::min<size_t>(run, count - 1) * 2), core.GetKeyMask());
+			core.Run(cycles);
+			run++;
+		}
+		RemoteClient::Put8(reply, core.GetHalted() ? 1 : 0);
+		RemoteClient::Put16(reply, run);
+		RemoteClient::Put64(reply, core.GetTotalCycles());
+		return KIP8_RC_OK;
+	}
+
+	case KIP8_RC_FRAME_DELTA:
+		if (!loaded)
+			return KIP8_RC_NO_ROM;
+		WriteFrameDelta(reply);
+		return KIP8_RC_OK;
+
+	case KIP8_RC_READ_RAM:
+	{
+		if (left < 4)
+			return KIP8_RC_BAD_ARGUMENTS;
+		uint16_t addr = Get16(at);
+		uint16_t len = (uint16_t)std::min<size_t>(Get16(at + 2), 0x10000 - addr);
+		at += 4;
+		RemoteClient::Put16(reply, len);
+		size_t offset = reply.size();
+		reply.resize(offset + len);
+		core.CopyRAM(addr, reply.data() + offset, len);
+		return KIP8_RC_OK;
+	}
+
+	case KIP8_RC_WRITE_RAM:
+	{
+		if (left < 4)
+			return KIP8_RC_BAD_ARGUMENTS;
+		uint16_t addr = Get16(at);
+		uint16_t len = Get16(at + 2);
+		if (left - 4 < len)
+			return KIP8_RC_BAD_ARGUMENTS;
+		core.SetRAM(addr, at + 4, std::min<size_t>(len, 0x10000 - addr));
+		at += 4 + len;
+		return KIP8_RC_OK;
+	}
+
+	case KIP8_RC_GET_STATE:
+		for (uint8_t it = 0; it < 16; it++)
+			RemoteClient::Put8(reply, *core.GetRegV(it));
+		RemoteClient::Put16(reply, *core.GetRegI());
+		RemoteClient::Put16(reply, *core.GetPC());
+		RemoteClient::Put8(reply, (uint8_t)*core.GetSP());
+		RemoteClient::Put8(reply, core.GetDelayTimer());
+		RemoteClient::Put8(reply, core.GetSoundTimer());
+		RemoteClient::Put64(reply, core.GetStateHash());
+		return KIP8_RC_OK;
+
+	default:
+		return KIP8_RC_UNKNOWN_COMMAND;
+	}
+}
+
+void RemoteServer::Session::WriteFrameDelta(std::vector<uint8_t>& reply)
+{
+	const uint8_t width = core.res.base_width;
+	const uint8_t height = core.res.base_height;
+	const uint8_t* frame = core.GetVRAM();
+	const size_t size = (size_t)width * height;
+	RemoteClient::Put8(reply, width);
+	RemoteClient::Put8(reply, height);
+	size_t runs_at = reply.size();
+	RemoteClient::Put16(reply, 0);
+
+	uint16_t runs = 0;
+	auto emit = [&](size_t offset, size_t length) {
+		RemoteClient::Put16(reply, (uint16_t)offset);
+		RemoteClient::Put16(reply, (uint16_t)length);
+		reply.insert(reply.end(), frame + offset, frame + offset + length);
+		runs++;
+	};
+
+	if (last_frame.size() != size || width != last_width || height != last_height)
+	{
+		emit(0, size);
+		last_frame.assign(frame, frame + size);
+		last_width = width;
+		last_height = height;
+	}
+	else
+	{
+		const uint8_t* last = last_frame.data();
+		size_t it = 0;
+		while (it < size)
+		{
+			//most frames change a handful of bytes, skip the rest eight at a time
+			while (it + 8 <= size && memcmp(frame + it, last + it, 8) == 0)
+				it += 8;
+			while (it < size && frame[it] == last[it])
+				it++;
+			if (it >= size)
+				break;
+
+			size_t start = it;
+			size_t stop = it + 1; //one past the last changed byte
+			for (size_t scan = stop; scan < size && scan - stop < DELTA_GAP; scan++)
+			{
+				if (frame[scan] != last[scan])
+					stop = scan + 1;
+			}
+			emit(start, stop - start);
+			it = stop;
+		}
+		memcpy(last_frame.data(), frame, size);
+	}
+	reply[runs_at] = (uint8_t)runs;
+	reply[runs_at + 1] = (uint8_t)(runs >> 8);
+}
+
+RemoteServer::~RemoteServer()
+{
+	Stop();
+	std::unique_lock<std::mutex> lock(clients_lock);
+	clients_done.wait(lock, [this] { return clients.empty(); });
+	lock.unlock();
+	if (listener != -1)
+	{
+		CLOSE_SOCKET((socket_t)listener);
+		std::remove(socket_path.c_str());
+	}
+}
+
+bool RemoteServer::Listen(const std::string& path)
+{
+	sockaddr_un addr;
+	if (!InitSockets() || !MakeAddress(path, addr))
+		return false;
+
+	socket_t s = socket(AF_UNIX, SOCK_STREAM, 0);
+	if ((intptr_t)s == -1)
+	{
+		LOG_ERROR("Could not create a socket for {}", path);
+		return false;
+	}
+	std::remove(path.c_str());
+	if (bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, 16) != 0)
+	{
+		LOG_ERROR("Could not listen on {}", path);
+		CLOSE_SOCKET(s);
+		return false;
+	}
+	socket_path = path;
+	listener = (intptr_t)s;
+	LOG_INFO("Listening on {}", path);
+	return true;
+}
+
+void RemoteServer::Serve()
+{
+	while (!stopping.load(std::memory_order_relaxed))
+	{
+		socket_t s = accept((socket_t)listener, nullptr, nullptr);
+		if ((intptr_t)s == -1)
+		{
+#ifndef _WIN32
+			if (errno == EINTR)
+				continue;
+#endif
+			if (!stopping.load(std::memory_order_relaxed))
+				LOG_ERROR("Could not accept a client on {}", socket_path);
+			break;
+		}
+
+		std::lock_guard<std::mutex> lock(clients_lock);
+		if (stopping.load(std::memory_order_relaxed))
+		{
+			CLOSE_SOCKET(s);
+			break;
+		}
+		clients.push_back((intptr_t)s);
+		//detached so finished clients don't pile up, the destructor waits for clients to empty instead
+		std::thread(&RemoteServer::ServeClient, this, (intptr_t)s).detach();
+	}
+}
+
+void RemoteServer::Stop()
+{
+	stopping.store(true, std::memory_order_relaxed);
+	if (listener != -1)
+		shutdown((socket_t)listener, SHUTDOWN_BOTH); //wakes up accept
+	std::lock_guard<std::mutex> lock(clients_lock);
+	for (intptr_t client : clients)
+		shutdown((socket_t)client, SHUTDOWN_BOTH);
+}
+
+void RemoteServer::ServeClient(intptr_t client)
+{
+	LOG_INFO("Client connected");
+	std::unique_ptr<Session> session = std::make_unique<Session>();
+	std::vector<uint8_t> input(64 * 1024); //room for pipelined messages, grown for big ones
+	std::vector<uint8_t> reply;
+	size_t have = 0;
+
+	while (true)
+	{
+		while (have < 4)
+		{
+			long count = Receive(client, input.data() + have, input.size() - have);
+			if (count <= 0)
+				goto disconnect;
+			have += count;
+		}
+		uint32_t size = Get32(input.data());
+		if (size > KIP8_RC_MAX_MESSAGE)
+		{
+			LOG_ERROR("Client sent a {} byte message, closing the connection", size);
+			break;
+		}
+		if (input.size() < 4 + (size_t)size)
+			input.resize(4 + (size_t)size);
+		while (have < 4 + (size_t)size)
+		{
+			long count = Receive(client, input.data() + have, input.size() - have);
+			if (count <= 0)
+				goto disconnect;
+			have += count;
+		}
+
+		reply.resize(4);
+		session->Handle(input.data() + 4, size, reply);
+		Set32(reply.data(), (uint32_t)(reply.size() - 4));
+		if (!SendAll(client, reply.data(), reply.size()))
+			break;
+
+		size_t used = 4 + (size_t)size;
+		memmove(input.data(), input.data() + used, have - used);
+		have -= used;
+	}
+
+disconnect:
+	const Stats& stats = session->GetStats();
+	LOG_INFO("Client disconnected after {} messages ({} commands), {:.2f} us handling per message", stats.messages, stats.commands,
+		stats.messages ? (double)stats.microseconds / stats.messages : 0.0);
+	session.reset();
+
+	std::lock_guard<std::mutex> lock(clients_lock);
+	CLOSE_SOCKET((socket_t)client);
+	clients.erase(std::find(clients.begin(), clients.end(), client));
+	clients_done.notify_all();
+}
+
+RemoteClient::~RemoteClient()
+{
+	Close();
+}
+
+bool RemoteClient::Connect(const std::string& path)
+{
+	Close();
+	sockaddr_un addr;
+	if (!InitSockets() || !MakeAddress(path, addr))
+		return false;
+
+	socket_t s = socket(AF_UNIX, SOCK_STREAM, 0);
+	if ((intptr_t)s == -1 || connect(s, (sockaddr*)&addr, sizeof(addr)) != 0)
+	{
+		LOG_ERROR("Could not connect to {}", path);
+		if ((intptr_t)s != -1)
+			CLOSE_SOCKET(s);
+		return false;
+	}
+	connection = (intptr_t)s;
+	return true;
+}
+
+void RemoteClient::Close()
+{
+	if (connection != -1)
+		CLOSE_SOCKET((socket_t)connection);
+	connection = -1;
+}
+
+bool RemoteClient::Call(const std::vector<uint8_t>& body, std::vector<uint8_t>& reply)
+{
+	if (connection == -1)
+		return false;
+	buffer.resize(4 + body.size());
+	Set32(buffer.data(), (uint32_t)body.size());
+	memcpy(buffer.data() + 4, body.data(), body.size());
+	if (!SendAll(connection, buffer.data(), buffer.size()))
+		return false;
+
+	//one receive for small replies: the buffer is big enough for the header and the body at once
+	if (buffer.size() < 64 * 1024)
+		buffer.resize(64 * 1024);
+	size_t have = 0;
+	size_t size = 0;
+	while (have < 4 || have < 4 + size)
+	{
+		long count = Receive(connection, buffer.data() + have, buffer.size() - have);
+		if (count <= 0)
+			return false;
+		have += count;
+		if (have >= 4)
+		{
+			size = Get32(buffer.data());
+			if (buffer.size() < 4 + size)
+				buffer.resize(4 + size);
+		}
+	}
+	reply.assign(buffer.begin() + 4, buffer.begin() + 4 + size);
+	return true;
+}
@@ -0,0 +1,151 @@
+#include "RewindBuffer.h"
+#include <algorithm>
+#include <cstring>
+
+RewindBuffer::RewindBuffer(size_t budget_bytes, unsigned int keyframe_interval) : budget(budget_bytes), interval(std::max(1u, keyframe_interval))
+{
+}
+
+void RewindBuffer::Clear()
+{
+	frames.clear();
+	memory_used = 0;
+	frames_since_key = 0;
+	need_keyframe = true;
+}
+
+void RewindBuffer::Capture(Chip8* core)
+{
+	Frame frame;
+	core->GetCPUState(frame.cpu);
+
+	uint32_t ram_size = (uint32_t)frame.cpu.RamLimit + 1;
+	uint32_t row_bytes = frame.cpu.res.base_width;
+	uint32_t vram_size = row_bytes * frame.cpu.res.base_height;
+	uint8_t* vram = core->GetVRAM();
+
+	//a mode change alters the RAM and VRAM layout, so deltas against the old keyframe would be meaningless
+	if (frame.cpu.RamLimit != key_ram_limit || frame.cpu.res.base_width != key_width || frame.cpu.res.base_height != key_height || frames_since_key >= interval)
+		need_keyframe = true;
+
+	if (need_keyframe)
+	{
+		frame.keyframe = true;
+		frame.data.resize(ram_size);
+		core->CopyRAM(0, frame.data.data(), ram_size);
+		frame.data.insert(frame.data.end(), vram, vram + vram_size);
+
+		key_ram.assign(frame.data.begin(), frame.data.begin() + ram_size);
+		key_vram.assign(vram, vram + vram_size);
+		key_ram_limit = frame.cpu.RamLimit;
+		key_width = frame.cpu.res.base_width;
+		key_height = frame.cpu.res.base_height;
+		frames_since_key = 0;
+		need_keyframe = false;
+	}
+	else
+	{
+		for (uint32_t offset = 0; offset < ram_size; offset += PAGE_SIZE)
+		{
+			uint32_t len = std::min(PAGE_SIZE, ram_size - offset);
+			if (memcmp(core->GetRAMPage(offset / PAGE_SIZE), key_ram.data() + offset, len) != 0)
+				frame.pages.push_back((uint16_t)(offset / PAGE_SIZE));
+		}
+		for (uint32_t row = 0; row < frame.cpu.res.base_height; row++)
+		{
+			if (memcmp(vram + (row * row_bytes), key_vram.data() + (row * row_bytes), row_bytes) != 0)
+				frame.rows.push_back((uint8_t)row);
+		}
+
+		frame.data.reserve((frame.pages.size() * PAGE_SIZE) + (frame.rows.size() * row_bytes));
+		for (uint16_t page : frame.pages)
+		{
+			const uint8_t* data = core->GetRAMPage((uint8_t)page);
+			frame.data.insert(frame.data.end(), data, data + std::min(PAGE_SIZE, ram_size - (page * PAGE_SIZE)));
+		}
+		for (uint8_t row : frame.rows)
+			frame.data.insert(frame.data.end(), vram + (row * row_bytes), vram + ((row + 1) * row_bytes));
+	}
+	frames_since_key++;
+
+	frames.push_back(std::move(frame));
+	memory_used += frames.back().Bytes();
+
+	while (memory_used > budget)
+	{
+		//only evict if another keyframe exists, never the group the newest frame depends on
+		auto next_key = std::find_if(frames.begin() + 1, frames.end(), [](Frame& f) { return f.keyframe; });
+		if (next_key == frames.end())
+			break;
+		EvictOldest();
+	}
+}
+
+bool RewindBuffer::Rewind(Chip8* core)
+{
+	//the newest frame is the state the core is already in, so step back to the one before it
+	if (frames.size() < 2)
+		return false;
+
+	Frame& newest = frames.back();
+	if (newest.keyframe)
+		need_keyframe = true; //key_ram belongs to the frame being dropped
+	else if (frames_since_key)
+		frames_since_key--;
+	memory_used -= newest.Bytes();
+	frames.pop_back();
+
+	Restore(core, frames.size() - 1);
+	return true;
+}
+
+void RewindBuffer::Restore(Chip8* core, size_t index)
+{
+	size_t key_index = index;
+	while (key_index > 0 && !frames[key_index].keyframe)
+		key_index--;
+
+	Frame& key = frames[key_index];
+	Frame& target = frames[index];
+	uint32_t ram_size = (uint32_t)key.cpu.RamLimit + 1;
+	uint32_t row_bytes = key.cpu.res.base_width;
+	uint32_t vram_size = row_bytes * key.cpu.res.base_height;
+
+	core->SetCPUState(target.cpu);
+	core->SetRAM(0, key.data.data(), ram_size);
+	memcpy(core->GetVRAM(), key.data.data() + ram_size, vram_size);
+	if (index != key_index)
+		ApplyDelta(core, target, ram_size, row_bytes);
+	core->RehashVRAM();
+
+	core->ClearPrevVRAM();
+	core->SetScreenDirty();
+	core->SetWipeScreen();
+}
+
+void RewindBuffer::ApplyDelta(Chip8* core, Frame& frame, uint32_t ram_size, uint32_t row_bytes)
+{
+	const uint8_t* in = frame.data.data();
+	for (uint16_t page : frame.pages)
+	{
+		uint32_t offset = page * PAGE_SIZE;
+		uint32_t len = std::min(PAGE_SIZE, ram_size - offset);
+		core->SetRAM((uint16_t)offset, in, len);
+		in += len;
+	}
+	for (uint8_t row : frame.rows)
+	{
+		memcpy(core->GetVRAM() + (row * row_bytes), in, row_bytes);
+		in += row_bytes;
+	}
+}
+
+void RewindBuffer::EvictOldest()
+{
+	//drop the oldest keyframe along with every delta frame that depends on it
+	do
+	{
+		memory_used -= frames.front().Bytes();
+		frames.pop_front();
+	} while (!frames.empty() && !frames.front().keyframe);
+}
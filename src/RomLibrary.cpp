@@ -0,0 +1,281 @@
+#include "RomLibrary.h"
+#include "FastSha1.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "RomLoader.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#pragma pack(push, 1)
+struct LibraryHeader {
+	char magic[4];
+	uint16_t version;
+	uint32_t count;
+};
+
+struct LibraryRecord {
+	uint64_t size;
+	int64_t mtime;
+	char sha1[40];
+	uint16_t path_length; //followed by the path, not terminated
+};
+#pragma pack(pop)
+
+static const uint16_t LIBRARY_VERSION = 1;
+
+RomLibrary::RomLibrary(unsigned int threads) : thread_count(threads)
+{
+	if (thread_count == 0)
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool RomLibrary::IsRomFile(const std::string& path)
+{
+	static const char* extensions[] = { ".ch8", ".c8", ".sc8", ".xo8", ".hc8", ".ch10" };
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos)
+		return false;
+	std::string extension = path.substr(dot);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	for (const char* known : extensions)
+		if (extension == known)
+			return true;
+	return false;
+}
+
+static std::string FileTitle(const std::string& path)
+{
+	size_t offset = path.find_last_of("/\\");
+	return path.substr(offset == std::string::npos ? 0 : offset + 1);
+}
+
+//size and mtime. directory_entry already holds both on Windows, elsewhere asking for them is a stat call each, so
+//one stat does it there
+static bool Stat(const std::filesystem::directory_entry& file, RomLibrary::Entry& entry)
+{
+#ifdef _WIN32
+	std::error_code error;
+	entry.size = file.file_size(error);
+	if (!error)
+		entry.mtime = (int64_t)file.last_write_time(error).time_since_epoch().count();
+	if (error)
+		return false;
+#else
+	struct stat info;
+	if (stat(file.path().c_str(), &info) != 0)
+		return false;
+	entry.size = (uint64_t)info.st_size;
+#ifdef __APPLE__
+	entry.mtime = (int64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+	entry.mtime = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+#endif
+	entry.title = FileTitle(entry.path);
+	return entry.size != 0 && entry.size <= RomLoader::MAX_SIZE;
+}
+
+const RomLibrary::Entry* RomLibrary::Find(const std::string& path)
+{
+	auto found = by_path.find(path);
+	return found == by_path.end() ? nullptr : &entries[found->second];
+}
+
+bool RomLibrary::LoadIndex(const std::string& filename)
+{
+	index_file = filename;
+	entries.clear();
+	by_path.clear();
+	MappedFile file;
+	if (!file.Open(filename))
+	{
+		LOG_INFO("No rom library index at {}", filename);
+		return false;
+	}
+
+	LibraryHeader header;
+	if (file.Size() < sizeof(header))
+	{
+		LOG_ERROR("Rom library index is truncated: {}", filename);
+		return false;
+	}
+	memcpy(&header, file.Data(), sizeof(header));
+	if (memcmp(header.magic, "KLIB", 4) != 0 || header.version != LIBRARY_VERSION || header.count > file.Size() / sizeof(LibraryRecord))
+	{
+		LOG_ERROR("Not a supported rom library index: {}", filename);
+		return false;
+	}
+
+	const uint8_t* in = file.Data() + sizeof(header);
+	const uint8_t* end = file.Data() + file.Size();
+	entries.resize(header.count);
+	for (Entry& entry : entries)
+	{
+		LibraryRecord record;
+		if ((size_t)(end - in) < sizeof(record))
+			break;
+		memcpy(&record, in, sizeof(record));
+		in += sizeof(record);
+		if ((size_t)(end - in) < record.path_length)
+			break;
+		entry.path.assign((const char*)in, record.path_length);
+		in += record.path_length;
+		entry.size = record.size;
+		entry.mtime = record.mtime;
+		entry.sha1.assign(record.sha1, sizeof(record.sha1));
+		entry.title = FileTitle(entry.path);
+		by_path[entry.path] = &entry - entries.data();
+	}
+	if (by_path.size() != entries.size())
+	{
+		LOG_ERROR("Rom library index is corrupt, rescanning everything: {}", filename);
+		entries.clear();
+		by_path.clear();
+		return false;
+	}
+	LOG_INFO("Loaded {} roms from library index {}", entries.size(), filename);
+	return true;
+}
+
+bool RomLibrary::SaveIndex()
+{
+	if (index_file == "")
+		return false;
+	std::ofstream ofd(index_file, std::ios::binary | std::ios::out | std::ios::trunc);
+	if (!ofd.good())
+	{
+		LOG_ERROR("Could not write rom library index: {}", index_file);
+		return false;
+	}
+
+	LibraryHeader header;
+	memcpy(header.magic, "KLIB", 4);
+	header.version = LIBRARY_VERSION;
+	header.count = (uint32_t)entries.size();
+	std::string out((const char*)&header, sizeof(header));
+	for (const Entry& entry : entries)
+	{
+		LibraryRecord record;
+		record.size = entry.size;
+		record.mtime = entry.mtime;
+		memcpy(record.sha1, entry.sha1.data(), sizeof(record.sha1));
+		record.path_length = (uint16_t)entry.path.size();
+		out.append((const char*)&record, sizeof(record));
+		out.append(entry.path);
+	}
+	ofd.write(out.data(), out.size());
+	ofd.close();
+	if (!ofd.good())
+	{
+		LOG_ERROR("Failed writing rom library index: {}", index_file);
+		return false;
+	}
+	return true;
+}
+
+bool RomLibrary::Scan(const std::string& root, ScanStats* stats)
+{
+	namespace fs = std::filesystem;
+	auto start = std::chrono::steady_clock::now();
+	ScanStats result;
+
+	std::error_code error;
+	fs::recursive_directory_iterator it(fs::path(root), fs::directory_options::skip_permission_denied, error);
+	if (error)
+	{
+		LOG_ERROR("Could not scan rom library {}: {}", root, error.message());
+		return false;
+	}
+
+	//stat everything, take hashes from the index where size and mtime still match
+	std::vector<Entry> found;
+	std::vector<size_t> changed;
+	for (; it != fs::recursive_directory_iterator(); it.increment(error))
+	{
+		if (error)
+		{
+			LOG_WARN("Stopped scanning {} early: {}", root, error.message());
+			break;
+		}
+		if (!IsRomFile(it->path().string()) || !it->is_regular_file(error))
+			continue;
+		Entry entry;
+		entry.path = it->path().string();
+		if (!Stat(*it, entry))
+			continue;
+
+		const Entry* known = Find(entry.path);
+		if (known && known->size == entry.size && known->mtime == entry.mtime && known->sha1.size() == 40)
+		{
+			entry.sha1 = known->sha1;
+			result.reused++;
+		}
+		else
+			changed.push_back(found.size());
+		found.push_back(std::move(entry));
+	}
+
+	//every task writes only its own entry
+	if (!changed.empty())
+	{
+		ThreadPool pool((unsigned int)std::min<size_t>(thread_count, changed.size()));
+		for (size_t index : changed)
+		{
+			pool.Submit([&found, index]() {
+				MappedFile file;
+				if (file.Open(found[index].path))
+					found[index].sha1 = FastSha1::Hash(file.Data(), file.Size());
+			});
+		}
+		pool.Wait();
+	}
+	found.erase(std::remove_if(found.begin(), found.end(), [&result](const Entry& entry) {
+		if (!entry.sha1.empty())
+			return false;
+		LOG_WARN("Could not read rom {}", entry.path);
+		result.failed++;
+		return true;
+	}), found.end());
+	result.hashed = changed.size() - result.failed;
+	result.files = found.size();
+
+	size_t still_there = 0;
+	for (const Entry& entry : found)
+		still_there += by_path.count(entry.path);
+	result.removed = entries.size() - still_there;
+
+	std::sort(found.begin(), found.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+	entries = std::move(found);
+	by_path.clear();
+	for (size_t index = 0; index < entries.size(); index++)
+		by_path[entries[index].path] = index;
+	if (result.hashed || result.removed)
+		SaveIndex();
+
+	result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	LOG_INFO("Scanned {}: {} roms, {} hashed, {} from the index, {} removed in {:.1f} ms", root, result.files, result.hashed, result.reused, result.removed, result.milliseconds);
+	if (stats)
+		*stats = result;
+	return true;
+}
+
+void RomLibrary::Join(GameDatabase& database)
+{
+	static const char* platforms[] = { "chip8", "schip", "xochip" };
+	for (Entry& entry : entries)
+	{
+		GameDatabase::Game game;
+		bool known = database.Find(entry.sha1, game);
+		entry.key = known ? game.key : "";
+		entry.title = game.title != "" ? game.title : FileTitle(entry.path);
+		entry.platform = known && game.has_settings ? platforms[game.mode] : "";
+	}
+}
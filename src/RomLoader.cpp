@@ -0,0 +1,86 @@
+#include "RomLoader.h"
+#include "FastSha1.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstring>
+
+bool RomLoader::Copy(const uint8_t* data, size_t size, Rom& rom, const std::atomic<bool>* cancel)
+{
+	FastSha1 sha1;
+	rom.data.resize(size);
+	for (size_t offset = 0; offset < size; offset += CHUNK_SIZE)
+	{
+		if (cancel && cancel->load(std::memory_order_relaxed))
+			return false;
+		size_t count = std::min(CHUNK_SIZE, size - offset);
+		memcpy(&rom.data[offset], data + offset, count);
+		sha1.Update(&rom.data[offset], count); //hash the copy, the mapping's pages were just faulted in once
+	}
+	rom.sha1 = sha1.FinalHex();
+	return true;
+}
+
+bool RomLoader::Read(const std::string& filename, Rom& rom)
+{
+	rom.filename = filename;
+	rom.data.clear();
+	rom.sha1 = "";
+	MappedFile file;
+	if (!file.Open(filename))
+		rom.error = "File did not open correctly!";
+	else if (file.Size() > MAX_SIZE)
+		rom.error = "File too large!";
+	else
+	{
+		rom.error = "";
+		return Copy(file.Data(), file.Size(), rom, nullptr);
+	}
+	return false;
+}
+
+void RomLoader::Start(const std::string& filename)
+{
+	Cancel();
+	job = std::make_unique<Job>();
+	job->rom.filename = filename;
+
+	auto file = std::make_unique<MappedFile>();
+	if (!file->Open(filename))
+		job->rom.error = "File did not open correctly!";
+	else if (file->Size() > MAX_SIZE)
+		job->rom.error = "File too large!";
+	else if (file->Size() < ASYNC_SIZE)
+		Copy(file->Data(), file->Size(), job->rom, nullptr);
+	else
+	{
+		Job* running = job.get();
+		job->thread = std::thread([running, file = std::move(file)]() {
+			Copy(file->Data(), file->Size(), running->rom, &running->cancel);
+			running->done.store(true, std::memory_order_release);
+		});
+		return;
+	}
+	job->done.store(true, std::memory_order_release);
+}
+
+void RomLoader::Cancel()
+{
+	if (!job)
+		return;
+	job->cancel = true;
+	if (job->thread.joinable())
+		job->thread.join();
+	job = nullptr;
+}
+
+bool RomLoader::Poll(Rom& rom)
+{
+	if (!job || !job->done.load(std::memory_order_acquire))
+		return false;
+	if (job->thread.joinable())
+		job->thread.join();
+	rom = std::move(job->rom);
+	job = nullptr;
+	return true;
+}
@@ -24,6 +24,7 @@ void SDLFrontEnd::init()
 {
     m_State.running = true;
     m_State.resolution_Zoom = 8;
+	m_State.frame_Timer = &m_Frame_Timer;
 	if (debug_interface)
 	{
 		imgui_UI = new DebugUI(&m_State);
@@ -61,47 +62,43 @@ void SDLFrontEnd::init()
 	SetMappedKey(SDL_SCANCODE_C, 0xE);
 	SetMappedKey(SDL_SCANCODE_V, 0xF);
 
-	//check for game database
-	std::ifstream hashes_infile("hashmap.json");
-	if (hashes_infile.good())
-	{
-		hashes_infile >> m_State.games_hashes;
-		LOG_INFO("Loaded file hashes from hashmap.json");
-	}
-	else
-	{
-		LOG_INFO("Unable to load file hashes from hashmap.json");
-	}
-	hashes_infile.close();
-
-	//check for game database
-	std::ifstream settings_infile("game_settings.json");
-	if (settings_infile.good())
-	{
-		settings_infile >> m_State.game_settings;
-		LOG_INFO("Loaded per-game settings from game_settings.json");
-	}
-	else
-	{
-		LOG_INFO("Unable to load per-game settings from game_settings.json");
-	}
-	settings_infile.close();
+	//check for game database. nothing needs it before the first rom is loaded, so it is read while SDL brings up the
+	//window, and WaitForDatabases is called before anything uses it
+	m_Databases = std::thread([this]() {
+		StartupTimeline::Phase phase("game database and quirk cache");
+		m_GameDB.Open("game_db.bin", "hashmap.json", "game_settings.json");
+		m_QuirkDetector.LoadCache("quirk_cache.json");
+	});
 
     initVideo();
-    initAudio();
+	//the audio device is opened by Run once the first frame is shown, opening it can take longer than everything else
+}
+
+void SDLFrontEnd::WaitForDatabases()
+{
+	if (!m_Databases.joinable())
+		return;
+	StartupTimeline::Phase phase("waiting for databases");
+	m_Databases.join();
 }
 
 int SDLFrontEnd::initVideo()
 {
-    if (SDL_Init(SDL_INIT_VIDEO) < 0)
-    {
-        std::cout << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
-        m_State.running = false;
-        return -1;
-    }
+	StartupTimeline::Phase phase("video");
+	{
+		StartupTimeline::Phase sdl_phase("SDL video init");
+		if (SDL_Init(SDL_INIT_VIDEO) < 0)
+		{
+			std::cout << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
+			m_State.running = false;
+			return -1;
+		}
+	}
 
-	SDL_SetHint(SDL_HINT_RENDER_DRIVER, "opengl");
+	//only a preference. the SDL_RENDER_DRIVER environment variable or --renderer picks another one
+	SDL_SetHintWithPriority(SDL_HINT_RENDER_DRIVER, "opengl", SDL_HINT_DEFAULT);
 
+	StartupTimeline::Phase window_phase("window and renderer");
 	if(debug_interface)
 		m_State.window = SDL_CreateWindow("KIP-8", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 800, 600, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_MAXIMIZED);
 	else
@@ -137,9 +134,6 @@ int SDLFrontEnd::initVideo()
 		//make a hardware accel renderer for future screen drawing
 		m_State.renderer = SDL_CreateRenderer(m_State.window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE);
 
-		if (imgui_UI)
-			imgui_UI->Init();	
-
 		ResetDisplayTexture();
     }
     return 0;
@@ -148,6 +142,7 @@ int SDLFrontEnd::initVideo()
 void audio_callback(void* user, Uint8* stream, int len) {
 
 	SDLFrontEnd* frontend = (SDLFrontEnd * )user;
+	FrameTimer::Zone zone(*frontend->GetState()->frame_Timer, FrameTimer::AUDIO_CALLBACK);
 	int16_t* audio_stream = (int16_t*)stream;
 	int audio_len = len / 2;
 	for (int it = 0; it < audio_len; it++)
@@ -181,12 +176,22 @@ void audio_callback(void* user, Uint8* stream, int len) {
 	}
 }
 
+void SDLFrontEnd::initUI()
+{
+	if (m_UI_Ready || !imgui_UI)
+		return;
+	StartupTimeline::Phase phase("ImGui");
+	imgui_UI->Init();
+	m_UI_Ready = true;
+}
+
 int SDLFrontEnd::initAudio()
 {
+	StartupTimeline::Phase phase("audio");
     if (SDL_Init(SDL_INIT_AUDIO) < 0)
     {
-		std::cout << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
-        m_State.running = false;
+		//the emulator still runs, just silently
+		std::cout << "SDL could not initialize audio! SDL_Error: " << SDL_GetError() << std::endl;
         return -1;
     }
 
@@ -205,10 +210,18 @@ int SDLFrontEnd::initAudio()
 
 void SDLFrontEnd::deinit()
 {
+	if (m_State.recording)
+		StopRecording();
+
+	WaitForDatabases();
+	if (m_Library_Scan.joinable())
+		m_Library_Scan.join();
+
 	if (imgui_UI)
 	{
 		delete imgui_UI;
 		imgui_UI = nullptr;
+		m_UI_Ready = false;
 	}
 
 	if(m_State.open_File)
@@ -225,8 +238,9 @@ void SDLFrontEnd::deinitAudio()
 
 void SDLFrontEnd::deinitVideo()
 {
-	if (imgui_UI)
+	if (imgui_UI && m_UI_Ready)
 		imgui_UI->Deinit();
+	m_UI_Ready = false;
 
 	SDL_DestroyRenderer(m_State.renderer);
     SDL_DestroyWindow(m_State.window);
@@ -235,25 +249,58 @@ void SDLFrontEnd::deinitVideo()
 
 bool SDLFrontEnd::Run()
 {
+	FrameTimer::Zone frame(m_Frame_Timer, FrameTimer::FRAME);
 	if (m_Paused)
 		m_Timer.start();	
 	time_accumulator += m_Timer.elapsed<stopwatch::mus>();
 	while (time_accumulator >= m_FrameMicroSeconds) //if it's been less than 1/60th of a second since we started the previous frame, do nothing
 	{
 		time_accumulator -= m_FrameMicroSeconds;
-		AdvanceCore();
-		
+		{
+			FrameTimer::Zone zone(m_Frame_Timer, FrameTimer::ADVANCE_CORE);
+			uint64_t cycles = m_State.core->GetTotalCycles();
+			if (m_State.rewinding)
+				RewindCore();
+			else
+				AdvanceCore();
+			uint64_t ran = m_State.core->GetTotalCycles();
+			zone.SetArg(ran > cycles ? (uint32_t)(ran - cycles) : 0); //rewinding and resets go backwards
+		}
+		PublishFrame();
+	}
+	{
+		FrameTimer::Zone zone(m_Frame_Timer, FrameTimer::HANDLE_INPUT);
+		HandleInput();
 	}
-	HandleInput();
 	m_Timer.start();
 
-	DrawScreen();
-	if (imgui_UI)
 	{
+		FrameTimer::Zone zone(m_Frame_Timer, FrameTimer::DRAW_SCREEN);
+		DrawScreen();
+	}
+	//the debug UI is the whole window, it's set up for the first frame that draws it while the databases still load
+	if (debug_interface)
+		initUI();
+	if (m_UI_Ready)
+	{
+		FrameTimer::Zone zone(m_Frame_Timer, FrameTimer::DRAW_UI);
 		imgui_UI->Draw();
 	}
 
-	SDL_RenderPresent(m_State.renderer);	
+	{
+		FrameTimer::Zone zone(m_Frame_Timer, FrameTimer::RENDER_PRESENT);
+		SDL_RenderPresent(m_State.renderer);
+	}
+
+	if (m_Frames_Presented++ == 0)
+		StartupTimeline::Mark("first frame presented");
+	else if (!m_Audio_Started)
+	{
+		m_Audio_Started = true;
+		initAudio();
+		if (m_Profile_Startup)
+			StartupTimeline::Print();
+	}
 
 	if (m_State.core->RequestsRPLSave())
 	{
@@ -261,6 +308,31 @@ bool SDLFrontEnd::Run()
 		m_State.core->ResetRPLRequest();
 	}
 
+	if (m_State.save_State)
+	{
+		m_State.save_State = false;
+		SaveState();
+	}
+	if (m_State.load_State)
+	{
+		m_State.load_State = false;
+		LoadState();
+	}
+	if (m_State.toggle_Recording)
+	{
+		m_State.toggle_Recording = false;
+		if (m_State.recording)
+			StopRecording();
+		else
+			StartRecording();
+	}
+
+	PollLauncher();
+	PollRomLoad();
+	PollHotReload();
+	PollQuirkDetection();
+	PollProfiler();
+
 	if (m_State.open_File && m_State.open_File->ready())
 	{
 		auto result = m_State.open_File->result();
@@ -277,12 +349,71 @@ bool SDLFrontEnd::Run()
 
 void SDLFrontEnd::AdvanceCore()
 {
+	if (m_State.recording)
+	{
+		if (m_State.core->GetDebugStepping())
+		{
+			LOG_WARN("Debug stepping can't be recorded, stopping movie.");
+			StopRecording();
+		}
+		else
+			m_Movie.RecordFrame(m_State.core, (uint16_t)m_State.run_Cycles);
+	}
+
     if (!m_State.core->GetDebugStepping())
         m_State.core->Run((uint16_t)m_State.run_Cycles);
     else
     {
         m_State.core->Run(0);
     }
+
+	if (m_State.recording)
+		m_Movie.EndFrame(m_State.core);
+
+	if (!m_State.rewind_Enabled)
+	{
+		if (m_Rewind.GetFrameCount())
+			m_Rewind.Clear();
+	}
+	else if (!m_State.core->GetDebugStepping())
+		m_Rewind.Capture(m_State.core);
+}
+
+bool SDLFrontEnd::ExportFrames(const std::string& shm_name)
+{
+	return m_FrameRing.Create(shm_name);
+}
+
+void SDLFrontEnd::PublishFrame()
+{
+	if (!m_FrameRing.IsOpen())
+		return;
+	uint32_t palette[16];
+	for (int it = 0; it < 16; it++)
+	{
+		const SDL_Color& color = m_State.screen_Colors[it];
+		palette[it] = (uint32_t)color.r << 24 | (uint32_t)color.g << 16 | (uint32_t)color.b << 8 | color.a;
+	}
+	m_FrameRing.Publish(m_State.core, palette);
+}
+
+void SDLFrontEnd::RewindCore()
+{
+	if (!m_State.rewind_Enabled || m_State.core->GetDebugStepping())
+		return;
+	Chip8::SYSTEM_MODE mode = m_State.core->GetSystemMode();
+	if (!m_Rewind.Rewind(m_State.core))
+		return;
+
+	//rewinding past a mode switch or a hires toggle restores the old screen size, same as loading a state
+	if (m_State.core->GetSystemMode() != mode || m_State.core->res.base_width != m_Res_Width || m_State.core->res.base_height != m_Res_Height)
+		ResetResolution();
+
+	if (m_State.recording)
+	{
+		LOG_WARN("Rewinding breaks the recorded timeline, stopping movie.");
+		StopRecording();
+	}
 }
 
 void SDLFrontEnd::DrawScreen()
@@ -295,7 +426,7 @@ void SDLFrontEnd::DrawScreen()
 		m_Pixel.w = m_State.resolution_Zoom;
 		m_Pixel.h = m_State.resolution_Zoom;
 		ResetDisplayTexture();
-		std::fill_n(m_State.core->GetPrevVRAM(), 128 * 64, 0);
+		m_State.core->ClearPrevVRAM();
 		m_State.core->SetScreenDirty();
 		m_State.core->SetWipeScreen();
 	}
@@ -471,7 +602,7 @@ void SDLFrontEnd::ResetDisplayTexture()
 	SDL_RenderClear(m_State.renderer);
 
 	SDL_SetRenderTarget(m_State.renderer, nullptr);
-	std::fill_n(m_State.core->GetPrevVRAM(), 128 * 64, 0);
+	m_State.core->ClearPrevVRAM();
 	m_State.core->SetScreenDirty();
 	m_State.core->SetWipeScreen();
 
@@ -500,142 +631,92 @@ void SDLFrontEnd::ResetDisplayTexture()
 	return;
 }
 
+//roms can run FX75 every frame, the writer keeps only the latest flags and writes them in the background
 void SDLFrontEnd::PersistRPL()
 {
-	LOG_INFO("Attempting to persist Super-Chip RPL Data.");
-	memcpy(SuperChipRPLData, m_State.core->GetRPLMem(), 8);
-	std::string file{ "" };
-	file = m_State.last_File;
-	if (file != "")
+	if (m_State.last_File == "")
+		return;
+	size_t size = m_State.core->GetSystemMode() == Chip8::SYSTEM_MODE::XO_CHIP ? Chip8::RPL_SIZE : 8;
+	const uint8_t* flags = m_State.core->GetRPLMem();
+	m_Saves.Write(m_State.last_File + ".sav", std::vector<uint8_t>(flags, flags + size));
+}
+
+void SDLFrontEnd::SaveState()
+{
+	if (m_State.last_File.empty())
 	{
-		file += ".sav";
-		std::ofstream ofd(file, std::ios::binary | std::ios::out);
-		if (!ofd.good())
-		{
-			LOG_ERROR("Could not open file to save RPL data: {}", file.c_str());
-			return;
-		}
-		ofd.write((char*)SuperChipRPLData, 8);
-		ofd.close();
+		LOG_WARN("No file loaded, not saving state.");
+		return;
 	}
+	m_State.core->SaveState(m_State.last_File + ".state");
 }
 
-//truly hideous function to automatically setup a game according to JSON game settings database
-void SDLFrontEnd::LoadPrefs(std::string key)
+void SDLFrontEnd::LoadState()
+{
+	if (m_State.last_File.empty())
+	{
+		LOG_WARN("No file loaded, no state to load.");
+		return;
+	}
+	if (m_State.recording)
+		StopRecording();
+	if (m_State.core->LoadState(m_State.last_File + ".state"))
+		ResetResolution();
+}
+
+void SDLFrontEnd::StartRecording()
+{
+	if (m_State.last_File.empty() || m_State.file_data.empty())
+	{
+		LOG_WARN("No file loaded, nothing to record.");
+		return;
+	}
+	//movies always start from a freshly booted rom so they can be replayed without the frontend
+	m_Movie.Begin(m_State.core, m_State.file_data, m_State.rom_Hash);
+	m_Rewind.Clear();
+	m_State.recording = true;
+}
+
+void SDLFrontEnd::StopRecording()
+{
+	m_State.recording = false;
+	m_Movie.Save(m_State.last_File + ".kmv");
+}
+
+//set up a game according to its entry in the game settings database
+void SDLFrontEnd::LoadPrefs(const GameDatabase::Game& game)
 {
 	//no entry found for the given key, abort
-	if (m_State.game_settings[key].isNull())
+	if (!game.has_settings)
 	{
 		LOG_INFO("No saved preferences found. {}", m_State.last_File);
 		return;
 	}
 
 	//setup pretty title
-	m_State.game_title = m_State.game_settings[key].get("title", m_State.games_hashes[key].get("file", "")).asString();
+	m_State.game_title = game.title;
 	
 	//set run speed
-	m_State.run_Cycles = std::stoi(m_State.game_settings[key]["options"].get("tickrate", "9").asString());
+	m_State.run_Cycles = game.has_tickrate ? game.tickrate : 9;
 	
 	//set system mode
-	std::string sys_mode = m_State.game_settings[key].get("platform", "chip8").asString();
-	if (sys_mode == "chip8")
-	{
-		/*if (m_State.core->GetSystemMode() != Chip8::SYSTEM_MODE::CHIP_8)
-		{
-			m_State.resolution_Zoom = m_State.resolution_Zoom * 2;
-			m_State.zoom_Changed = true;
-		}*/
-		m_State.core->SetSystemMode(Chip8::SYSTEM_MODE::CHIP_8);
-	}
-	else if (sys_mode == "schip")
-	{
-		/*if (m_State.core->GetSystemMode() == Chip8::SYSTEM_MODE::CHIP_8)
-		{
-			m_State.resolution_Zoom = m_State.resolution_Zoom / 2;
-			m_State.zoom_Changed = true;
-		}*/
-		m_State.core->SetSystemMode(Chip8::SYSTEM_MODE::SUPER_CHIP);
-	}
-	else																// if (sys_mode == "xochip")
-	{
-		/*if (m_State.core->GetSystemMode() == Chip8::SYSTEM_MODE::CHIP_8)
-		{
-			m_State.resolution_Zoom = m_State.resolution_Zoom / 2;
-			m_State.zoom_Changed = true;
-		}*/
-		m_State.core->SetSystemMode(Chip8::SYSTEM_MODE::XO_CHIP);
-	}
-
+	m_State.core->SetSystemMode(game.mode);
 	m_State.zoom_Changed = true;
 
 	//set colors
-	uint8_t red, green, blue;
-	
-	std::string color_string = m_State.game_settings[key]["options"].get("backgroundColor", "#001B1B").asString();
-	red = (stoi(color_string.substr(1), nullptr, 16) & 0xFF0000) >> 16;
-	green = (stoi(color_string.substr(1), nullptr, 16) & 0x00FF00) >> 8;
-	blue = (stoi(color_string.substr(1), nullptr, 16) & 0x0000FF);
-
-	m_State.screen_Colors[0].r = red;
-	m_State.screen_Colors[0].g = green;
-	m_State.screen_Colors[0].b = blue;
-	
-	color_string = m_State.game_settings[key]["options"].get("fillColor", "#008080").asString();
-	red   = (stoi(color_string.substr(1), nullptr, 16) & 0xFF0000 ) >> 16;
-	green = (stoi(color_string.substr(1), nullptr, 16) & 0x00FF00 ) >>  8;
-	blue  = (stoi(color_string.substr(1), nullptr, 16) & 0x0000FF);
-
-	m_State.screen_Colors[1].r = red;
-	m_State.screen_Colors[1].g = green;
-	m_State.screen_Colors[1].b = blue;
-
-	color_string = m_State.game_settings[key]["options"].get("fillColor2", "#4CA6A6").asString();
-	red = (stoi(color_string.substr(1), nullptr, 16) & 0xFF0000) >> 16;
-	green = (stoi(color_string.substr(1), nullptr, 16) & 0x00FF00) >> 8;
-	blue = (stoi(color_string.substr(1), nullptr, 16) & 0x0000FF);
-
-	m_State.screen_Colors[2].r = red;
-	m_State.screen_Colors[2].g = green;
-	m_State.screen_Colors[2].b = blue;
-
-	color_string = m_State.game_settings[key]["options"].get("blendColor", "#99CCCC").asString();
-	red = (stoi(color_string.substr(1), nullptr, 16) & 0xFF0000) >> 16;
-	green = (stoi(color_string.substr(1), nullptr, 16) & 0x00FF00) >> 8;
-	blue = (stoi(color_string.substr(1), nullptr, 16) & 0x0000FF);
-
-	m_State.screen_Colors[3].r = red;
-	m_State.screen_Colors[3].g = green;
-	m_State.screen_Colors[3].b = blue;
+	for (int it = 0; it < 4; it++)
+	{
+		m_State.screen_Colors[it].r = (game.colors[it] >> 16) & 0xFF;
+		m_State.screen_Colors[it].g = (game.colors[it] >> 8) & 0xFF;
+		m_State.screen_Colors[it].b = game.colors[it] & 0xFF;
+	}
 
 	//set screen rotation
-	m_State.screen_Rotation = (uint16_t)stoi(m_State.game_settings[key]["options"].get("screenRotation", "0").asString());
+	m_State.screen_Rotation = game.rotation;
 	ResetResolution();
 
-	//Set quirks.
-    //Note: This emulator assumes schip 1.1 behavior is normal and enables quirks for other behaviors
-	//      Octo takes the opposite approach and assumes Cosmac VIP is normal behavior
-	//      The settings database is Octo-centric, so many quirks in this engine are set opposite the database
-	bool optional_quirk = false;
-	optional_quirk = m_State.game_settings[key]["options"].get("shiftQuirks", !m_State.core->quirks.vip_shifts).asBool();
-	m_State.core->quirks.vip_shifts = !optional_quirk;
-
-	optional_quirk = m_State.game_settings[key]["options"].get("loadStoreQuirks", !m_State.core->quirks.vip_regs_read_write).asBool();
-	m_State.core->quirks.vip_regs_read_write = !optional_quirk;
-
-	optional_quirk = m_State.game_settings[key]["options"].get("jumpQuirks", !m_State.core->quirks.vip_jump).asBool();
-	m_State.core->quirks.vip_jump = !optional_quirk;
-	
-	optional_quirk = m_State.game_settings[key]["options"].get("vBlankQuirks", m_State.core->quirks.draw_vblank).asBool();
-	m_State.core->quirks.draw_vblank = optional_quirk;
-
-	optional_quirk = m_State.game_settings[key]["options"].get("logicQuirks", m_State.core->quirks.logic_flag_reset).asBool();
-	m_State.core->quirks.logic_flag_reset = optional_quirk;
-
-	optional_quirk = m_State.game_settings[key]["options"].get("clipQuirks", m_State.core->quirks.draw_wrap).asBool();
-	m_State.core->quirks.draw_wrap = optional_quirk;
-	
-
-
+	//set quirks. options the database leaves out keep the defaults SetSystemMode just set
+	GameDatabase::ApplyQuirks(game, m_State.core->quirks);
 }
 
 //not yet implemented. Will allow a user to manually save their preferences for the current game.
@@ -670,36 +751,57 @@ void SDLFrontEnd::SetTitle()
 
 void SDLFrontEnd::Load(std::string filename)
 {
-
 	LOG_INFO("Loading new file: {}", filename);
-	std::ifstream ifd(filename, std::ios::binary | std::ios::ate);
-	if (!ifd.good())
+	if (m_State.recording)
+		StopRecording();
+	m_RomLoader.Start(filename);
+	PollRomLoad(); //small roms are already read, they start right away
+}
+
+//big roms are read on another thread while the previous one keeps running, and replace it between two frames
+void SDLFrontEnd::PollRomLoad()
+{
+	RomLoader::Rom rom;
+	if (!m_RomLoader.Poll(rom))
+		return;
+	if (rom.error != "")
 	{
-		LOG_ERROR("File did not open correctly!: {}", filename.c_str());
+		LOG_ERROR("{} {}", rom.error, rom.filename);
 		return;
 	}
+	std::string filename = rom.filename;
 
 	if (m_State.last_File != filename)
 		m_State.last_File = filename;
 	m_State.game_title = "";
-	//TODO: the json lookup is case sensitive
-	std::string hash(SHA1::from_file(filename));
-	std::string lookup;
-	if (!m_State.games_hashes[hash].isNull())
+	std::string hash = rom.sha1;
+	if (m_Profiler && hash != m_State.rom_Hash)
 	{
-		lookup = m_State.games_hashes[hash].asString();
-		LoadPrefs(lookup);
+		m_Profiler->Clear(); //reloading the same rom keeps adding to its profile
+		m_Profiler->LoadSymbolsFor(filename);
 	}
+	m_State.rom_Hash = hash;
+	GameDatabase::Game game;
+	bool detect_quirks = false;
+	WaitForDatabases();
+	m_QuirkDetector.Cancel();
+	m_State.detecting_Quirks = false;
+	if (m_GameDB.Find(hash, game))
+		LoadPrefs(game);
 	else
 	{
 		LOG_INFO("Did not find hash: {}, {}", hash, filename);
 		LOG_INFO("Loading default preferences.");
-		LoadPrefs("default");
+		if (!m_GameDB.FindDefault(game))
+			game = GameDatabase::Game();
+		LoadPrefs(game);
+		if (m_QuirkDetector.Lookup(hash, m_State.core->quirks))
+			LOG_INFO("Using previously detected quirks.");
+		else
+			detect_quirks = m_State.detect_Quirks;
 	}
 
-	size_t size = ifd.tellg();
-	ifd.seekg(0, std::ios::beg);
-
+	size_t size = rom.data.size();
 	if (0x1FF + size >= m_State.core->GetRAMLimit()) //game is too big or possibly not even a chip-8 game
 	{
 		LOG_ERROR("File too large! {}", filename.c_str());
@@ -708,19 +810,26 @@ void SDLFrontEnd::Load(std::string filename)
 
 	m_State.core->ResetMemory(m_State.core->GetSystemMode() == Chip8::SYSTEM_MODE::SUPER_CHIP); //if in super-chip mode, randomize, otherwise zero out memory
 
-	//char* rom_dest = (char*)m_State.core->GetRAM() + 0x200; //TODO: read this into the file_data local buffer on the frontend and pass that by reference to a load function in the core instead
-	m_State.file_data.resize(size);
-	ifd.read((char*)m_State.file_data.data(), size);
-	ifd.close();
+	m_State.file_data = std::move(rom.data);
 	m_State.core->Load(m_State.file_data);
+	m_Rewind.Clear();
+	if (m_Watcher.GetFilename() != filename)
+		m_Watcher.Watch(filename);
+
+	if (detect_quirks)
+	{
+		m_QuirkDetector.Start(m_State.file_data, hash, m_State.core->GetSystemMode(), m_State.core->quirks, (uint16_t)m_State.run_Cycles);
+		m_State.detecting_Quirks = true;
+	}
 
 	SetTitle();
 	
-	//automatically try to load rpl data if available
-	if (m_State.core->GetSystemMode() == Chip8::SYSTEM_MODE::SUPER_CHIP)
+	//automatically try to load rpl data if available. files written in SUPER-CHIP mode hold 8 flags, XO-CHIP 16
+	if (m_State.core->GetSystemMode() != Chip8::SYSTEM_MODE::CHIP_8)
 	{
+		m_Saves.Flush(); //the flags may still be on their way to disk
 		filename += ".sav";
-		ifd.open(filename, std::ios::binary | std::ios::ate);
+		std::ifstream ifd(filename, std::ios::binary | std::ios::ate);
 		if (!ifd.good())
 		{
 			LOG_WARN("Unable to open RPL flag save file for reading: {}", filename.c_str());
@@ -728,11 +837,130 @@ void SDLFrontEnd::Load(std::string filename)
 		}
 		size = ifd.tellg();
 		ifd.seekg(0, std::ios::beg);
-		ifd.read((char*)m_State.core->GetRPLMem(), min(8, (int)size));
+		ifd.read((char*)m_State.core->GetRPLMem(), min((int)Chip8::RPL_SIZE, (int)size));
 		ifd.close();
 	}
 }
 
+void SDLFrontEnd::SetLibrary(const std::string& root, bool show_launcher)
+{
+	m_State.library_Root = root;
+	m_State.show_Launcher = show_launcher;
+}
+
+//the library is scanned the first time the launcher is opened, on another thread. thumbnails are made as the
+//launcher asks for them
+void SDLFrontEnd::PollLauncher()
+{
+	if (m_State.launch_File != "")
+	{
+		Load(m_State.launch_File);
+		m_State.launch_File = "";
+	}
+	if (!m_State.show_Launcher)
+		return;
+	initUI(); //the basic UI may not have been needed yet
+
+	if (!m_State.library && !m_State.library_Scanning && m_State.library_Root != "")
+	{
+		WaitForDatabases();
+		m_Thumbnails.Open("thumbnails", &m_GameDB);
+		m_State.library_Scanning = true;
+		m_Library_Scan = std::thread([this]() {
+			m_Library.LoadIndex("rom_library.idx");
+			m_Library.Scan(m_State.library_Root);
+			m_Library.Join(m_GameDB);
+			m_Library_Scanned.store(true, std::memory_order_release);
+		});
+	}
+	if (m_State.library_Scanning && m_Library_Scanned.load(std::memory_order_acquire))
+	{
+		m_Library_Scan.join();
+		m_State.library_Scanning = false;
+		m_State.library = &m_Library;
+		m_State.thumbnails = &m_Thumbnails;
+	}
+}
+
+//Octo and other tools rewrite the rom on every build. an edit that keeps the rom's size leaves code and data where
+//they were, so only the changed bytes are patched into the running program and it carries on with its registers and
+//screen. anything else restarts it. either way the mode, quirks and colors stay, the new hash is in no database
+void SDLFrontEnd::PollHotReload()
+{
+	if (!m_Watcher.Poll() || !m_State.hot_Reload || m_Watcher.GetFilename() != m_State.last_File)
+		return;
+	auto start = std::chrono::steady_clock::now();
+	RomLoader::Rom rom;
+	if (!RomLoader::Read(m_Watcher.GetFilename(), rom) || rom.sha1 == m_State.rom_Hash)
+		return; //unreadable while it's being written, the write finishing is another event
+	Chip8* core = m_State.core;
+	if (0x1FF + rom.data.size() >= core->GetRAMLimit())
+	{
+		LOG_ERROR("File too large! {}", rom.filename);
+		return;
+	}
+
+	if (m_State.recording)
+		StopRecording();
+	m_QuirkDetector.Cancel();
+	m_State.detecting_Quirks = false;
+	m_Rewind.Clear(); //its snapshots hold the old code
+
+	bool in_place = rom.data.size() == m_State.file_data.size() && !core->GetHalted();
+	size_t patched = 0;
+	if (in_place)
+		patched = core->PatchRom(m_State.file_data, rom.data);
+	else
+	{
+		Chip8::Quirks quirks = core->quirks;
+		uint8_t rpl[Chip8::RPL_SIZE];
+		memcpy(rpl, core->GetRPLMem(), sizeof(rpl));
+		Movie::Boot(core, rom.data, core->GetSeed(), core->GetSystemMode(), quirks, rpl);
+	}
+	m_State.file_data = std::move(rom.data);
+	m_State.rom_Hash = rom.sha1;
+
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	if (in_place)
+		LOG_INFO("Hot reloaded {}: patched {} bytes into the running program in {:.2f} ms", rom.filename, patched, milliseconds);
+	else
+		LOG_INFO("Hot reloaded {}: size changed, restarted in {:.2f} ms", rom.filename, milliseconds);
+}
+
+void SDLFrontEnd::PollProfiler()
+{
+	Profiler* wanted = m_State.profiling ? m_Profiler.get() : nullptr;
+	if (m_State.profiling && !wanted)
+	{
+		m_Profiler = std::make_unique<Profiler>();
+		m_State.profiler = wanted = m_Profiler.get();
+		if (m_State.last_File != "")
+			m_Profiler->LoadSymbolsFor(m_State.last_File);
+		LOG_INFO("Profiling {}", m_State.last_File != "" ? m_State.last_File : "the running program");
+	}
+	if (m_State.core->GetProfiler() != wanted)
+		m_State.core->SetProfiler(wanted);
+}
+
+//detection runs on other threads while the rom plays with the default quirks. once it's done the result replaces
+//them, and a rom that already crashed under the defaults is started over
+void SDLFrontEnd::PollQuirkDetection()
+{
+	QuirkDetector::Result result;
+	if (!m_QuirkDetector.Poll(result))
+		return;
+	m_State.detecting_Quirks = false;
+	if (result.sha1 != m_State.rom_Hash || !result.conclusive)
+		return;
+
+	m_State.core->quirks = result.quirks;
+	if (m_State.core->GetHalted() && !m_State.core->GetDebugStepping())
+	{
+		LOG_INFO("Restarting with the detected quirks.");
+		Load(m_State.last_File);
+	}
+}
+
 void SDLFrontEnd::HandleInput()
 {
 	if (m_State.key_Layout_Changed)
@@ -745,7 +973,10 @@ void SDLFrontEnd::HandleInput()
 
 	while (SDL_PollEvent(&event))
 	{
-		if (imgui_UI)
+		//the basic UI's menu bar only shows while the mouse is over the window, so that's when it's needed
+		if (!m_UI_Ready && (event.type == SDL_MOUSEMOTION || (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_ENTER)))
+			initUI();
+		if (m_UI_Ready)
 			imgui_UI->HandleInput(&event);
 
 		if (event.type == SDL_QUIT)
@@ -758,8 +989,11 @@ void SDLFrontEnd::HandleInput()
 		{
 			case(SDL_KEYUP):
 			{
+				if (event.key.keysym.scancode == SDL_SCANCODE_BACKSPACE)
+					m_State.rewinding = false;
+
 				//ignore key input if the emulator is paused OR if the debug ui is captureing keyboard input
-				if (m_Paused || (imgui_UI && imgui_UI->WantCaptureKB()))
+				if (m_Paused || (m_UI_Ready && imgui_UI->WantCaptureKB()))
 					break;
 
 				//if key remap is requested, assign keypress to remap
@@ -791,6 +1025,16 @@ void SDLFrontEnd::HandleInput()
 						m_State.core->Reset("Keyboard Hotkey");
 						break;
 					}
+					case(SDL_SCANCODE_F5):
+					{
+						m_State.save_State = true;
+						break;
+					}
+					case(SDL_SCANCODE_F7):
+					{
+						m_State.load_State = true;
+						break;
+					}
 					default:
 						break;
 				}
@@ -799,7 +1043,7 @@ void SDLFrontEnd::HandleInput()
 			case(SDL_KEYDOWN):
 			{
 				//if debug ui is capturing key input, ignore this key input
-				if (imgui_UI && imgui_UI->WantCaptureKB())
+				if (m_UI_Ready && imgui_UI->WantCaptureKB())
 				{
 						break;
 				}
@@ -817,6 +1061,12 @@ void SDLFrontEnd::HandleInput()
 							m_State.core->Step();
 						break;
 					}
+					case(SDL_SCANCODE_BACKSPACE):
+					{
+						if (!m_Paused && !m_State.wait_for_remap_input)
+							m_State.rewinding = m_State.rewind_Enabled;
+						break;
+					}
 					case(SDL_SCANCODE_LALT):
 					{
 						m_Paused = !m_Paused;
@@ -0,0 +1,100 @@
+#include "SaveWriter.h"
+#include "Logger.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+SaveWriter::SaveWriter()
+{
+	writer = std::thread(&SaveWriter::WriterLoop, this);
+}
+
+SaveWriter::~SaveWriter()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	writer.join();
+}
+
+void SaveWriter::Write(const std::string& filename, std::vector<uint8_t> data)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		queued[filename] = std::move(data);
+	}
+	wake.notify_all();
+}
+
+void SaveWriter::Flush()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	if (queued.empty() && !busy)
+		return;
+	flushing = true;
+	wake.notify_all();
+	flushed.wait(guard, [this]() { return queued.empty() && !busy; });
+}
+
+void SaveWriter::WriterLoop()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	while (true)
+	{
+		wake.wait(guard, [this]() { return stopping || !queued.empty(); });
+		if (queued.empty())
+			break; //stopping with nothing left to write
+		//let a rom that saves in a loop finish its burst, unless someone is waiting for the file
+		wake.wait_for(guard, std::chrono::milliseconds(COALESCE_MS), [this]() { return stopping || flushing; });
+
+		std::map<std::string, std::vector<uint8_t>> batch;
+		batch.swap(queued);
+		busy = true;
+		guard.unlock();
+		for (auto& file : batch)
+		{
+			auto last = written.find(file.first);
+			if (last != written.end() && last->second == file.second)
+				continue;
+			if (WriteAtomic(file.first, file.second))
+				written[file.first] = std::move(file.second);
+		}
+		guard.lock();
+		busy = false;
+		if (queued.empty())
+		{
+			flushing = false;
+			flushed.notify_all();
+		}
+	}
+}
+
+bool SaveWriter::WriteAtomic(const std::string& filename, const std::vector<uint8_t>& data)
+{
+	std::string temp = filename + ".tmp";
+	std::ofstream ofd(temp, std::ios::binary | std::ios::out | std::ios::trunc);
+	if (!ofd.good())
+	{
+		LOG_ERROR("Could not open file to save: {}", temp);
+		return false;
+	}
+	ofd.write((const char*)data.data(), data.size());
+	ofd.close();
+	if (!ofd.good())
+	{
+		LOG_ERROR("Failed writing save file: {}", temp);
+		return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temp, filename, error);
+	if (error)
+	{
+		LOG_ERROR("Could not replace {}: {}", filename, error.message());
+		std::filesystem::remove(temp, error);
+		return false;
+	}
+	return true;
+}
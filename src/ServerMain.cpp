@@ -0,0 +1,110 @@
+//kip8-server: remote control of headless cores over a Unix domain socket, see RemoteProtocol.h for the protocol
+#include "CLI11.hpp"
+#include "Logger.h"
+#include "RemoteServer.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+//xors a sprite one pixel further right every loop, so every frame has a few bytes to send. no CLS: clearing and
+//rehashing the whole screen would cost more than the round trip being measured
+static const std::vector<uint8_t> BENCH_ROM = {
+	0xA2, 0x08, //I = 0x208
+	0xD0, 0x15, //draw 5 rows at V0, V1
+	0x70, 0x01, //V0 += 1
+	0x12, 0x00, //jump 0x200
+	0xF0, 0x90, 0xF0, 0x90, 0xF0
+};
+
+//returns the median round trip in microseconds, or a negative number if the connection was lost
+static double Measure(RemoteClient& client, const char* name, const std::vector<uint8_t>& body, unsigned int count)
+{
+	std::vector<uint8_t> reply;
+	std::vector<double> times(count);
+	for (unsigned int it = 0; it < count; it++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		if (!client.Call(body, reply))
+		{
+			LOG_ERROR("Lost the connection during {}", name);
+			return -1;
+		}
+		times[it] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+	std::sort(times.begin(), times.end());
+	double total = 0;
+	for (double time : times)
+		total += time;
+	LOG_INFO("{:<28} mean {:6.2f} us, p50 {:6.2f} us, p99 {:6.2f} us, {} byte reply", name, total / count, times[count / 2],
+		times[count * 99 / 100], reply.size());
+	return times[count / 2];
+}
+
+//round trips through a server on its own thread, the same path a client process takes apart from the process switch
+static int Bench(const std::string& path, unsigned int count)
+{
+	RemoteServer server;
+	if (!server.Listen(path))
+		return 1;
+	std::thread serve([&server] { server.Serve(); });
+
+	RemoteClient client;
+	bool ok = client.Connect(path);
+	if (ok)
+	{
+		std::vector<uint8_t> load, ping, step, observe;
+		RemoteClient::Put8(load, KIP8_RC_LOAD);
+		RemoteClient::Put8(load, 0);
+		RemoteClient::Put32(load, (uint32_t)BENCH_ROM.size());
+		load.insert(load.end(), BENCH_ROM.begin(), BENCH_ROM.end());
+		std::vector<uint8_t> reply;
+		ok = client.Call(load, reply) && reply.size() == 2 && reply[1] == KIP8_RC_OK;
+
+		RemoteClient::Put8(ping, KIP8_RC_PING);
+
+		RemoteClient::Put8(step, KIP8_RC_STEP);
+		RemoteClient::Put16(step, 1);
+		RemoteClient::Put16(step, 1);
+		RemoteClient::Put16(step, 0x0010);
+
+		observe = step;
+		RemoteClient::Put8(observe, KIP8_RC_FRAME_DELTA);
+		RemoteClient::Put8(observe, KIP8_RC_READ_RAM);
+		RemoteClient::Put16(observe, 0x200);
+		RemoteClient::Put16(observe, 16);
+
+		double small_step = -1;
+		ok = ok && Measure(client, "ping", ping, count) >= 0 && (small_step = Measure(client, "step 1 frame", step, count)) >= 0
+			&& Measure(client, "step + frame delta + ram", observe, count) >= 0;
+		if (small_step > 10.0)
+			LOG_WARN("Small steps take {:.2f} us per round trip, over the 10 us budget", small_step);
+		client.Close();
+	}
+
+	server.Stop();
+	serve.join();
+	return ok ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string socket_path = "/tmp/kip8.sock";
+	unsigned int bench = 0;
+
+	CLI::App app{ "KIP-8 remote control server" };
+
+	app.add_option("-s,--socket", socket_path, "Unix domain socket to listen on");
+	app.add_option("--bench", bench, "Measure this many round trips per command against an in-process server and exit");
+	CLI11_PARSE(app, argc, argv);
+
+	Logger::InitConsole(spdlog::level::info);
+
+	if (bench)
+		return Bench(socket_path, bench);
+
+	RemoteServer server;
+	if (!server.Listen(socket_path))
+		return 1;
+	server.Serve();
+	return 0;
+}
@@ -0,0 +1,52 @@
+#include "StartupTimeline.h"
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+	struct PhaseRecord {
+		const char* name;
+		double begin;
+		double end;
+		bool main_thread;
+	};
+
+	//static initialization runs before main on the main thread, which is as close to launch as we can get portably
+	const std::chrono::steady_clock::time_point launch = std::chrono::steady_clock::now();
+	const std::thread::id main_thread = std::this_thread::get_id();
+	std::mutex records_lock;
+	std::vector<PhaseRecord> records;
+}
+
+double StartupTimeline::Now()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launch).count();
+}
+
+void StartupTimeline::Record(const char* name, double begin, double end)
+{
+	std::lock_guard<std::mutex> lock(records_lock);
+	records.push_back({ name, begin, end, std::this_thread::get_id() == main_thread });
+}
+
+void StartupTimeline::Print()
+{
+	std::vector<PhaseRecord> sorted;
+	{
+		std::lock_guard<std::mutex> lock(records_lock);
+		sorted = records;
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](const PhaseRecord& a, const PhaseRecord& b) { return a.begin < b.begin; });
+
+	LOG_INFO("Startup timeline, ms since launch:");
+	for (const PhaseRecord& phase : sorted)
+	{
+		if (phase.end == phase.begin)
+			LOG_INFO("  {:8.2f}            {}", phase.begin, phase.name);
+		else
+			LOG_INFO("  {:8.2f} - {:8.2f}  {} ({:.2f} ms{})", phase.begin, phase.end, phase.name, phase.end - phase.begin, phase.main_thread ? "" : ", background");
+	}
+}
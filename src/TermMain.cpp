@@ -0,0 +1,60 @@
+//kip8-term: plays a rom in the terminal, for machines without a display. see TerminalFrontEnd.h
+#include "CLI11.hpp"
+#include "Logger.h"
+#include "TerminalFrontEnd.h"
+
+int main(int argc, char* argv[])
+{
+	std::string filename = "";
+	std::string colors = "auto";
+	std::string log_file = "logs/kip8_term_log";
+	bool enableSuperChip = false, enableXOChip = false;
+	int CPUSpeed = 9;
+	int render_fps = 60;
+	int key_hold = 8;
+	bool bell = false;
+	uint64_t seed = 0;
+
+	CLI::App app{ "KIP-8 terminal frontend" };
+
+	app.add_option("rom", filename, "Input rom file name")->required();
+	app.add_flag("-S,--Super-Chip", enableSuperChip, "Set system mode to Super-Chip for roms missing from the database");
+	app.add_flag("-X,--XO-Chip", enableXOChip, "Set system mode to XO-Chip for roms missing from the database");
+	app.add_option("-s,--speed", CPUSpeed, "Set CPU cycles per frame");
+	app.add_option("--colors", colors, "auto, 256 or truecolor")->check(CLI::IsMember({ "auto", "256", "truecolor" }));
+	app.add_option("--render-fps", render_fps, "Redraw at most this often, lower it for slow links");
+	app.add_option("--key-hold", key_hold, "Frames a key stays held after each press, terminals don't report releases");
+	app.add_flag("--bell", bell, "Ring the terminal bell when the sound timer starts");
+	app.add_option("--log", log_file, "Log file, the terminal is taken by the screen");
+	auto seed_option = app.add_option("--seed", seed, "Seed the random number generator for reproducible runs");
+	CLI11_PARSE(app, argc, argv);
+
+	Logger::SetLogger(Logger::CreateWorkerLogger("KIP-8 Core", log_file, spdlog::level::info));
+
+	Chip8 core;
+	if (*seed_option)
+		core.SetSeed(seed);
+	if (enableXOChip)
+		core.SetSystemMode(Chip8::SYSTEM_MODE::XO_CHIP);
+	else if (enableSuperChip)
+		core.SetSystemMode(Chip8::SYSTEM_MODE::SUPER_CHIP);
+	else
+		core.SetSystemMode(Chip8::SYSTEM_MODE::CHIP_8);
+
+	TerminalFrontEnd::ColorMode color_mode = TerminalFrontEnd::ColorMode::AUTO;
+	if (colors == "256")
+		color_mode = TerminalFrontEnd::ColorMode::PALETTE_256;
+	else if (colors == "truecolor")
+		color_mode = TerminalFrontEnd::ColorMode::TRUECOLOR;
+
+	TerminalFrontEnd frontend(&core, color_mode);
+	frontend.SetRunCycles(std::max<int>(0, CPUSpeed));
+	frontend.SetRenderRate(render_fps);
+	frontend.SetKeyHold(key_hold);
+	frontend.SetBell(bell);
+	if (!frontend.Load(filename))
+		return 1;
+
+	while (frontend.Run()) {}
+	return 0;
+}
@@ -0,0 +1,432 @@
+#include "TerminalFrontEnd.h"
+#include "Logger.h"
+#include "Movie.h"
+#include "RomLoader.h"
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <thread>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <conio.h>
+#else
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+static const char* UPPER_HALF_BLOCK = "\xE2\x96\x80";
+static const std::chrono::microseconds FRAME_TIME(16667);
+
+//keyboard keys in the layout order of the SDL frontend's default mapping, and the VIP keypad key each one is
+static const char* KEY_CHARS = "1234qwerasdfzxcv";
+static const uint8_t KEY_LAYOUT[16] = { 0x1, 0x2, 0x3, 0xC, 0x4, 0x5, 0x6, 0xD, 0x7, 0x8, 0x9, 0xE, 0xA, 0x0, 0xB, 0xF };
+
+static volatile sig_atomic_t s_Quit = 0;
+static volatile sig_atomic_t s_Resized = 0;
+#ifdef _WIN32
+static DWORD s_SavedOutputMode = 0;
+static UINT s_SavedCodePage = 0;
+#else
+static termios s_SavedTermios;
+#endif
+
+static void OnQuitSignal(int) { s_Quit = 1; }
+#ifndef _WIN32
+static void OnResizeSignal(int) { s_Resized = 1; }
+#endif
+
+static TerminalFrontEnd::Color ToColor(uint32_t rgb)
+{
+	TerminalFrontEnd::Color color;
+	color.r = (uint8_t)(rgb >> 16);
+	color.g = (uint8_t)(rgb >> 8);
+	color.b = (uint8_t)rgb;
+	return color;
+}
+
+//nearest entry of the 6x6x6 cube or the gray ramp of the 256 color palette
+static int To256(const TerminalFrontEnd::Color& color)
+{
+	auto level = [](int val) { return val < 48 ? 0 : val < 115 ? 1 : (val - 35) / 40; };
+	auto cube = [](int level) { return level ? 55 + level * 40 : 0; };
+	int r = level(color.r), g = level(color.g), b = level(color.b);
+	int cube_dist = (cube(r) - color.r) * (cube(r) - color.r) + (cube(g) - color.g) * (cube(g) - color.g) + (cube(b) - color.b) * (cube(b) - color.b);
+
+	int average = (color.r + color.g + color.b) / 3;
+	int gray = average > 238 ? 23 : std::max(0, (average - 3) / 10);
+	int gray_val = 8 + gray * 10;
+	int gray_dist = (gray_val - color.r) * (gray_val - color.r) + (gray_val - color.g) * (gray_val - color.g) + (gray_val - color.b) * (gray_val - color.b);
+
+	return gray_dist < cube_dist ? 232 + gray : 16 + r * 36 + g * 6 + b;
+}
+
+TerminalFrontEnd::TerminalFrontEnd(Chip8* core, ColorMode color_mode) : core(core), colors(color_mode)
+{
+	if (colors == ColorMode::AUTO)
+	{
+		const char* colorterm = getenv("COLORTERM");
+		bool truecolor = colorterm && (strstr(colorterm, "truecolor") || strstr(colorterm, "24bit"));
+		colors = truecolor ? ColorMode::TRUECOLOR : ColorMode::PALETTE_256;
+	}
+
+	for (int it = 0; it < 4; it++)
+		screen_Colors[it] = ToColor(GameDatabase::DEFAULT_COLORS[it]);
+	BuildColorCodes();
+
+	game_db.Open("game_db.bin", "hashmap.json", "game_settings.json");
+
+	InitTerminal();
+	next_frame = std::chrono::steady_clock::now();
+	fps_start = next_frame;
+}
+
+TerminalFrontEnd::~TerminalFrontEnd()
+{
+	RestoreTerminal();
+}
+
+#ifdef _WIN32
+void TerminalFrontEnd::InitTerminal()
+{
+	HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+	GetConsoleMode(output, &s_SavedOutputMode);
+	SetConsoleMode(output, s_SavedOutputMode | ENABLE_VIRTUAL_TERMINAL_PROCESSING | ENABLE_PROCESSED_OUTPUT);
+	s_SavedCodePage = GetConsoleOutputCP();
+	SetConsoleOutputCP(CP_UTF8);
+	signal(SIGINT, OnQuitSignal);
+	signal(SIGTERM, OnQuitSignal);
+
+	out += "\x1b[?1049h\x1b[?25l\x1b[2J"; //alternate screen, hide the cursor
+	Flush();
+}
+
+void TerminalFrontEnd::RestoreTerminal()
+{
+	out += "\x1b[0m\x1b[?25h\x1b[?1049l";
+	Flush();
+	SetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), s_SavedOutputMode);
+	SetConsoleOutputCP(s_SavedCodePage);
+}
+
+void TerminalFrontEnd::HandleInput()
+{
+	uint8_t bytes[64];
+	size_t count = 0;
+	while (count < sizeof(bytes) && _kbhit())
+		bytes[count++] = (uint8_t)_getch();
+	ParseInput(bytes, count);
+}
+#else
+void TerminalFrontEnd::InitTerminal()
+{
+	tcgetattr(STDIN_FILENO, &s_SavedTermios);
+	termios raw = s_SavedTermios;
+	raw.c_lflag &= ~(ICANON | ECHO | ISIG | IEXTEN); //ctrl-c arrives as a byte and quits cleanly
+	raw.c_iflag &= ~(IXON | ICRNL);
+	raw.c_cc[VMIN] = 0; //reads return right away, with or without input
+	raw.c_cc[VTIME] = 0;
+	tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+	signal(SIGINT, OnQuitSignal);
+	signal(SIGTERM, OnQuitSignal);
+	signal(SIGHUP, OnQuitSignal);
+	signal(SIGWINCH, OnResizeSignal);
+
+	out += "\x1b[?1049h\x1b[?25l\x1b[2J"; //alternate screen, hide the cursor
+	Flush();
+}
+
+void TerminalFrontEnd::RestoreTerminal()
+{
+	out += "\x1b[0m\x1b[?25h\x1b[?1049l";
+	Flush();
+	tcsetattr(STDIN_FILENO, TCSAFLUSH, &s_SavedTermios);
+}
+
+void TerminalFrontEnd::HandleInput()
+{
+	uint8_t bytes[64];
+	ssize_t count;
+	while ((count = read(STDIN_FILENO, bytes, sizeof(bytes))) > 0)
+		ParseInput(bytes, (size_t)count);
+}
+#endif
+
+void TerminalFrontEnd::ParseInput(const uint8_t* bytes, size_t count)
+{
+	for (size_t it = 0; it < count; it++)
+	{
+		uint8_t c = bytes[it];
+		if (c == 0x1B)
+		{
+			//arrow and function keys are escape sequences, skip them. a lone escape quits
+			if (it + 1 < count && (bytes[it + 1] == '[' || bytes[it + 1] == 'O'))
+			{
+				it += 2;
+				while (it < count && (bytes[it] < 0x40 || bytes[it] > 0x7E))
+					it++;
+				continue;
+			}
+			running = false;
+		}
+		else if (c == 0x03) //ctrl-c
+			running = false;
+		else if (c == ' ')
+			paused = !paused;
+		else if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z'))
+		{
+			const char* key = strchr(KEY_CHARS, tolower(c));
+			if (key)
+				key_timers[KEY_LAYOUT[key - KEY_CHARS]] = key_hold;
+		}
+	}
+}
+
+bool TerminalFrontEnd::Load(const std::string& filename)
+{
+	LOG_INFO("Loading new file: {}", filename);
+	RomLoader::Rom rom;
+	if (!RomLoader::Read(filename, rom))
+	{
+		LOG_ERROR("{} {}", rom.error, filename);
+		return false;
+	}
+
+	Chip8::SYSTEM_MODE mode = core->GetSystemMode();
+	Chip8::Quirks quirks = core->quirks;
+	size_t offset = filename.find_last_of("/\\");
+	title = filename.substr(offset == std::string::npos ? 0 : offset + 1);
+	GameDatabase::Game game;
+	if (game_db.Find(rom.sha1, game))
+		LoadPrefs(game, mode, quirks);
+	else
+	{
+		LOG_INFO("Did not find hash: {}, {}", rom.sha1, filename);
+		if (game_db.FindDefault(game))
+			LoadPrefs(game, mode, quirks);
+	}
+	BuildColorCodes();
+
+	uint8_t rpl[Chip8::RPL_SIZE] = { 0 };
+	Movie::Boot(core, rom.data, core->GetSeed(), mode, quirks, rpl);
+	memset(key_timers, 0, sizeof(key_timers));
+	cells.clear(); //colors may have changed, redraw everything
+	return true;
+}
+
+void TerminalFrontEnd::LoadPrefs(const GameDatabase::Game& game, Chip8::SYSTEM_MODE& mode, Chip8::Quirks& quirks)
+{
+	if (!game.has_settings)
+		return;
+	if (game.title != "")
+		title = game.title;
+	if (game.has_tickrate)
+		run_cycles = game.tickrate;
+	mode = game.mode;
+	for (int it = 0; it < 4; it++)
+		screen_Colors[it] = ToColor(game.colors[it]);
+
+	//options default to the mode's own quirks
+	core->SetSystemMode(mode);
+	quirks = core->quirks;
+	GameDatabase::ApplyQuirks(game, quirks);
+}
+
+void TerminalFrontEnd::BuildColorCodes()
+{
+	for (int it = 0; it < 16; it++)
+	{
+		const Color& color = screen_Colors[it];
+		if (colors == ColorMode::TRUECOLOR)
+		{
+			std::string rgb = std::to_string(color.r) + ";" + std::to_string(color.g) + ";" + std::to_string(color.b) + "m";
+			fg_codes[it] = "\x1b[38;2;" + rgb;
+			bg_codes[it] = "\x1b[48;2;" + rgb;
+		}
+		else
+		{
+			std::string index = std::to_string(To256(color)) + "m";
+			fg_codes[it] = "\x1b[38;5;" + index;
+			bg_codes[it] = "\x1b[48;5;" + index;
+		}
+	}
+}
+
+bool TerminalFrontEnd::Run()
+{
+	HandleInput();
+	if (s_Quit)
+		running = false;
+	if (s_Resized)
+	{
+		s_Resized = 0;
+		cells.clear();
+	}
+
+	if (!paused)
+		AdvanceCore();
+	frame_count++;
+	frames_this_second++;
+	if (frame_count % render_interval == 0)
+		Draw();
+	DrawStatus();
+	Flush();
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - fps_start >= std::chrono::seconds(1))
+	{
+		fps = frames_this_second;
+		frames_this_second = 0;
+		fps_start = now;
+	}
+	next_frame += FRAME_TIME;
+	if (now > next_frame + FRAME_TIME * 6) //fell far behind (suspended, slow terminal), don't try to catch up
+		next_frame = now;
+	std::this_thread::sleep_until(next_frame);
+	return running;
+}
+
+void TerminalFrontEnd::AdvanceCore()
+{
+	uint16_t keys = 0;
+	for (int it = 0; it < 16; it++)
+	{
+		if (key_timers[it])
+		{
+			keys |= 1 << it;
+			key_timers[it]--;
+		}
+	}
+	core->SetKeyMask(keys, core->GetKeyMask());
+	core->Run((uint16_t)run_cycles);
+
+	uint8_t sound_timer = core->GetSoundTimer();
+	if (bell && sound_timer && !prev_sound_timer)
+		out += '\a';
+	prev_sound_timer = sound_timer;
+}
+
+void TerminalFrontEnd::MoveCursor(int row, int col)
+{
+	if (row == cursor_row && col == cursor_col)
+		return;
+	if (row == cursor_row && col > cursor_col)
+	{
+		out += "\x1b[";
+		if (col - cursor_col > 1)
+			AppendNumber(col - cursor_col);
+		out += 'C';
+	}
+	else
+	{
+		out += "\x1b[";
+		AppendNumber(row + 1);
+		out += ';';
+		AppendNumber(col + 1);
+		out += 'H';
+	}
+	cursor_row = row;
+	cursor_col = col;
+}
+
+void TerminalFrontEnd::AppendNumber(int val)
+{
+	char digits[12];
+	int count = 0;
+	do
+	{
+		digits[count++] = (char)('0' + val % 10);
+		val /= 10;
+	} while (val);
+	while (count)
+		out += digits[--count];
+}
+
+void TerminalFrontEnd::Draw()
+{
+	const int width = core->res.base_width;
+	const int height = core->res.base_height;
+	const int rows = height / 2;
+	if (width != screen_width || height != screen_height || cells.size() != (size_t)width * rows)
+	{
+		cells.assign((size_t)width * rows, 0xFFFF);
+		screen_width = width;
+		screen_height = height;
+		out += "\x1b[0m\x1b[2J";
+		set_fg = set_bg = -1;
+		cursor_row = cursor_col = -1;
+		status.clear();
+	}
+
+	const uint8_t* vram = core->GetVRAM();
+	uint16_t* cell = cells.data();
+	for (int row = 0; row < rows; row++)
+	{
+		const uint8_t* top = vram + row * 2 * width;
+		const uint8_t* bottom = top + width;
+		for (int col = 0; col < width; col++, cell++)
+		{
+			uint8_t top_color = top[col] & 0x0F;
+			uint8_t bottom_color = bottom[col] & 0x0F;
+			uint16_t value = (uint16_t)(top_color | bottom_color << 8);
+			if (*cell == value)
+				continue;
+			*cell = value;
+
+			MoveCursor(row, col);
+			if (top_color == bottom_color)
+			{
+				//a space only needs the background, whatever the foreground is
+				if (set_bg != top_color)
+				{
+					out += bg_codes[top_color];
+					set_bg = top_color;
+				}
+				out += ' ';
+			}
+			else
+			{
+				if (set_fg != top_color)
+				{
+					out += fg_codes[top_color];
+					set_fg = top_color;
+				}
+				if (set_bg != bottom_color)
+				{
+					out += bg_codes[bottom_color];
+					set_bg = bottom_color;
+				}
+				out += UPPER_HALF_BLOCK;
+			}
+			cursor_col++;
+		}
+	}
+}
+
+void TerminalFrontEnd::DrawStatus()
+{
+	static const char* MODES[] = { "CHIP-8", "SUPER-CHIP", "XO-CHIP" };
+	std::string text = " KIP-8  " + title + "  " + MODES[core->GetSystemMode()] + "  " + std::to_string(run_cycles) + " cycles  "
+		+ std::to_string(fps) + " fps" + (paused ? "  (Paused)" : "") + (core->GetHalted() ? "  (Halted)" : "") + "  |  space pause, esc quit";
+	if (text == status || screen_height == 0)
+		return;
+	status = text;
+
+	MoveCursor(screen_height / 2, 0);
+	out += "\x1b[0m";
+	out += status;
+	out += "\x1b[K";
+	set_fg = set_bg = -1;
+	cursor_row = cursor_col = -1; //wherever the text left it
+}
+
+void TerminalFrontEnd::Flush()
+{
+	if (out.empty())
+		return;
+	fwrite(out.data(), 1, out.size(), stdout);
+	fflush(stdout);
+	out.clear();
+}
@@ -0,0 +1,120 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+static thread_local const ThreadPool* t_Pool = nullptr;
+static thread_local int t_WorkerIndex = -1;
+
+ThreadPool::ThreadPool(unsigned int threads)
+{
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned int it = 0; it < threads; it++)
+		queues.push_back(std::make_unique<Queue>());
+	for (unsigned int it = 0; it < threads; it++)
+		workers.emplace_back(&ThreadPool::WorkerLoop, this, it);
+}
+
+ThreadPool::~ThreadPool()
+{
+	Wait();
+	{
+		std::lock_guard<std::mutex> guard(wake_lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+int ThreadPool::CurrentWorker()
+{
+	return t_WorkerIndex;
+}
+
+void ThreadPool::Submit(Task task)
+{
+	unsigned int index;
+	if (t_Pool == this)
+		index = (unsigned int)t_WorkerIndex;
+	else
+		index = (unsigned int)(next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size());
+
+	pending.fetch_add(1, std::memory_order_relaxed);
+	{
+		//counted under wake_lock before the push, so a worker checking the predicate can't miss it
+		//and a worker popping the task right away can't take queued below zero
+		std::lock_guard<std::mutex> guard(wake_lock);
+		queued++;
+	}
+	{
+		std::lock_guard<std::mutex> guard(queues[index]->lock);
+		queues[index]->tasks.push_back(std::move(task));
+	}
+	wake.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> guard(wake_lock);
+	idle.wait(guard, [this] { return pending.load(std::memory_order_acquire) == 0; });
+}
+
+bool ThreadPool::PopLocal(unsigned int index, Task& task)
+{
+	Queue& queue = *queues[index];
+	std::lock_guard<std::mutex> guard(queue.lock);
+	if (queue.tasks.empty())
+		return false;
+	task = std::move(queue.tasks.back());
+	queue.tasks.pop_back();
+	return true;
+}
+
+bool ThreadPool::Steal(unsigned int index, Task& task)
+{
+	for (size_t it = 1; it < queues.size(); it++)
+	{
+		Queue& victim = *queues[(index + it) % queues.size()];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (victim.tasks.empty())
+			continue;
+		task = std::move(victim.tasks.front());
+		victim.tasks.pop_front();
+		steals.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::WorkerLoop(unsigned int index)
+{
+	t_Pool = this;
+	t_WorkerIndex = (int)index;
+
+	while (true)
+	{
+		Task task;
+		if (PopLocal(index, task) || Steal(index, task))
+		{
+			{
+				std::lock_guard<std::mutex> guard(wake_lock);
+				queued--;
+			}
+			task();
+			task = nullptr; //release captures before reporting the task done
+
+			if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				std::lock_guard<std::mutex> guard(wake_lock);
+				idle.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(wake_lock);
+		wake.wait(guard, [this] { return stopping || queued > 0; });
+		if (stopping && queued == 0)
+			return;
+	}
+}
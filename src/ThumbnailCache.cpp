@@ -0,0 +1,255 @@
+#include "ThumbnailCache.h"
+#include "Logger.h"
+#include "Movie.h"
+#include "QuirkDetector.h"
+#include "RomLoader.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#pragma pack(push, 1)
+struct ThumbnailHeader {
+	char magic[4];
+	uint16_t version;
+	uint8_t width;
+	uint8_t height;
+	uint8_t frames;
+	uint8_t reserved;
+	uint32_t colors[4];
+};
+#pragma pack(pop)
+
+static const uint16_t THUMBNAIL_VERSION = 1;
+static const size_t FRAME_PIXELS = (size_t)ThumbnailCache::WIDTH * ThumbnailCache::HEIGHT;
+
+ThumbnailCache::ThumbnailCache(unsigned int threads) : thread_count(threads)
+{
+	if (thread_count == 0)
+	{
+		unsigned int hardware = std::thread::hardware_concurrency();
+		thread_count = hardware > 1 ? hardware - 1 : 1;
+	}
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+	for (auto& request : pending)
+		request.second->cancel = true;
+	pool = nullptr; //queued tasks still run, but only to see they were cancelled
+}
+
+bool ThumbnailCache::Open(const std::string& thumbnail_directory, GameDatabase* game_database)
+{
+	directory = thumbnail_directory;
+	database = game_database;
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error)
+	{
+		LOG_ERROR("Could not create thumbnail directory {}: {}", directory, error.message());
+		return false;
+	}
+	return true;
+}
+
+std::shared_ptr<const ThumbnailCache::Thumbnail> ThumbnailCache::Get(const std::string& path, const std::string& sha1)
+{
+	auto found = cached.find(sha1);
+	if (found != cached.end())
+	{
+		found->second.used = generation;
+		return found->second.thumbnail;
+	}
+
+	auto queued = pending.find(sha1);
+	if (queued != pending.end())
+	{
+		std::shared_ptr<Request> request = queued->second;
+		if (!request->done.load(std::memory_order_acquire))
+		{
+			request->wanted = generation;
+			return nullptr;
+		}
+		pending.erase(queued);
+		cached[sha1] = { request->thumbnail, generation }; //a rom that failed is cached as null and not retried
+		return request->thumbnail;
+	}
+
+	if (!pool)
+	{
+		for (unsigned int it = 0; it < thread_count; it++)
+			arenas.push_back(std::make_unique<PageArena>());
+		quiet_logger = Logger::CreateWorkerLogger("Thumbnails", "", spdlog::level::off);
+		pool = std::make_unique<ThreadPool>(thread_count);
+	}
+
+	auto request = std::make_shared<Request>();
+	request->path = path;
+	request->sha1 = sha1;
+	request->wanted = generation;
+	pending[sha1] = request;
+	pool->Submit([this, request]() {
+		if (!request->cancel.load(std::memory_order_relaxed))
+			Build(*request);
+		request->done.store(true, std::memory_order_release);
+	});
+	return nullptr;
+}
+
+void ThumbnailCache::Trim()
+{
+	for (auto it = pending.begin(); it != pending.end();)
+	{
+		Request& request = *it->second;
+		if (request.done.load(std::memory_order_acquire))
+			cached[it->first] = { request.thumbnail, request.wanted };
+		else if (request.wanted < generation)
+			request.cancel = true;
+		else
+		{
+			++it;
+			continue;
+		}
+		it = pending.erase(it);
+	}
+
+	if (cached.size() > MEMORY_LIMIT)
+	{
+		std::vector<std::pair<uint64_t, std::string>> by_age;
+		for (auto& entry : cached)
+			if (entry.second.used < generation)
+				by_age.push_back({ entry.second.used, entry.first });
+		size_t excess = std::min(cached.size() - MEMORY_LIMIT, by_age.size());
+		std::partial_sort(by_age.begin(), by_age.begin() + excess, by_age.end());
+		for (size_t it = 0; it < excess; it++)
+			cached.erase(by_age[it].second);
+	}
+	generation++;
+}
+
+void ThumbnailCache::Build(Request& request)
+{
+	auto thumbnail = std::make_shared<Thumbnail>();
+	if (Load(FileFor(request.sha1), *thumbnail))
+	{
+		request.thumbnail = thumbnail;
+		return;
+	}
+
+	RomLoader::Rom rom;
+	if (!RomLoader::Read(request.path, rom))
+		return;
+	if (!Render(rom.data, rom.sha1, *thumbnail, arenas[ThreadPool::CurrentWorker()].get(), &request.cancel))
+		return;
+	Save(FileFor(rom.sha1), *thumbnail);
+	request.thumbnail = thumbnail;
+}
+
+//the framebuffer is 64x32 or 128x64 depending on the mode, bigger ones are shrunk by ORing each block so thin
+//hires lines don't disappear
+static void Capture(Chip8& core, uint8_t* out)
+{
+	const uint8_t* vram = core.GetVRAM();
+	int width = core.res.base_width, height = core.res.base_height;
+	int step_x = std::max(1, width / ThumbnailCache::WIDTH), step_y = std::max(1, height / ThumbnailCache::HEIGHT);
+	for (int y = 0; y < ThumbnailCache::HEIGHT; y++)
+	{
+		for (int x = 0; x < ThumbnailCache::WIDTH; x++)
+		{
+			uint8_t pixel = 0;
+			for (int by = 0; by < step_y; by++)
+				for (int bx = 0; bx < step_x; bx++)
+					pixel |= vram[(y * step_y + by) * width + x * step_x + bx];
+			out[y * ThumbnailCache::WIDTH + x] = pixel & 0x3;
+		}
+	}
+}
+
+bool ThumbnailCache::Render(const std::vector<unsigned char>& rom, const std::string& sha1, Thumbnail& thumbnail, PageArena* arena, const std::atomic<bool>* cancel)
+{
+	GameDatabase::Game game;
+	if (!database || !(database->Find(sha1, game) || database->FindDefault(game)))
+	{
+		game = GameDatabase::Game();
+		memcpy(game.colors, GameDatabase::DEFAULT_COLORS, sizeof(game.colors));
+	}
+	memcpy(thumbnail.colors, game.colors, sizeof(thumbnail.colors));
+	thumbnail.pixels.assign(FRAME_PIXELS * FRAMES, 0);
+
+	Chip8 core(arena, quiet_logger);
+	core.SetSystemMode(game.mode);
+	Chip8::Quirks quirks = core.quirks;
+	GameDatabase::ApplyQuirks(game, quirks);
+	uint8_t rpl[Chip8::RPL_SIZE] = { 0 };
+	Movie::Boot(&core, rom, 0, game.mode, quirks, rpl);
+	uint16_t cycles = game.has_tickrate ? game.tickrate : 9;
+
+	uint16_t prev_keys = 0;
+	int captured = 0;
+	for (uint32_t frame = 0; captured < FRAMES; frame++)
+	{
+		if (cancel && cancel->load(std::memory_order_relaxed))
+			return false;
+		uint16_t keys = QuirkDetector::ScriptedKeys(frame);
+		core.SetKeyMask(keys, prev_keys);
+		prev_keys = keys;
+		core.Run(cycles);
+
+		//a rom that stopped keeps showing whatever it stopped on
+		bool halted = core.GetHalted();
+		if (halted || (frame >= FIRST_FRAME && (frame - FIRST_FRAME) % FRAME_INTERVAL == 0))
+		{
+			Capture(core, &thumbnail.pixels[captured * FRAME_PIXELS]);
+			captured++;
+		}
+		if (halted)
+		{
+			for (; captured < FRAMES; captured++)
+				memcpy(&thumbnail.pixels[captured * FRAME_PIXELS], &thumbnail.pixels[(captured - 1) * FRAME_PIXELS], FRAME_PIXELS);
+		}
+	}
+	return true;
+}
+
+bool ThumbnailCache::Save(const std::string& filename, const Thumbnail& thumbnail)
+{
+	ThumbnailHeader header;
+	memcpy(header.magic, "KTHM", 4);
+	header.version = THUMBNAIL_VERSION;
+	header.width = WIDTH;
+	header.height = HEIGHT;
+	header.frames = FRAMES;
+	header.reserved = 0;
+	memcpy(header.colors, thumbnail.colors, sizeof(header.colors));
+
+	std::string out((const char*)&header, sizeof(header));
+	out.resize(sizeof(header) + thumbnail.pixels.size() / 4, 0);
+	uint8_t* packed = (uint8_t*)&out[sizeof(header)];
+	for (size_t it = 0; it < thumbnail.pixels.size(); it++)
+		packed[it / 4] |= (uint8_t)((thumbnail.pixels[it] & 0x3) << ((it % 4) * 2));
+
+	std::ofstream ofd(filename, std::ios::binary | std::ios::out | std::ios::trunc);
+	ofd.write(out.data(), out.size());
+	ofd.close();
+	return ofd.good();
+}
+
+bool ThumbnailCache::Load(const std::string& filename, Thumbnail& thumbnail)
+{
+	std::ifstream ifd(filename, std::ios::binary);
+	ThumbnailHeader header;
+	if (!ifd.good() || !ifd.read((char*)&header, sizeof(header)))
+		return false;
+	if (memcmp(header.magic, "KTHM", 4) != 0 || header.version != THUMBNAIL_VERSION || header.width != WIDTH || header.height != HEIGHT || header.frames != FRAMES)
+		return false;
+
+	std::vector<uint8_t> packed(FRAME_PIXELS * FRAMES / 4);
+	if (!ifd.read((char*)packed.data(), packed.size()))
+		return false;
+	memcpy(thumbnail.colors, header.colors, sizeof(thumbnail.colors));
+	thumbnail.pixels.resize(FRAME_PIXELS * FRAMES);
+	for (size_t it = 0; it < thumbnail.pixels.size(); it++)
+		thumbnail.pixels[it] = (packed[it / 4] >> ((it % 4) * 2)) & 0x3;
+	return true;
+}
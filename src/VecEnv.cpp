@@ -0,0 +1,212 @@
+#include "VecEnv.h"
+#include "Checksum.h"
+#include "Logger.h"
+#include "Movie.h"
+#include <algorithm>
+#include <string.h>
+
+VecEnv::VecEnv(const RomImage& rom, size_t env_count, const Config& config) : rom(rom), env_count(env_count), config(config), batch(env_count)
+{
+	if (this->config.actions.empty())
+	{
+		this->config.actions.push_back(0);
+		for (int key = 0; key < 16; key++)
+			this->config.actions.push_back((uint16_t)(1 << key));
+	}
+	if (this->config.frame_skip == 0)
+		this->config.frame_skip = 1;
+	uint8_t downsample = this->config.downsample;
+	if (downsample != 1 && downsample != 2 && downsample != 4)
+	{
+		LOG_WARN("VecEnv downsample {} not supported, using 1", downsample);
+		this->config.downsample = 1;
+	}
+
+	obs_width = 128 / this->config.downsample;
+	obs_height = 64 / this->config.downsample;
+	observations.assign(env_count * obs_width * obs_height, 0);
+	rewards.assign(env_count, 0.0f);
+	terminals.assign(env_count, 0);
+	truncations.assign(env_count, 0);
+	finished.assign(env_count, 0);
+	episode_frames.assign(env_count, 0);
+	seeds.assign(env_count, 0);
+	keys.assign(env_count, 0);
+	term_values.assign(env_count * this->config.rewards.size(), 0);
+}
+
+void VecEnv::Reset(const uint64_t* new_seeds)
+{
+	for (size_t env = 0; env < env_count; env++)
+	{
+		Reset(env, new_seeds ? new_seeds[env] : env);
+		rewards[env] = 0.0f;
+		terminals[env] = 0;
+		truncations[env] = 0;
+	}
+}
+
+void VecEnv::Reset(size_t env, uint64_t seed)
+{
+	Chip8* core = batch.GetLane(env);
+	uint8_t rpl[Chip8::RPL_SIZE] = { 0 };
+	Movie::Boot(core, rom, seed, config.mode, config.quirks, rpl);
+
+	seeds[env] = seed;
+	keys[env] = 0;
+	episode_frames[env] = 0;
+	for (size_t term = 0; term < config.rewards.size(); term++)
+		term_values[env * config.rewards.size() + term] = ReadTerm(core, config.rewards[term]);
+	WriteObservation(env);
+}
+
+int32_t VecEnv::ReadTerm(Chip8* core, const RewardTerm& term)
+{
+	int32_t value = core->ReadRAM(term.address);
+	if (term.size == 2)
+		value = (value << 8) | core->ReadRAM((uint16_t)(term.address + 1));
+	return value;
+}
+
+bool VecEnv::CheckDone(Chip8* core)
+{
+	if (core->GetHalted())
+		return true;
+	for (const DoneTerm& term : config.dones)
+	{
+		uint8_t value = core->ReadRAM(term.address);
+		switch (term.compare)
+		{
+		case DoneTerm::EQUAL: if (value == term.value) return true; break;
+		case DoneTerm::NOT_EQUAL: if (value != term.value) return true; break;
+		case DoneTerm::LESS: if (value < term.value) return true; break;
+		case DoneTerm::GREATER: if (value > term.value) return true; break;
+		}
+	}
+	return false;
+}
+
+void VecEnv::Step(const uint32_t* actions)
+{
+	size_t term_count = config.rewards.size();
+	for (size_t env = 0; env < env_count; env++)
+	{
+		rewards[env] = 0.0f;
+		terminals[env] = 0;
+		truncations[env] = 0;
+		finished[env] = 0;
+	}
+
+	for (uint32_t frame = 0; frame < config.frame_skip; frame++)
+	{
+		for (size_t env = 0; env < env_count; env++)
+		{
+			uint32_t action = actions[env];
+			uint16_t held = (action < config.actions.size()) ? config.actions[action] : 0;
+			batch.GetLane(env)->SetKeyMask(held, keys[env]);
+			keys[env] = held;
+		}
+
+		batch.Run(config.cycles);
+
+		//lanes that already finished keep running with the rest of the batch, but nothing they do counts
+		for (size_t env = 0; env < env_count; env++)
+		{
+			if (finished[env])
+				continue;
+			Chip8* core = batch.GetLane(env);
+			episode_frames[env]++;
+
+			int32_t* values = &term_values[env * term_count];
+			float reward = 0.0f;
+			for (size_t term = 0; term < term_count; term++)
+			{
+				const RewardTerm& spec = config.rewards[term];
+				int32_t value = ReadTerm(core, spec);
+				reward += spec.scale * (float)(spec.delta ? value - values[term] : value);
+				values[term] = value;
+			}
+			rewards[env] += reward;
+
+			if (CheckDone(core))
+			{
+				terminals[env] = 1;
+				finished[env] = 1;
+			}
+			else if (config.max_episode_frames && episode_frames[env] >= config.max_episode_frames)
+			{
+				truncations[env] = 1;
+				finished[env] = 1;
+			}
+		}
+	}
+
+	for (size_t env = 0; env < env_count; env++)
+	{
+		//the next episode's seed follows from this one's so runs stay reproducible from the seeds given to Reset
+		if (finished[env] && config.auto_reset)
+			Reset(env, Mix64(seeds[env] + 1));
+		else
+			WriteObservation(env);
+	}
+}
+
+void VecEnv::WriteObservation(size_t env)
+{
+	Chip8* core = batch.GetLane(env);
+	const uint8_t* src = core->GetVRAM();
+	size_t src_width = core->res.base_width;
+	size_t src_height = core->res.base_height;
+	uint8_t* out = &observations[env * obs_width * obs_height];
+
+	//same size, straight copy. this covers full size schip/xo-chip and chip-8 at downsample 2
+	if (src_width == obs_width && src_height == obs_height)
+	{
+		memcpy(out, src, obs_width * obs_height);
+		return;
+	}
+
+	//chip-8 framebuffers are upscaled, anything larger than the observation is ORed down so thin sprites survive.
+	//both work a row at a time, per pixel index math is most of the cost at these sizes
+	if (src_width < obs_width)
+	{
+		size_t scale = obs_width / src_width;
+		for (size_t y = 0; y < src_height; y++)
+		{
+			uint8_t* row = out + y * scale * obs_width;
+			for (size_t x = 0; x < src_width; x++)
+				for (size_t sx = 0; sx < scale; sx++)
+					row[x * scale + sx] = src[y * src_width + x];
+			for (size_t sy = 1; sy < scale; sy++)
+				memcpy(row + sy * obs_width, row, obs_width);
+		}
+		return;
+	}
+
+	size_t block = src_width / obs_width;
+	if (block == 2)
+	{
+		for (size_t y = 0; y < obs_height; y++)
+		{
+			const uint8_t* in0 = src + y * 2 * src_width;
+			const uint8_t* in1 = in0 + src_width;
+			uint8_t* row = out + y * obs_width;
+			for (size_t x = 0; x < obs_width; x++)
+				row[x] = in0[x * 2] | in0[x * 2 + 1] | in1[x * 2] | in1[x * 2 + 1];
+		}
+		return;
+	}
+
+	for (size_t y = 0; y < obs_height; y++)
+	{
+		uint8_t* row = out + y * obs_width;
+		memset(row, 0, obs_width);
+		for (size_t by = 0; by < block; by++)
+		{
+			const uint8_t* in = src + (y * block + by) * src_width;
+			for (size_t x = 0; x < obs_width; x++)
+				for (size_t bx = 0; bx < block; bx++)
+					row[x] |= in[x * block + bx];
+		}
+	}
+}
@@ -0,0 +1,119 @@
+#include "VecEnvC.h"
+#include "VecEnv.h"
+#include "Logger.h"
+#include <memory>
+
+//the VecEnv is created on first use so reward and done terms can be added one call at a time
+struct kip8_vecenv {
+	std::unique_ptr<RomImage> rom;
+	size_t env_count;
+	VecEnv::Config config;
+	std::unique_ptr<VecEnv> env;
+
+	VecEnv& Env()
+	{
+		if (!env)
+			env = std::make_unique<VecEnv>(*rom, env_count, config);
+		return *env;
+	}
+};
+
+void kip8_vecenv_default_config(kip8_vecenv_config* config)
+{
+	VecEnv::Config defaults;
+	config->mode = KIP8_MODE_CHIP8;
+	config->cycles = defaults.cycles;
+	config->frame_skip = defaults.frame_skip;
+	config->downsample = defaults.downsample;
+	config->auto_reset = defaults.auto_reset;
+	config->max_episode_frames = defaults.max_episode_frames;
+	config->actions = nullptr;
+	config->action_count = 0;
+}
+
+kip8_vecenv* kip8_vecenv_create(const uint8_t* rom, size_t rom_size, size_t env_count, const kip8_vecenv_config* config)
+{
+	//bindings never run a main() that sets up logging, the cores need a logger to exist
+	if (!Logger::GetLogger())
+		Logger::InitConsole(spdlog::level::warn);
+
+	if (!rom || rom_size == 0 || rom_size > 0x10000 - RomImage::LOAD_ADDRESS)
+	{
+		LOG_ERROR("kip8_vecenv_create: bad rom size {}", rom_size);
+		return nullptr;
+	}
+
+	kip8_vecenv* handle = new kip8_vecenv();
+	handle->rom = std::make_unique<RomImage>(std::vector<unsigned char>(rom, rom + rom_size));
+	handle->env_count = env_count;
+	if (config)
+	{
+		switch (config->mode)
+		{
+		case KIP8_MODE_SCHIP: handle->config.mode = Chip8::SYSTEM_MODE::SUPER_CHIP; break;
+		case KIP8_MODE_XOCHIP: handle->config.mode = Chip8::SYSTEM_MODE::XO_CHIP; break;
+		default: handle->config.mode = Chip8::SYSTEM_MODE::CHIP_8; break;
+		}
+		handle->config.cycles = config->cycles;
+		handle->config.frame_skip = config->frame_skip;
+		handle->config.downsample = config->downsample;
+		handle->config.auto_reset = config->auto_reset != 0;
+		handle->config.max_episode_frames = config->max_episode_frames;
+		if (config->actions)
+			handle->config.actions.assign(config->actions, config->actions + config->action_count);
+	}
+	return handle;
+}
+
+void kip8_vecenv_destroy(kip8_vecenv* env)
+{
+	delete env;
+}
+
+void kip8_vecenv_add_reward(kip8_vecenv* env, uint16_t address, uint8_t size, float scale, int delta)
+{
+	if (env->env)
+	{
+		LOG_WARN("kip8_vecenv_add_reward: env already started, term ignored");
+		return;
+	}
+	VecEnv::RewardTerm term;
+	term.address = address;
+	term.size = size;
+	term.scale = scale;
+	term.delta = delta != 0;
+	env->config.rewards.push_back(term);
+}
+
+void kip8_vecenv_add_done(kip8_vecenv* env, uint16_t address, uint8_t value, int compare)
+{
+	if (env->env)
+	{
+		LOG_WARN("kip8_vecenv_add_done: env already started, term ignored");
+		return;
+	}
+	VecEnv::DoneTerm term;
+	term.address = address;
+	term.value = value;
+	term.compare = (VecEnv::DoneTerm::Compare)(compare & 3);
+	env->config.dones.push_back(term);
+}
+
+void kip8_vecenv_reset(kip8_vecenv* env, const uint64_t* seeds)
+{
+	env->Env().Reset(seeds);
+}
+
+void kip8_vecenv_step(kip8_vecenv* env, const uint32_t* actions)
+{
+	env->Env().Step(actions);
+}
+
+size_t kip8_vecenv_env_count(kip8_vecenv* env) { return env->env_count; }
+size_t kip8_vecenv_action_count(kip8_vecenv* env) { return env->Env().GetActionCount(); }
+size_t kip8_vecenv_obs_width(kip8_vecenv* env) { return env->Env().GetObservationWidth(); }
+size_t kip8_vecenv_obs_height(kip8_vecenv* env) { return env->Env().GetObservationHeight(); }
+const uint8_t* kip8_vecenv_observations(kip8_vecenv* env) { return env->Env().GetObservations(); }
+const float* kip8_vecenv_rewards(kip8_vecenv* env) { return env->Env().GetRewards(); }
+const uint8_t* kip8_vecenv_terminals(kip8_vecenv* env) { return env->Env().GetTerminals(); }
+const uint8_t* kip8_vecenv_truncations(kip8_vecenv* env) { return env->Env().GetTruncations(); }